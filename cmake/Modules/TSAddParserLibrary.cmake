@@ -15,6 +15,7 @@ Create a tree-sitter parser library target.
   - ``src/parser.c`` as the main source (required)
   - ``src/scanner.c`` as additional source (if it exists)
   - PICKY_DEVELOPER warning flags applied to scanner.c
+  - ``TREE_SITTER_SCANNER_STATS`` defined if ENABLE_SCANNER_STATS is set
   - pkg-config file generation and installation
   - Query files installation (if queries/ directory exists)
 
@@ -73,6 +74,7 @@ function(ts_add_parser_library name)
     # Compile definitions
     target_compile_definitions(${_target} PRIVATE
         $<$<BOOL:${TREE_SITTER_REUSE_ALLOCATOR}>:TREE_SITTER_REUSE_ALLOCATOR>
+        $<$<BOOL:${ENABLE_SCANNER_STATS}>:TREE_SITTER_SCANNER_STATS>
         $<$<CONFIG:Debug>:TREE_SITTER_DEBUG>
     )
 
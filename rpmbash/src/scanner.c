@@ -81,6 +81,34 @@
 #pragma GCC diagnostic pop
 #endif
 
+/*
+ * Opt-in instrumentation counters, shared with the rpmspec scanner. See
+ * rpmspec/src/scanner_stats.h.
+ */
+#ifdef TREE_SITTER_SCANNER_STATS
+#include "../../rpmspec/src/scanner_stats.h"
+
+/*
+ * With counters the payload wraps the bash scanner, so every parser counts
+ * on its own.
+ */
+typedef struct {
+    void *bash;
+    TSRpmScannerStats stats;
+} RpmbashScanner;
+
+#define BASH_PAYLOAD(payload) (((RpmbashScanner *)(payload))->bash)
+
+/* Counters of all destroyed scanners */
+static TSRpmScannerStats scanner_stats_totals;
+#else
+typedef struct TSRpmScannerStats TSRpmScannerStats;
+
+#define SCANNER_STATS_INC(stats, field) ((void)0)
+
+#define BASH_PAYLOAD(payload) (payload)
+#endif
+
 /*
  * RPM macro names follow identifier rules: start with letter/underscore,
  * followed by letters, digits, or underscores.
@@ -156,6 +184,17 @@ typedef enum {
     SCAN_NO_KEYWORD,
 } ScanNewlineResult;
 
+/*
+ * Advance the lexer while peeking past the newline.
+ */
+static inline void peek_advance(TSRpmScannerStats *stats, TSLexer *lexer)
+{
+    /* Only used by the counters, which may be compiled out */
+    (void)stats;
+    SCANNER_STATS_INC(stats, lookahead_chars);
+    lexer->advance(lexer, false);
+}
+
 /*
  * Check if we're at a newline followed by an RPM statement keyword.
  *
@@ -172,7 +211,9 @@ typedef enum {
  * insignificant whitespace and try to parse %if as an argument to configure.
  */
 static ScanNewlineResult
-scan_newline_before_rpm_statement(TSLexer *lexer, const bool *valid_symbols)
+scan_newline_before_rpm_statement(TSRpmScannerStats *stats,
+                                  TSLexer *lexer,
+                                  const bool *valid_symbols)
 {
     /* Only proceed if we're at a newline and NEWLINE is a valid token here */
     if (!valid_symbols[NEWLINE] || lexer->lookahead != '\n') {
@@ -185,8 +226,10 @@ scan_newline_before_rpm_statement(TSLexer *lexer, const bool *valid_symbols)
      */
     lexer->mark_end(lexer);
 
+    SCANNER_STATS_INC(stats, lookahead_calls);
+
     /* Consume the newline character */
-    lexer->advance(lexer, false);
+    peek_advance(stats, lexer);
 
     /*
      * Mark the token end position HERE, right after the newline.
@@ -209,7 +252,7 @@ scan_newline_before_rpm_statement(TSLexer *lexer, const bool *valid_symbols)
      */
     while (lexer->lookahead == ' ' || lexer->lookahead == '\t' ||
            lexer->lookahead == '\n') {
-        lexer->advance(lexer, false);
+        peek_advance(stats, lexer);
     }
 
     /* Not at '%' - no RPM keyword here */
@@ -218,7 +261,7 @@ scan_newline_before_rpm_statement(TSLexer *lexer, const bool *valid_symbols)
     }
 
     /* Skip past the '%' to read the keyword name */
-    lexer->advance(lexer, false);
+    peek_advance(stats, lexer);
 
     /* Read the potential keyword into a buffer */
     char name_buf[16];
@@ -227,7 +270,7 @@ scan_newline_before_rpm_statement(TSLexer *lexer, const bool *valid_symbols)
     while (is_macro_name_char(lexer->lookahead, name_len == 0) &&
            name_len < sizeof(name_buf) - 1) {
         name_buf[name_len++] = (char)lexer->lookahead;
-        lexer->advance(lexer, false);
+        peek_advance(stats, lexer);
     }
     name_buf[name_len] = '\0';
 
@@ -253,30 +296,61 @@ scan_newline_before_rpm_statement(TSLexer *lexer, const bool *valid_symbols)
     return SCAN_NO_KEYWORD;
 }
 
+/*
+ * Get the counters of all destroyed rpmbash scanners. Returns false if the
+ * scanner was built without ENABLE_SCANNER_STATS.
+ */
+bool tree_sitter_rpmbash_scanner_stats(TSRpmScannerStats *stats)
+{
+#ifdef TREE_SITTER_SCANNER_STATS
+    scanner_stats_load(stats, &scanner_stats_totals);
+    return true;
+#else
+    (void)stats;
+    return false;
+#endif
+}
+
 /*
  * Scanner lifecycle functions - delegate to the wrapped bash scanner.
  */
 void *tree_sitter_rpmbash_external_scanner_create(void)
 {
+#ifdef TREE_SITTER_SCANNER_STATS
+    RpmbashScanner *scanner = ts_calloc(1, sizeof(RpmbashScanner));
+
+    scanner->bash = _bash_external_scanner_create();
+    return scanner;
+#else
     return _bash_external_scanner_create();
+#endif
 }
 
 void tree_sitter_rpmbash_external_scanner_destroy(void *payload)
 {
+#ifdef TREE_SITTER_SCANNER_STATS
+    RpmbashScanner *scanner = (RpmbashScanner *)payload;
+
+    scanner_stats_merge(&scanner_stats_totals, &scanner->stats);
+    scanner_stats_dump("rpmbash", &scanner->stats, NULL, ERROR_RECOVERY + 1);
+    _bash_external_scanner_destroy(scanner->bash);
+    ts_free(scanner);
+#else
     _bash_external_scanner_destroy(payload);
+#endif
 }
 
 unsigned tree_sitter_rpmbash_external_scanner_serialize(void *payload,
                                                         char *buffer)
 {
-    return _bash_external_scanner_serialize(payload, buffer);
+    return _bash_external_scanner_serialize(BASH_PAYLOAD(payload), buffer);
 }
 
 void tree_sitter_rpmbash_external_scanner_deserialize(void *payload,
                                                       const char *buffer,
                                                       unsigned length)
 {
-    _bash_external_scanner_deserialize(payload, buffer, length);
+    _bash_external_scanner_deserialize(BASH_PAYLOAD(payload), buffer, length);
 }
 
 /*
@@ -285,12 +359,13 @@ void tree_sitter_rpmbash_external_scanner_deserialize(void *payload,
  * We first check for the newline-before-RPM-keyword case. If that doesn't
  * apply, we delegate to the bash scanner for normal token handling.
  */
-bool tree_sitter_rpmbash_external_scanner_scan(void *payload,
-                                               TSLexer *lexer,
-                                               const bool *valid_symbols)
+static bool rpmbash_scan(TSRpmScannerStats *stats,
+                         void *bash,
+                         TSLexer *lexer,
+                         const bool *valid_symbols)
 {
     ScanNewlineResult result =
-        scan_newline_before_rpm_statement(lexer, valid_symbols);
+        scan_newline_before_rpm_statement(stats, lexer, valid_symbols);
 
     switch (result) {
     case SCAN_MATCHED_KEYWORD:
@@ -310,6 +385,7 @@ bool tree_sitter_rpmbash_external_scanner_scan(void *payload,
          * The grammar's extras (which include whitespace) will handle the
          * newline appropriately.
          */
+        SCANNER_STATS_INC(stats, no_keyword_retries);
         return false;
 
     case SCAN_NOT_AT_NEWLINE:
@@ -318,5 +394,28 @@ bool tree_sitter_rpmbash_external_scanner_scan(void *payload,
     }
 
     /* Normal case: let the bash scanner handle this token */
-    return _bash_external_scanner_scan(payload, lexer, valid_symbols);
+    return _bash_external_scanner_scan(bash, lexer, valid_symbols);
+}
+
+bool tree_sitter_rpmbash_external_scanner_scan(void *payload,
+                                               TSLexer *lexer,
+                                               const bool *valid_symbols)
+{
+#ifdef TREE_SITTER_SCANNER_STATS
+    RpmbashScanner *scanner = (RpmbashScanner *)payload;
+    uint64_t chars = scanner->stats.lookahead_chars;
+    bool found =
+        rpmbash_scan(&scanner->stats, scanner->bash, lexer, valid_symbols);
+
+    SCANNER_STATS_INC(&scanner->stats, scan_calls);
+    SCANNER_STATS_MAX(&scanner->stats,
+                      max_lookahead_chars,
+                      scanner->stats.lookahead_chars - chars);
+    if (found) {
+        SCANNER_STATS_TOKEN(&scanner->stats, lexer->result_symbol);
+    }
+    return found;
+#else
+    return rpmbash_scan(NULL, payload, lexer, valid_symbols);
+#endif
 }
@@ -1,6 +1,9 @@
 #ifndef TREE_SITTER_RPMSPEC_H_
 #define TREE_SITTER_RPMSPEC_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 typedef struct TSLanguage TSLanguage;
 
 #ifdef __cplusplus
@@ -9,6 +12,51 @@ extern "C" {
 
 const TSLanguage *tree_sitter_rpmspec(void);
 
+/** Number of external tokens counted in TSRpmScannerStats.tokens */
+#define TS_RPM_SCANNER_STATS_TOKENS 64
+
+/**
+ * Instrumentation counters of an external scanner.
+ *
+ * The counters are only collected if the library was built with
+ * -DENABLE_SCANNER_STATS=ON. Each parser counts in its own scanner and adds
+ * the counters to the process-wide totals when the parser is deleted. If the
+ * environment variable TREE_SITTER_SCANNER_STATS is set, the counters of
+ * every deleted parser are printed to stderr as well.
+ */
+typedef struct TSRpmScannerStats {
+    /** Calls of the external scanner */
+    uint64_t scan_calls;
+    /** Tokens returned, indexed by the externals order of grammar.js */
+    uint64_t tokens[TS_RPM_SCANNER_STATS_TOKENS];
+    /** Lookahead scans past the end of the token */
+    uint64_t lookahead_calls;
+    /** Characters consumed by all lookahead scans */
+    uint64_t lookahead_chars;
+    /** Characters consumed by the longest lookahead scan */
+    uint64_t max_lookahead_chars;
+    /** Deepest conditional nesting reached by a lookahead scan */
+    uint64_t max_lookahead_depth;
+    /** Newline peeks of rpmbash which found no keyword (SCAN_NO_KEYWORD) */
+    uint64_t no_keyword_retries;
+} TSRpmScannerStats;
+
+/**
+ * Get the totals of all deleted rpmspec parsers.
+ *
+ * Returns false and leaves stats untouched if the library was built without
+ * ENABLE_SCANNER_STATS.
+ */
+bool tree_sitter_rpmspec_scanner_stats(TSRpmScannerStats *stats);
+
+/**
+ * Get the totals of all deleted rpmbash parsers.
+ *
+ * Provided by the tree-sitter-rpmbash library. Returns false and leaves
+ * stats untouched if it was built without ENABLE_SCANNER_STATS.
+ */
+bool tree_sitter_rpmbash_scanner_stats(TSRpmScannerStats *stats);
+
 #ifdef __cplusplus
 }
 #endif
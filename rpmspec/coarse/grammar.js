@@ -0,0 +1,67 @@
+/**
+ * @file Variant of the rpmspec grammar with coarse script lines
+ * @license MIT
+ *
+ * Consumers which parse scriptlets with rpmbash anyway have no use for the
+ * fine structure of script_line: the raw text between two macros is a
+ * script_content node of its own, and so is every literal percent. This
+ * variant keeps that text hidden, so a script_line only has the macros,
+ * conditionals and line continuations in it as children and a line
+ * without macros is a single node. Everything else is rpmspec unchanged,
+ * including the external scanner.
+ *
+ * The parser is generated into the build tree for benchmarks (see
+ * CMakeLists.txt); it is not part of the released grammar.
+ */
+
+/// <reference types="tree-sitter-cli/dsl" />
+// @ts-check
+
+const Rpmspec = require('../grammar');
+
+module.exports = grammar(Rpmspec, {
+    name: 'rpmspec_coarse',
+
+    rules: {
+        // Like rpmspec, with the text between the children hidden
+        script_line: ($) =>
+            prec.right(
+                seq(
+                    repeat1(
+                        choice(
+                            $.line_continuation, // Allow line continuation (backslash-newline)
+                            $._scriptlet_compound_statements, // Embedded conditionals
+                            $._macro_inline, // %{...}, %name, %(shell), %[expr]
+                            $._script_text // Raw text, escapes and literal %
+                        )
+                    ),
+                    /\n/ // Line terminator
+                )
+            ),
+
+        // Like rpmspec, without line continuation
+        _script_line_simple: ($) =>
+            prec.right(
+                seq(
+                    repeat1(
+                        choice(
+                            $._trailing_backslash, // Backslash at end of line
+                            $._macro_inline, // %{...}, %name, %(shell), %[expr]
+                            $._script_text // Raw text, escapes and literal %
+                        )
+                    ),
+                    /\n/ // Line terminator
+                )
+            ),
+
+        // script_content, _script_escape and _literal_percent in one token,
+        // so a run of them is one leaf
+        _script_text: (_) =>
+            token(
+                prec(
+                    -1,
+                    /([^%\\\r\n]|\\[^\r\n]|%[^%a-zA-Z_{\(\[\*#0-9!\? \t])+/
+                )
+            ),
+    },
+});
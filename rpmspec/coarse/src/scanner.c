@@ -0,0 +1,22 @@
+/**
+ * @file scanner.c
+ * @brief External scanner of the coarse rpmspec variant
+ *
+ * The variant keeps the externals of rpmspec in the same order, so it
+ * reuses the scanner under the names of its own language.
+ */
+
+#define tree_sitter_rpmspec_external_scanner_create                          \
+    tree_sitter_rpmspec_coarse_external_scanner_create
+#define tree_sitter_rpmspec_external_scanner_destroy                         \
+    tree_sitter_rpmspec_coarse_external_scanner_destroy
+#define tree_sitter_rpmspec_external_scanner_serialize                       \
+    tree_sitter_rpmspec_coarse_external_scanner_serialize
+#define tree_sitter_rpmspec_external_scanner_deserialize                     \
+    tree_sitter_rpmspec_coarse_external_scanner_deserialize
+#define tree_sitter_rpmspec_external_scanner_scan                            \
+    tree_sitter_rpmspec_coarse_external_scanner_scan
+#define tree_sitter_rpmspec_scanner_stats                                    \
+    tree_sitter_rpmspec_coarse_scanner_stats
+
+#include "../../src/scanner.c"
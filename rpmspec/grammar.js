@@ -118,6 +118,20 @@ function buildScriptlet(name, sectionToken) {
         );
 }
 
+/**
+ * The %if/%ifarch/%ifos family of scriptlet sections
+ *
+ * Its rules are written next to their top-level counterparts, so they are
+ * taken from this object one by one instead of being spread in one place,
+ * which keeps the symbol numbering of the generated parser.
+ */
+const SCRIPTLET_CONDITIONALS = makeConditionalRules(
+    '_scriptlet_',
+    'scriptlet_',
+    'scriptlet_',
+    ($) => $._scriptlet_conditional_content
+);
+
 /**
  * Main grammar definition for RPM spec files
  *
@@ -1359,23 +1373,12 @@ module.exports = grammar({
         else_clause: makeElseClause(($) => $._conditional_block),
 
         // Scriptlet-specific %if (uses _scriptlet_conditional_content for body)
-        _scriptlet_if_statement: makeIfStatement(
-            ($) => $.scriptlet_if,
-            ($) => $._scriptlet_conditional_content,
-            ($) => $.scriptlet_elif_clause,
-            ($) => $.scriptlet_else_clause,
-            true
-        ),
+        _scriptlet_if_statement:
+            SCRIPTLET_CONDITIONALS._scriptlet_if_statement,
 
-        scriptlet_elif_clause: makeElifClause(
-            ($) => $._scriptlet_conditional_content,
-            true
-        ),
+        scriptlet_elif_clause: SCRIPTLET_CONDITIONALS.scriptlet_elif_clause,
 
-        scriptlet_else_clause: makeElseClause(
-            ($) => $._scriptlet_conditional_content,
-            true
-        ),
+        scriptlet_else_clause: SCRIPTLET_CONDITIONALS.scriptlet_else_clause,
 
         // %ifarch
         // Architecture can be: identifier, %{macro}, or %macro (like %ix86)
@@ -1422,32 +1425,17 @@ module.exports = grammar({
         elifos_clause: makeElifosClause(($) => $._conditional_block),
 
         // Scriptlet-specific %ifarch (uses _scriptlet_conditional_content for body)
-        _scriptlet_ifarch_statement: makeIfarchStatement(
-            ($) => $.scriptlet_ifarch,
-            ($) => $.scriptlet_ifnarch,
-            ($) => $._scriptlet_conditional_content,
-            ($) => $.scriptlet_elifarch_clause,
-            ($) => $.scriptlet_else_clause
-        ),
+        _scriptlet_ifarch_statement:
+            SCRIPTLET_CONDITIONALS._scriptlet_ifarch_statement,
 
-        scriptlet_elifarch_clause: makeElifarchClause(
-            ($) => $._scriptlet_conditional_content,
-            true
-        ),
+        scriptlet_elifarch_clause:
+            SCRIPTLET_CONDITIONALS.scriptlet_elifarch_clause,
 
         // Scriptlet-specific %ifos (uses _scriptlet_conditional_content for body)
-        _scriptlet_ifos_statement: makeIfosStatement(
-            ($) => $.scriptlet_ifos,
-            ($) => $.scriptlet_ifnos,
-            ($) => $._scriptlet_conditional_content,
-            ($) => $.scriptlet_elifos_clause,
-            ($) => $.scriptlet_else_clause
-        ),
+        _scriptlet_ifos_statement:
+            SCRIPTLET_CONDITIONALS._scriptlet_ifos_statement,
 
-        scriptlet_elifos_clause: makeElifosClause(
-            ($) => $._scriptlet_conditional_content,
-            true
-        ),
+        scriptlet_elifos_clause: SCRIPTLET_CONDITIONALS.scriptlet_elifos_clause,
 
         // Files-specific compound statements (alias to regular names in parse tree)
         _files_compound_statements: ($) =>
@@ -1465,51 +1453,12 @@ module.exports = grammar({
                 choice($._files_compound_statements, $.defattr, $.file, $.files)
             ),
 
-        // Files-specific %if (uses _files_conditional_content for body)
-        _files_if_statement: makeIfStatement(
-            ($) => $.files_if,
-            ($) => $._files_conditional_content,
-            ($) => $.files_elif_clause,
-            ($) => $.files_else_clause,
-            true
-        ),
-
-        files_elif_clause: makeElifClause(
-            ($) => $._files_conditional_content,
-            true
-        ),
-
-        files_else_clause: makeElseClause(
-            ($) => $._files_conditional_content,
-            true
-        ),
-
-        // Files-specific %ifarch (uses _files_conditional_content for body)
-        _files_ifarch_statement: makeIfarchStatement(
-            ($) => $.files_ifarch,
-            ($) => $.files_ifnarch,
-            ($) => $._files_conditional_content,
-            ($) => $.files_elifarch_clause,
-            ($) => $.files_else_clause
-        ),
-
-        files_elifarch_clause: makeElifarchClause(
-            ($) => $._files_conditional_content,
-            true
-        ),
-
-        // Files-specific %ifos (uses _files_conditional_content for body)
-        _files_ifos_statement: makeIfosStatement(
-            ($) => $.files_ifos,
-            ($) => $.files_ifnos,
-            ($) => $._files_conditional_content,
-            ($) => $.files_elifos_clause,
-            ($) => $.files_else_clause
-        ),
-
-        files_elifos_clause: makeElifosClause(
-            ($) => $._files_conditional_content,
-            true
+        // Files-specific %if/%ifarch/%ifos (body is _files_conditional_content)
+        ...makeConditionalRules(
+            '_files_',
+            'files_',
+            'files_',
+            ($) => $._files_conditional_content
         ),
 
         ///////////////////////////////////////////////////////////////////////
@@ -2211,52 +2160,13 @@ module.exports = grammar({
                 )
             ),
 
-        // Subsection-specific %if (body contains text, not shell code)
+        // Subsection-specific %if/%ifarch/%ifos (body contains text, not shell code)
         // Used in %description, %package, %sourcelist, %patchlist
-        _description_if_statement: makeIfStatement(
-            ($) => $.subsection_if,
-            ($) => $._description_content,
-            ($) => $._description_elif_clause,
-            ($) => $._description_else_clause,
-            true
-        ),
-
-        _description_elif_clause: makeElifClause(
-            ($) => $._description_content,
-            true
-        ),
-
-        _description_else_clause: makeElseClause(
-            ($) => $._description_content,
-            true
-        ),
-
-        // Subsection-specific %ifarch
-        _description_ifarch_statement: makeIfarchStatement(
-            ($) => $.subsection_ifarch,
-            ($) => $.subsection_ifnarch,
-            ($) => $._description_content,
-            ($) => $._description_elifarch_clause,
-            ($) => $._description_else_clause
-        ),
-
-        _description_elifarch_clause: makeElifarchClause(
-            ($) => $._description_content,
-            true
-        ),
-
-        // Subsection-specific %ifos
-        _description_ifos_statement: makeIfosStatement(
-            ($) => $.subsection_ifos,
-            ($) => $.subsection_ifnos,
-            ($) => $._description_content,
-            ($) => $._description_elifos_clause,
-            ($) => $._description_else_clause
-        ),
-
-        _description_elifos_clause: makeElifosClause(
-            ($) => $._description_content,
-            true
+        ...makeConditionalRules(
+            '_description_',
+            '_description_',
+            'subsection_',
+            ($) => $._description_content
         ),
 
         // Package name for section headers and dependencies
@@ -2317,45 +2227,12 @@ module.exports = grammar({
                 )
             ),
 
-        // Shared %if for filelist sections
-        _filelist_if_statement: makeIfStatement(
-            ($) => $.subsection_if,
-            ($) => $._filelist_content,
-            ($) => $._filelist_elif_clause,
-            ($) => $._filelist_else_clause,
-            true
-        ),
-
-        _filelist_elif_clause: makeElifClause(($) => $._filelist_content, true),
-
-        _filelist_else_clause: makeElseClause(($) => $._filelist_content, true),
-
-        // Shared %ifarch for filelist sections
-        _filelist_ifarch_statement: makeIfarchStatement(
-            ($) => $.subsection_ifarch,
-            ($) => $.subsection_ifnarch,
-            ($) => $._filelist_content,
-            ($) => $._filelist_elifarch_clause,
-            ($) => $._filelist_else_clause
-        ),
-
-        _filelist_elifarch_clause: makeElifarchClause(
-            ($) => $._filelist_content,
-            true
-        ),
-
-        // Shared %ifos for filelist sections
-        _filelist_ifos_statement: makeIfosStatement(
-            ($) => $.subsection_ifos,
-            ($) => $.subsection_ifnos,
-            ($) => $._filelist_content,
-            ($) => $._filelist_elifos_clause,
-            ($) => $._filelist_else_clause
-        ),
-
-        _filelist_elifos_clause: makeElifosClause(
-            ($) => $._filelist_content,
-            true
+        // Shared %if/%ifarch/%ifos for filelist sections
+        ...makeConditionalRules(
+            '_filelist_',
+            '_filelist_',
+            'subsection_',
+            ($) => $._filelist_content
         ),
 
         // %sourcelist section: list of source files, one per line
@@ -2417,45 +2294,12 @@ module.exports = grammar({
                 )
             ),
 
-        // Package-specific %if (body contains preambles, not shell code)
-        _package_if_statement: makeIfStatement(
-            ($) => $.subsection_if,
-            ($) => $._package_content,
-            ($) => $._package_elif_clause,
-            ($) => $._package_else_clause,
-            true
-        ),
-
-        _package_elif_clause: makeElifClause(($) => $._package_content, true),
-
-        _package_else_clause: makeElseClause(($) => $._package_content, true),
-
-        // Package-specific %ifarch
-        _package_ifarch_statement: makeIfarchStatement(
-            ($) => $.subsection_ifarch,
-            ($) => $.subsection_ifnarch,
-            ($) => $._package_content,
-            ($) => $._package_elifarch_clause,
-            ($) => $._package_else_clause
-        ),
-
-        _package_elifarch_clause: makeElifarchClause(
-            ($) => $._package_content,
-            true
-        ),
-
-        // Package-specific %ifos
-        _package_ifos_statement: makeIfosStatement(
-            ($) => $.subsection_ifos,
-            ($) => $.subsection_ifnos,
-            ($) => $._package_content,
-            ($) => $._package_elifos_clause,
-            ($) => $._package_else_clause
-        ),
-
-        _package_elifos_clause: makeElifosClause(
-            ($) => $._package_content,
-            true
+        // Package-specific %if/%ifarch/%ifos (body contains preambles, not shell code)
+        ...makeConditionalRules(
+            '_package_',
+            '_package_',
+            'subsection_',
+            ($) => $._package_content
         ),
 
         ///////////////////////////////////////////////////////////////////////
@@ -3823,6 +3667,64 @@ function makeElseClause(contentRule, optionalContent = false) {
         );
 }
 
+/**
+ * Creates the %if/%ifarch/%ifos rule family of a nested context
+ *
+ * Every context below the top level has its own family, opened by the
+ * scanner tokens of the context, so that the branches only contain what
+ * the context allows. The families differ in names and content only:
+ * the content is optional in every branch, and %ifarch and %ifos share the
+ * %else clause of %if. The rules are returned in the order they used to be
+ * written in, so spreading them into the rules object keeps the symbol
+ * numbering of the generated parser.
+ *
+ * @param {string} statementPrefix - Prefix of the statement rules (e.g., '_files_')
+ * @param {string} clausePrefix - Prefix of the elif/else clause rules (e.g., 'files_')
+ * @param {string} tokenPrefix - Prefix of the scanner tokens (e.g., 'files_' for $.files_if)
+ * @param {function} contentRule - Function returning the content rule of the context
+ * @returns {object} The rules of the family, keyed by name
+ */
+function makeConditionalRules(
+    statementPrefix,
+    clausePrefix,
+    tokenPrefix,
+    contentRule
+) {
+    const tokenRule = (name) => ($) => $[tokenPrefix + name];
+    const clauseRule = (name) => ($) => $[clausePrefix + name];
+
+    return {
+        [statementPrefix + 'if_statement']: makeIfStatement(
+            tokenRule('if'),
+            contentRule,
+            clauseRule('elif_clause'),
+            clauseRule('else_clause'),
+            true
+        ),
+        [clausePrefix + 'elif_clause']: makeElifClause(contentRule, true),
+        [clausePrefix + 'else_clause']: makeElseClause(contentRule, true),
+        [statementPrefix + 'ifarch_statement']: makeIfarchStatement(
+            tokenRule('ifarch'),
+            tokenRule('ifnarch'),
+            contentRule,
+            clauseRule('elifarch_clause'),
+            clauseRule('else_clause')
+        ),
+        [clausePrefix + 'elifarch_clause']: makeElifarchClause(
+            contentRule,
+            true
+        ),
+        [statementPrefix + 'ifos_statement']: makeIfosStatement(
+            tokenRule('ifos'),
+            tokenRule('ifnos'),
+            contentRule,
+            clauseRule('elifos_clause'),
+            clauseRule('else_clause')
+        ),
+        [clausePrefix + 'elifos_clause']: makeElifosClause(contentRule, true),
+    };
+}
+
 /**
  * Creates a regex that matches any character EXCEPT the specified ones
  *
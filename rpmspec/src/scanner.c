@@ -22,17 +22,12 @@
 #include "tree_sitter/array.h"
 #include "tree_sitter/parser.h"
 
+#include "scanner_keywords.h"
+#include "scanner_stats.h"
+
 #include <ctype.h>
 #include <string.h>
 
-/**
- * @brief Maximum lines to scan ahead for section keywords
- *
- * This bounds the lookahead to avoid pathological cases with very large
- * conditional blocks. 2000 lines should cover most real-world specs.
- */
-#define MAX_LOOKAHEAD_LINES 2000
-
 /** @brief Get the number of elements in a static array */
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
@@ -112,169 +107,92 @@ enum TokenType {
 };
 
 /**
- * @brief Main scanner state structure
+ * @brief Bit of a token in the valid symbol fingerprint
  *
- * Contains cached lookahead results to avoid expensive repeated scans.
- * When parsing nested conditionals, we often need to scan ahead to check
- * if the block contains section keywords. Caching avoids re-scanning
- * the same content for each nested conditional.
+ * The scanner folds the valid_symbols array into one 64-bit word per call,
+ * so every context check afterwards is a single mask test.
  */
-struct Scanner {
-    bool lookahead_cache_valid; /**< Whether cached result is valid */
-    bool lookahead_has_section; /**< Cached result: found section keyword? */
-};
+#define TOKEN_BIT(token) ((uint64_t)1 << (token))
+
+/** @brief Top-level conditional tokens */
+#define VALID_TOP_LEVEL_CONDITIONALS                            \
+    (TOKEN_BIT(TOP_LEVEL_IF) | TOKEN_BIT(TOP_LEVEL_IFARCH) |    \
+     TOKEN_BIT(TOP_LEVEL_IFNARCH) | TOKEN_BIT(TOP_LEVEL_IFOS) | \
+     TOKEN_BIT(TOP_LEVEL_IFNOS))
+
+/** @brief Subsection conditional tokens */
+#define VALID_SUBSECTION_CONDITIONALS                             \
+    (TOKEN_BIT(SUBSECTION_IF) | TOKEN_BIT(SUBSECTION_IFARCH) |    \
+     TOKEN_BIT(SUBSECTION_IFNARCH) | TOKEN_BIT(SUBSECTION_IFOS) | \
+     TOKEN_BIT(SUBSECTION_IFNOS))
+
+/** @brief Scriptlet conditional tokens, valid inside shell sections */
+#define VALID_SCRIPTLET_CONDITIONALS                            \
+    (TOKEN_BIT(SCRIPTLET_IF) | TOKEN_BIT(SCRIPTLET_IFARCH) |    \
+     TOKEN_BIT(SCRIPTLET_IFNARCH) | TOKEN_BIT(SCRIPTLET_IFOS) | \
+     TOKEN_BIT(SCRIPTLET_IFNOS))
+
+/** @brief Files conditional tokens */
+#define VALID_FILES_CONDITIONALS                        \
+    (TOKEN_BIT(FILES_IF) | TOKEN_BIT(FILES_IFARCH) |    \
+     TOKEN_BIT(FILES_IFNARCH) | TOKEN_BIT(FILES_IFOS) | \
+     TOKEN_BIT(FILES_IFNOS))
+
+/** @brief Conditional tokens of all contexts */
+#define VALID_CONDITIONALS                                          \
+    (VALID_TOP_LEVEL_CONDITIONALS | VALID_SUBSECTION_CONDITIONALS | \
+     VALID_SCRIPTLET_CONDITIONALS | VALID_FILES_CONDITIONALS)
+
+/** @brief Scriptlet section tokens */
+#define VALID_SECTIONS                                                     \
+    (TOKEN_BIT(SECTION_PREP) | TOKEN_BIT(SECTION_GENERATE_BUILDREQUIRES) | \
+     TOKEN_BIT(SECTION_CONF) | TOKEN_BIT(SECTION_BUILD) |                  \
+     TOKEN_BIT(SECTION_INSTALL) | TOKEN_BIT(SECTION_CHECK) |               \
+     TOKEN_BIT(SECTION_CLEAN))
+
+/** @brief Tokens where the scanner consumes the '%' itself */
+#define VALID_PERCENT_TOKENS \
+    (VALID_CONDITIONALS | VALID_SECTIONS | TOKEN_BIT(PARAMETRIC_MACRO_NAME))
+
+/** @brief Macro tokens where the grammar matched the '%' */
+#define VALID_MACROS                                      \
+    (TOKEN_BIT(SIMPLE_MACRO) | TOKEN_BIT(NEGATED_MACRO) | \
+     TOKEN_BIT(SPECIAL_MACRO) | TOKEN_BIT(ESCAPED_PERCENT))
+
+/** @brief Raw content tokens inside %{expand:...} and %(...) */
+#define VALID_CONTENT (TOKEN_BIT(EXPAND_CODE) | TOKEN_BIT(SCRIPT_CODE))
 
 /**
- * @brief RPM spec keywords that should not be matched as simple macros
- *
- * These are reserved words that have special meaning in RPM specs.
- * The scanner must NOT match these as SIMPLE_MACRO tokens.
+ * @brief Main scanner state structure
  *
- * Note: Section keywords (prep, build, install, etc.) are in SECTION_KEYWORDS.
- * The is_keyword() function checks both arrays.
+ * The scanner is stateless: every token is decided from the input alone, so
+ * nothing is serialized and tree-sitter can reuse any subtree after an edit
+ * (see "Serialized Scanner State" in DESIGN.md). The payload only holds the
+ * instrumentation counters. Without them it is NULL and the structure is
+ * never defined.
  */
-static const char *const KEYWORDS[] = {
-    /* Conditionals */
-    "if",
-    "elif",
-    "else",
-    "endif",
-    "ifarch",
-    "ifnarch",
-    "elifarch",
-    "ifos",
-    "ifnos",
-    "elifos",
-    /* Definitions */
-    "define",
-    "global",
-    "undefine",
-    /* Special macros handled by grammar */
-    "setup",
-    "autosetup",
-    "patch",
-    "autopatch",
-    /* Builtin string macros */
-    "echo",
-    "error",
-    "expand",
-    "getenv",
-    "getncpus",
-    "len",
-    "lower",
-    "macrobody",
-    "quote",
-    "reverse",
-    "shescape",
-    "shrink",
-    "upper",
-    "verbose",
-    "warn",
-    /* Builtin path macros */
-    "basename",
-    "dirname",
-    "exists",
-    "load",
-    "suffix",
-    "uncompress",
-    /* Builtin URL macros */
-    "url2path",
-    "u2p",
-    /* Builtin multi-arg macros */
-    "gsub",
-    "sub",
-    "rep",
-    /* Builtin standalone macros */
-    "dnl",
-    "dump",
-    "rpmversion",
-    "trace",
-    /* Other builtins */
-    "expr",
-    "lua",
-    /* End marker */
-    NULL,
-};
+struct Scanner;
 
-/**
- * @brief Subsection keywords for metadata sections
- *
- * These define package metadata and don't contain shell code.
- */
-static const char *const SUBSECTION_KEYWORDS[] = {
-    "package",
-    "description",
-    "sourcelist",
-    "patchlist",
-    "changelog",
-    /* End marker */
-    NULL,
+#ifdef TREE_SITTER_SCANNER_STATS
+struct Scanner {
+    TSRpmScannerStats stats; /**< Instrumentation counters */
 };
+#endif
 
-/**
- * @brief Section keywords that indicate top-level context
- *
- * When a %if body contains any of these keywords, it should be
- * parsed as a top-level conditional, not a scriptlet-level one.
+/*
+ * Keywords are classified by keyword_lookup() from scanner_keywords.h, which
+ * is generated from scanner_keywords.txt by scripts/gen-scanner-keywords.py.
+ * One lookup returns all properties of an identifier as KW_* flags.
  */
-static const char *const SCRIPTLET_KEYWORDS[] = {
-    /* Main sections */
-    "prep",
-    "generate_buildrequires",
-    "conf",
-    "build",
-    "install",
-    "check",
-    "clean",
-    /* Runtime scriptlets */
-    "pre",
-    "post",
-    "preun",
-    "postun",
-    "pretrans",
-    "posttrans",
-    "preuntrans",
-    "postuntrans",
-    /* Triggers */
-    "triggerin",
-    "triggerun",
-    "triggerpostun",
-    "triggerprein",
-    /* File triggers */
-    "filetriggerin",
-    "filetriggerun",
-    "filetriggerpostun",
-    "transfiletriggerin",
-    "transfiletriggerun",
-    "transfiletriggerpostun",
-    /* End marker */
-    NULL,
-};
 
 /**
- * @brief File directive keywords that should only be blocked in %files context
+ * @brief Keywords that must not be matched as simple or parametric macros
  *
- * These keywords have special meaning in %files sections but can be valid
- * macro names in shell scriptlets. Only block them as SIMPLE_MACRO when
- * we're in a %files context.
+ * Reserved words and section keywords have special meaning in RPM specs and
+ * are handled by the grammar.
  */
-static const char *const FILES_KEYWORDS[] = {
-    "defattr",
-    "attr",
-    "config",
-    "doc",
-    "docdir",
-    "dir",
-    "license",
-    "verify",
-    "ghost",
-    "exclude",
-    "artifact",
-    "missingok",
-    "readme",
-    /* End marker */
-    NULL,
-};
+#define KW_MACRO_RESERVED \
+    (KW_RESERVED | KW_SUBSECTION | KW_SCRIPTLET | KW_FILES)
 
 /* ========================================================================== */
 /* HELPER FUNCTIONS                                                           */
@@ -332,31 +250,6 @@ static inline bool is_horizontal_space(int32_t c)
     return c == ' ' || c == '\t';
 }
 
-/**
- * @brief Check if identifier matches a literal string
- *
- * Compares a length-prefixed string against a null-terminated literal.
- * More readable than the raw (len == X && strncmp(...) == 0) pattern.
- *
- * @param literal The null-terminated string to compare against
- * @param id The identifier buffer (not null-terminated)
- * @param len Length of the identifier
- * @return true if they match, false otherwise
- */
-static inline bool strequal(const char *literal, const char *id, size_t len)
-{
-    size_t lit_len = strlen(literal);
-    return len == lit_len && strncmp(id, literal, lit_len) == 0;
-}
-
-/**
- * @brief Check if identifier is "nil" (special macro)
- */
-static inline bool is_nil(const char *id, size_t len)
-{
-    return strequal("nil", id, len);
-}
-
 /**
  * @brief Check if identifier is legacy patch macro (patchN where N is digits)
  *
@@ -379,74 +272,6 @@ static inline bool is_patch_legacy(const char *id, size_t len)
     return true;
 }
 
-/**
- * @brief Check if a string matches any keyword in an array
- *
- * @param str The string to check
- * @param len Length of the string
- * @param keywords NULL-terminated array of keywords
- * @return true if str matches a keyword, false otherwise
- */
-static bool
-matches_keyword_array(const char *str, size_t len, const char *const *keywords)
-{
-    for (const char *const *kw = keywords; *kw != NULL; kw++) {
-        size_t kw_len = strlen(*kw);
-        if (len == kw_len && strncmp(str, *kw, len) == 0) {
-            return true;
-        }
-    }
-    return false;
-}
-
-/**
- * @brief Check if a string matches a scriptlet keyword
- */
-static bool is_scriptlet_keyword(const char *str, size_t len)
-{
-    return matches_keyword_array(str, len, SCRIPTLET_KEYWORDS);
-}
-
-/**
- * @brief Check if a string matches a subsection keyword
- */
-static bool is_subsection_keyword(const char *str, size_t len)
-{
-    return matches_keyword_array(str, len, SUBSECTION_KEYWORDS);
-}
-
-/**
- * @brief Check if a string matches any section keyword
- */
-static bool is_section_keyword(const char *str, size_t len)
-{
-    return is_subsection_keyword(str, len) || is_scriptlet_keyword(str, len) ||
-           strequal("files", str, len);
-}
-
-/**
- * @brief Check if a string matches an RPM keyword (either regular or section)
- *
- * @param str The string to check
- * @param len Length of the string
- * @return true if str is a keyword, false otherwise
- */
-static bool is_keyword(const char *str, size_t len)
-{
-    return matches_keyword_array(str, len, KEYWORDS) ||
-           matches_keyword_array(str, len, SUBSECTION_KEYWORDS) ||
-           matches_keyword_array(str, len, SCRIPTLET_KEYWORDS) ||
-           strequal("files", str, len);
-}
-
-/**
- * @brief Check if a string matches a files directive keyword
- */
-static bool is_files_keyword(const char *str, size_t len)
-{
-    return matches_keyword_array(str, len, FILES_KEYWORDS);
-}
-
 /**
  * @brief Advances the lexer to the next character
  * @param lexer The Tree-sitter lexer instance
@@ -465,13 +290,18 @@ static inline void advance(TSLexer *lexer)
  *
  * This function reads characters until it finds:
  * - The closing } at depth 0 (end of expand macro)
- * - A % character (potential macro start - let grammar handle it)
+ * - A %{ (macro expansion - let grammar handle it)
  *
  * It tracks brace nesting depth to handle content like:
  *   %{expand: return {0:0, 11:+1}[c] }
  *
- * By stopping at %, macros inside expand content will be parsed
- * by the grammar and properly highlighted.
+ * By stopping at %{, macros inside expand content will be parsed
+ * by the grammar and properly highlighted. All other % sequences stay in
+ * the token, so a %{lua:...} body is one token per run between macros.
+ *
+ * Like matchchar() in rpm, a backslash escapes the next character, so \}
+ * does not end the body. rpm does not know Lua strings or long brackets,
+ * so neither does the scanner: a } in a Lua string ends the body for rpm.
  *
  * @param lexer The Tree-sitter lexer instance
  * @return true if content was successfully scanned, false otherwise
@@ -481,6 +311,10 @@ static bool scan_expand_content(TSLexer *lexer)
     int32_t brace_depth = 0;
     bool has_content = false;
 
+    /*
+     * The end is only marked where the token may stop, not after every
+     * character: before a %, and at the closing brace or EOF.
+     */
     while (!lexer->eof(lexer)) {
         switch (lexer->lookahead) {
         case '%':
@@ -489,7 +323,6 @@ static bool scan_expand_content(TSLexer *lexer)
             advance(lexer);
             if (lexer->eof(lexer)) {
                 /* Trailing % at EOF - include it */
-                lexer->mark_end(lexer);
                 has_content = true;
                 goto done;
             }
@@ -501,13 +334,12 @@ static bool scan_expand_content(TSLexer *lexer)
                 /* %%, %#, %* - consume as content (escaped or special macro) */
                 /* These will be re-evaluated after expand */
                 advance(lexer);
-                lexer->mark_end(lexer);
                 has_content = true;
                 continue;
             case '{':
                 /* %{ - real macro expansion, stop BEFORE the % */
                 /* mark_end was called before %, so token ends there */
-                goto done;
+                return has_content;
             case '0':
             case '1':
             case '2':
@@ -522,21 +354,26 @@ static bool scan_expand_content(TSLexer *lexer)
                 while (isdigit(lexer->lookahead)) {
                     advance(lexer);
                 }
-                lexer->mark_end(lexer);
                 has_content = true;
                 continue;
             default:
                 /* Other % sequences - include % and continue */
-                lexer->mark_end(lexer);
                 has_content = true;
                 continue;
             }
+        case '\\':
+            /* Escaped character, a brace after it doesn't nest */
+            advance(lexer);
+            if (!lexer->eof(lexer) && lexer->lookahead != '%') {
+                advance(lexer);
+            }
+            has_content = true;
+            continue;
         case '{':
             /* Nested opening brace - track depth */
             brace_depth++;
             has_content = true;
             advance(lexer);
-            lexer->mark_end(lexer);
             continue;
         case '}':
             if (brace_depth == 0) {
@@ -548,21 +385,17 @@ static bool scan_expand_content(TSLexer *lexer)
             brace_depth--;
             has_content = true;
             advance(lexer);
-            lexer->mark_end(lexer);
             continue;
         default:
             /* Any other character is part of the content */
             has_content = true;
             advance(lexer);
-            lexer->mark_end(lexer);
             continue;
         }
     }
 
 done:
-
-    /* Note: mark_end is called inline after consuming each character/sequence.
-     * This ensures we don't overwrite the mark set before %{ when we break. */
+    lexer->mark_end(lexer);
 
     return has_content;
 }
@@ -647,51 +480,113 @@ done:
 /* TOKEN SCANNERS                                                             */
 /* ========================================================================== */
 
-/** Function pointer type for keyword checking */
-typedef bool (*keyword_checker_fn)(const char *, size_t);
+/**
+ * @brief Keyword classes found by the conditional body lookahead
+ *
+ * The lookahead classifies every line-start keyword it passes, so one scan
+ * answers the questions of all conditional contexts.
+ */
+enum CondBodyClass {
+    COND_BODY_SUBSECTION = 1 << 0,     /**< %package, %description, ... */
+    COND_BODY_SCRIPTLET = 1 << 1,      /**< %prep, %build, %post, ... */
+    COND_BODY_FILES = 1 << 2,          /**< %files */
+    COND_BODY_FILE_DIRECTIVE = 1 << 3, /**< %doc, %config, %license, ... */
+    COND_BODY_CONDITIONAL = 1 << 4,    /**< Nested %if, %ifarch, %ifos */
+    COND_BODY_COMPLETE = 1 << 7, /**< Scanned up to matching %endif/EOF */
+};
+
+/** @brief Any section keyword: the body belongs to a top-level conditional */
+#define COND_BODY_SECTION \
+    (COND_BODY_SUBSECTION | COND_BODY_SCRIPTLET | COND_BODY_FILES)
 
 /**
- * @brief Lookahead to check if %if body contains matching keywords
+ * @brief Classify a keyword found at line start inside a conditional body
  *
- * Scans ahead until %endif, looking for keywords that match the checker.
- * Tracks conditional nesting to find the matching %endif.
+ * @param flags The KW_* flags of the identifier after '%'
+ * @return The COND_BODY_* class of the keyword, 0 if it has none
+ */
+static inline uint8_t classify_body_keyword(uint16_t flags)
+{
+    if (flags & KW_SUBSECTION) {
+        return COND_BODY_SUBSECTION;
+    }
+    if (flags & KW_SCRIPTLET) {
+        return COND_BODY_SCRIPTLET;
+    }
+    if (flags & KW_FILES) {
+        return COND_BODY_FILES;
+    }
+    if (flags & KW_FILE_DIRECTIVE) {
+        return COND_BODY_FILE_DIRECTIVE;
+    }
+    return 0;
+}
+
+/**
+ * @brief Advance the lexer during a lookahead past the end of the token
+ */
+static inline void lookahead_advance(struct Scanner *scanner, TSLexer *lexer)
+{
+    /* Only used by the counters, which may be compiled out */
+    (void)scanner;
+    SCANNER_STATS_INC(&scanner->stats, lookahead_chars);
+    lexer->advance(lexer, false);
+}
+
+/**
+ * @brief Lookahead to classify the keywords inside a %if body
+ *
+ * Scans ahead until the matching %endif and collects the classes of all
+ * line-start keywords on the way. Tracks conditional nesting to find the
+ * matching %endif.
+ *
+ * The scan stops early once a class in @p wanted was found, since the
+ * caller's decision is settled then. Otherwise it runs to the matching
+ * %endif and sets COND_BODY_COMPLETE, which means the result answers every
+ * other question about this body as well.
+ *
+ * The scan is not bounded by a line count: a body is only classified
+ * correctly if it is read up to its matching %endif, and generated specs
+ * easily contain conditionals spanning thousands of lines. Without a
+ * matching %endif the scan ends at EOF.
  *
+ * @param scanner Scanner state (for instrumentation counters)
  * @param lexer The Tree-sitter lexer (position will be restored)
- * @param checker Function to check if a keyword matches
- * @return true if the body contains matching keywords, false otherwise
+ * @param wanted COND_BODY_* classes that end the scan early
+ * @return Bitmask of COND_BODY_* classes found in the body
  */
-static bool conditional_body_has_keyword(TSLexer *lexer,
-                                         keyword_checker_fn checker)
+static uint8_t conditional_body_classify(struct Scanner *scanner,
+                                         TSLexer *lexer,
+                                         uint8_t wanted)
 {
     /* Track nesting depth of conditionals */
     int32_t nesting = 1; /* We're already inside one %if */
-    int32_t lines_scanned = 0;
     bool at_line_start = true;
+    uint8_t classes = 0;
 
-    /* Scan character by character, looking for matching keywords */
-    while (!lexer->eof(lexer) && lines_scanned < MAX_LOOKAHEAD_LINES) {
+    /* Scan character by character, classifying line-start keywords */
+    while (!lexer->eof(lexer)) {
         int32_t c = lexer->lookahead;
 
         if (c == '\r' || c == '\n') {
             /* Newline - next character is at line start */
-            lexer->advance(lexer, false);
+            lookahead_advance(scanner, lexer);
             if (c == '\r' && lexer->lookahead == '\n') {
-                lexer->advance(lexer, false);
+                lookahead_advance(scanner, lexer);
             }
             at_line_start = true;
-            lines_scanned++;
             continue;
         }
 
         if (c == ' ' || c == '\t') {
             /* Whitespace at line start - still at line start */
-            lexer->advance(lexer, false);
+            lookahead_advance(scanner, lexer);
             continue;
         }
 
         if (c == '%' && at_line_start) {
             /* Potential keyword at line start */
-            lexer->advance(lexer, false);
+            lookahead_advance(scanner, lexer);
 
             /* Buffer the identifier */
             char id_buf[32];
@@ -700,64 +595,44 @@ static bool conditional_body_has_keyword(TSLexer *lexer,
             while (is_identifier_char(lexer->lookahead) &&
                    id_len < sizeof(id_buf) - 1) {
                 id_buf[id_len++] = (char)lexer->lookahead;
-                lexer->advance(lexer, false);
+                lookahead_advance(scanner, lexer);
             }
             id_buf[id_len] = '\0';
 
             if (id_len > 0) {
+                uint16_t flags = keyword_lookup(id_buf, id_len).flags;
+
                 /* Check for %endif (end of conditional) */
-                if (strequal("endif", id_buf, id_len)) {
+                if (flags & KW_ENDIF) {
                     nesting--;
                     if (nesting == 0) {
-                        /* Found matching %endif - no matching keywords found */
-                        return false;
+                        /* Found matching %endif - body fully classified */
+                        return classes | COND_BODY_COMPLETE;
                     }
                 }
                 /* Check for nested %if/%ifarch/%ifos */
-                else if (strequal("if", id_buf, id_len) ||
-                         strequal("ifarch", id_buf, id_len) ||
-                         strequal("ifnarch", id_buf, id_len) ||
-                         strequal("ifos", id_buf, id_len) ||
-                         strequal("ifnos", id_buf, id_len)) {
+                else if (flags & KW_CONDITIONAL) {
                     nesting++;
-                }
-                /* Check using the provided checker function */
-                else if (checker(id_buf, id_len)) {
-                    return true;
+                    SCANNER_STATS_MAX(
+                        &scanner->stats, max_lookahead_depth, nesting);
+                    classes |= COND_BODY_CONDITIONAL;
+                } else {
+                    classes |= classify_body_keyword(flags);
+                    if (classes & wanted) {
+                        return classes;
+                    }
                 }
             }
             at_line_start = false;
         } else {
             /* Other character - not at line start anymore */
             at_line_start = false;
-            lexer->advance(lexer, false);
+            lookahead_advance(scanner, lexer);
         }
     }
 
-    /* Reached EOF or max lines without finding matching keyword */
-    return false;
-}
-
-/**
- * @brief Lookahead to check if %if body contains section keywords
- *
- * Used to determine if a conditional inside a scriptlet is top-level
- * (contains sections like %files, %package) or scriptlet-level.
- */
-static bool conditional_body_has_section(TSLexer *lexer)
-{
-    return conditional_body_has_keyword(lexer, is_section_keyword);
-}
-
-/**
- * @brief Lookahead to check if %if body contains scriptlet keywords
- *
- * Used inside %files sections to determine if a conditional should exit
- * files context. %files can contain nested %files but not scriptlets.
- */
-static bool conditional_body_has_scriptlet(TSLexer *lexer)
-{
-    return conditional_body_has_keyword(lexer, is_scriptlet_keyword);
+    /* Reached EOF - everything up to here is classified */
+    return classes | COND_BODY_COMPLETE;
 }
 
 /**
@@ -772,10 +647,10 @@ static bool conditional_body_has_scriptlet(TSLexer *lexer)
  * - *, **, #, 0-9, nil for special macros - returns SPECIAL_MACRO
  *
  * @param lexer The Tree-sitter lexer instance
- * @param valid_symbols Array indicating which token types are valid
+ * @param valid Fingerprint of the valid tokens
  * @return true if a macro token was matched, false otherwise
  */
-static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
+static bool scan_macro(TSLexer *lexer, uint64_t valid)
 {
     int32_t c = lexer->lookahead;
 
@@ -785,7 +660,7 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
     switch (c) {
     case '%':
         /* Second % for escaped percent (%%) */
-        if (valid_symbols[ESCAPED_PERCENT]) {
+        if (valid & TOKEN_BIT(ESCAPED_PERCENT)) {
             advance(lexer);
             lexer->mark_end(lexer);
             lexer->result_symbol = ESCAPED_PERCENT;
@@ -795,7 +670,7 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
 
     case '!':
         /* !name for negated macro */
-        if (!valid_symbols[NEGATED_MACRO]) {
+        if (!(valid & TOKEN_BIT(NEGATED_MACRO))) {
             return false;
         }
         advance(lexer);
@@ -817,7 +692,7 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
 
     case '*':
         /* * or ** for special macro */
-        if (!valid_symbols[SPECIAL_MACRO]) {
+        if (!(valid & TOKEN_BIT(SPECIAL_MACRO))) {
             return false;
         }
         advance(lexer);
@@ -830,7 +705,7 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
 
     case '#':
         /* # for argument count */
-        if (!valid_symbols[SPECIAL_MACRO]) {
+        if (!(valid & TOKEN_BIT(SPECIAL_MACRO))) {
             return false;
         }
         advance(lexer);
@@ -841,7 +716,7 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
     default:
         /* Check for 0-9 (positional args) */
         if (isdigit(c)) {
-            if (!valid_symbols[SPECIAL_MACRO]) {
+            if (!(valid & TOKEN_BIT(SPECIAL_MACRO))) {
                 return false;
             }
             /* Consume all digits */
@@ -855,7 +730,7 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
 
         /* Check for identifier (simple macro) */
         if (is_identifier_start(c)) {
-            if (!valid_symbols[SIMPLE_MACRO]) {
+            if (!(valid & TOKEN_BIT(SIMPLE_MACRO))) {
                 return false;
             }
 
@@ -877,8 +752,10 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
             id_buf[id_len < sizeof(id_buf) ? id_len : sizeof(id_buf) - 1] =
                 '\0';
 
+            uint16_t flags = keyword_lookup(id_buf, id_len).flags;
+
             /* Check if it's a keyword - if so, don't match */
-            if (is_keyword(id_buf, id_len)) {
+            if (flags & KW_MACRO_RESERVED) {
                 return false;
             }
 
@@ -889,8 +766,8 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
             }
 
             /* Check if it's "nil" - special macro, not simple macro */
-            if (is_nil(id_buf, id_len)) {
-                if (valid_symbols[SPECIAL_MACRO]) {
+            if (flags & KW_NIL) {
+                if (valid & TOKEN_BIT(SPECIAL_MACRO)) {
                     lexer->mark_end(lexer);
                     lexer->result_symbol = SPECIAL_MACRO;
                     return true;
@@ -909,21 +786,30 @@ static bool scan_macro(TSLexer *lexer, const bool *valid_symbols)
 }
 
 /**
- * @brief Check for section keywords with caching
+ * @brief Classify the conditional body and count the lookahead
+ *
+ * The result is not kept: the next conditional starts at a different
+ * position, and nothing but the input may decide a token.
  *
- * Uses cached result if available, otherwise performs lookahead and caches.
+ * @param scanner Scanner state (for instrumentation counters)
+ * @param lexer Lexer for lookahead
+ * @param wanted COND_BODY_* classes the caller decides on
+ * @return Bitmask of COND_BODY_* classes found in the body
  */
-static bool conditional_body_has_section_cached(struct Scanner *scanner,
-                                                TSLexer *lexer)
+static uint8_t conditional_body_lookahead(struct Scanner *scanner,
+                                          TSLexer *lexer,
+                                          uint8_t wanted)
 {
-    if (scanner->lookahead_cache_valid) {
-        return scanner->lookahead_has_section;
-    }
-
-    bool result = conditional_body_has_section(lexer);
-    scanner->lookahead_cache_valid = true;
-    scanner->lookahead_has_section = result;
-    return result;
+#ifdef TREE_SITTER_SCANNER_STATS
+    uint64_t chars = scanner->stats.lookahead_chars;
+#endif
+    uint8_t classes = conditional_body_classify(scanner, lexer, wanted);
+
+    SCANNER_STATS_INC(&scanner->stats, lookahead_calls);
+    SCANNER_STATS_MAX(&scanner->stats,
+                      max_lookahead_chars,
+                      scanner->stats.lookahead_chars - chars);
+    return classes;
 }
 
 /**
@@ -948,7 +834,6 @@ struct CondTokens {
  * @brief Conditional keyword definition for table-driven lookup
  */
 struct CondKeyword {
-    const char *name;          /**< Keyword name (e.g., "if", "ifarch") */
     enum TokenType top;        /**< Top-level token for this keyword */
     enum TokenType subsection; /**< Subsection token for this keyword */
     enum TokenType scriptlet;  /**< Scriptlet token for this keyword */
@@ -957,23 +842,22 @@ struct CondKeyword {
 
 /**
  * @brief Table of conditional keywords and their tokens
+ *
+ * Indexed by KeywordInfo.index of the CONDITIONAL keywords, in the order of
+ * scanner_keywords.txt.
  */
 static const struct CondKeyword COND_KEYWORDS[] = {
-    {"if", TOP_LEVEL_IF, SUBSECTION_IF, SCRIPTLET_IF, FILES_IF},
-    {"ifarch",
-     TOP_LEVEL_IFARCH,
-     SUBSECTION_IFARCH,
-     SCRIPTLET_IFARCH,
-     FILES_IFARCH},
-    {"ifnarch",
-     TOP_LEVEL_IFNARCH,
-     SUBSECTION_IFNARCH,
-     SCRIPTLET_IFNARCH,
-     FILES_IFNARCH},
-    {"ifos", TOP_LEVEL_IFOS, SUBSECTION_IFOS, SCRIPTLET_IFOS, FILES_IFOS},
-    {"ifnos", TOP_LEVEL_IFNOS, SUBSECTION_IFNOS, SCRIPTLET_IFNOS, FILES_IFNOS},
+    /* %if */
+    {TOP_LEVEL_IF, SUBSECTION_IF, SCRIPTLET_IF, FILES_IF},
+    /* %ifarch */
+    {TOP_LEVEL_IFARCH, SUBSECTION_IFARCH, SCRIPTLET_IFARCH, FILES_IFARCH},
+    /* %ifnarch */
+    {TOP_LEVEL_IFNARCH, SUBSECTION_IFNARCH, SCRIPTLET_IFNARCH, FILES_IFNARCH},
+    /* %ifos */
+    {TOP_LEVEL_IFOS, SUBSECTION_IFOS, SCRIPTLET_IFOS, FILES_IFOS},
+    /* %ifnos */
+    {TOP_LEVEL_IFNOS, SUBSECTION_IFNOS, SCRIPTLET_IFNOS, FILES_IFNOS},
 };
-#define NUM_COND_KEYWORDS ARRAY_SIZE(COND_KEYWORDS)
 
 /**
  * @brief Select which context token to emit
@@ -983,7 +867,7 @@ static const struct CondKeyword COND_KEYWORDS[] = {
  * 2. Exclusive context - only one of subsection/scriptlet/top is valid
  * 3. Ambiguous (top + other) - use lookahead to decide
  *
- * @param scanner Scanner state for caching
+ * @param scanner Scanner state (for instrumentation counters)
  * @param lexer Lexer for lookahead
  * @param ctx Context tokens and validity
  * @return The token to emit
@@ -1007,8 +891,9 @@ select_conditional_token_type(struct Scanner *scanner,
      * conditionals (e.g., %if %{with x} ... %files subpkg ... %endif).
      */
     if (ctx->files_valid && ctx->top_valid) {
-        bool has_scriptlet = conditional_body_has_scriptlet(lexer);
-        if (has_scriptlet) {
+        uint8_t classes =
+            conditional_body_lookahead(scanner, lexer, COND_BODY_SCRIPTLET);
+        if (classes & COND_BODY_SCRIPTLET) {
             /* Body contains scriptlet - use top-level */
             return ctx->top;
         }
@@ -1028,22 +913,19 @@ select_conditional_token_type(struct Scanner *scanner,
 
     /* Only scriptlet is valid */
     if (ctx->scriptlet_valid && !ctx->top_valid && !ctx->subsection_valid) {
-        scanner->lookahead_cache_valid = false;
         return ctx->scriptlet;
     }
 
     /* Only top-level is valid */
     if (ctx->top_valid && !ctx->subsection_valid && !ctx->scriptlet_valid) {
-        scanner->lookahead_cache_valid = false;
         return ctx->top;
     }
 
     /* Ambiguous: top + subsection or top + scriptlet - use lookahead */
     if (ctx->top_valid && (ctx->subsection_valid || ctx->scriptlet_valid)) {
-        bool has_section = conditional_body_has_section_cached(scanner, lexer);
-        /* Invalidate cache for next conditional */
-        scanner->lookahead_cache_valid = false;
-        if (has_section) {
+        uint8_t classes =
+            conditional_body_lookahead(scanner, lexer, COND_BODY_SECTION);
+        if (classes & COND_BODY_SECTION) {
             /* Body contains sections - use top-level */
             return ctx->top;
         }
@@ -1061,158 +943,65 @@ select_conditional_token_type(struct Scanner *scanner,
     return ctx->top;
 }
 
-/**
- * @brief Check if any conditional token is valid in the current context
- *
- * @param valid_symbols Array indicating which token types are valid
- * @return true if at least one conditional token is valid
- */
-static bool any_conditional_valid(const bool *valid_symbols)
-{
-    for (size_t i = 0; i < NUM_COND_KEYWORDS; i++) {
-        const struct CondKeyword *kw = &COND_KEYWORDS[i];
-        if (valid_symbols[kw->top] || valid_symbols[kw->subsection] ||
-            valid_symbols[kw->scriptlet] || valid_symbols[kw->files]) {
-            return true;
-        }
-    }
-    return false;
-}
-
 /* ========================================================================== */
 /* SCRIPTLET SECTION SCAN LOGIC                                               */
 /* ========================================================================== */
 
 /**
- * @brief Check if any scriptlet section token is valid
- */
-static inline bool any_section_token_valid(const bool *valid_symbols)
-{
-    return valid_symbols[SECTION_PREP] ||
-           valid_symbols[SECTION_GENERATE_BUILDREQUIRES] ||
-           valid_symbols[SECTION_CONF] || valid_symbols[SECTION_BUILD] ||
-           valid_symbols[SECTION_INSTALL] || valid_symbols[SECTION_CHECK] ||
-           valid_symbols[SECTION_CLEAN];
-}
-
-/**
- * @brief Check if we're inside a scriptlet context
+ * @brief Scriptlet section tokens
  *
- * Returns true if any scriptlet-specific conditional token is valid,
- * indicating we're inside a scriptlet section like %build, %install, etc.
- * In scriptlet context, parametric macros should NOT match because we
- * want shell semantics (macros expand inline, rest is shell arguments).
+ * Indexed by KeywordInfo.index of the SECTION_TOKEN keywords, in the order
+ * of scanner_keywords.txt.
  */
-static inline bool in_scriptlet_context(const bool *valid_symbols)
-{
-    return valid_symbols[SCRIPTLET_IF] || valid_symbols[SCRIPTLET_IFARCH] ||
-           valid_symbols[SCRIPTLET_IFNARCH] || valid_symbols[SCRIPTLET_IFOS] ||
-           valid_symbols[SCRIPTLET_IFNOS];
-}
-
-/**
- * @brief Scriptlet section keyword to token mapping
- */
-struct SectionKeyword {
-    const char *name;
-    size_t len;
-    enum TokenType token;
-};
-
-static const struct SectionKeyword SECTION_KEYWORDS_MAP[] = {
-    {"prep", 4, SECTION_PREP},
-    {"generate_buildrequires", 22, SECTION_GENERATE_BUILDREQUIRES},
-    {"conf", 4, SECTION_CONF},
-    {"build", 5, SECTION_BUILD},
-    {"install", 7, SECTION_INSTALL},
-    {"check", 5, SECTION_CHECK},
-    {"clean", 5, SECTION_CLEAN},
-    {NULL, 0, 0} /* End marker */
+static const enum TokenType SECTION_TOKENS[] = {
+    SECTION_PREP,
+    SECTION_GENERATE_BUILDREQUIRES,
+    SECTION_CONF,
+    SECTION_BUILD,
+    SECTION_INSTALL,
+    SECTION_CHECK,
+    SECTION_CLEAN,
 };
 
-/**
- * @brief Look up a section keyword and return its token type
- *
- * @param id The identifier to look up
- * @param len Length of the identifier
- * @return Pointer to matching SectionKeyword, or NULL if not found
- */
-static const struct SectionKeyword *lookup_section_keyword(const char *id,
-                                                           size_t len)
-{
-    for (const struct SectionKeyword *kw = SECTION_KEYWORDS_MAP;
-         kw->name != NULL;
-         kw++) {
-        if (strequal(kw->name, id, len)) {
-            return kw;
-        }
-    }
-    return NULL;
-}
-
 /* ========================================================================== */
 /* MAIN SCAN LOGIC                                                            */
 /* ========================================================================== */
 
-/**
- * @brief Check if identifier is a conditional keyword
- */
-static bool is_cond_keyword(const char *id, size_t len)
-{
-    for (size_t i = 0; i < NUM_COND_KEYWORDS; i++) {
-        if (strequal(COND_KEYWORDS[i].name, id, len)) {
-            return true;
-        }
-    }
-    return false;
-}
-
 /**
  * @brief Try to match a conditional keyword token
  *
  * @param scanner The scanner state
  * @param lexer The lexer
- * @param valid_symbols Valid token types
- * @param keyword The keyword that was peeked
- * @param keyword_len Length of the keyword
+ * @param valid Fingerprint of the valid tokens
+ * @param info The classification of the peeked keyword (KW_CONDITIONAL)
  * @return true if a conditional token was matched
  */
 static bool try_scan_conditional(struct Scanner *scanner,
                                  TSLexer *lexer,
-                                 const bool *valid_symbols,
-                                 const char *keyword,
-                                 size_t keyword_len)
+                                 uint64_t valid,
+                                 const struct KeywordInfo *info)
 {
-    for (size_t i = 0; i < NUM_COND_KEYWORDS; i++) {
-        const struct CondKeyword *kw = &COND_KEYWORDS[i];
-
-        if (!strequal(kw->name, keyword, keyword_len)) {
-            continue;
-        }
-
-        struct CondTokens ctx = {
-            .top = kw->top,
-            .subsection = kw->subsection,
-            .scriptlet = kw->scriptlet,
-            .files = kw->files,
-            .top_valid = valid_symbols[kw->top],
-            .subsection_valid = valid_symbols[kw->subsection],
-            .scriptlet_valid = valid_symbols[kw->scriptlet],
-            .files_valid = valid_symbols[kw->files],
-        };
-
-        if (!ctx.top_valid && !ctx.subsection_valid && !ctx.scriptlet_valid &&
-            !ctx.files_valid) {
-            return false;
-        }
-
-        lexer->mark_end(lexer);
-        lexer->result_symbol =
-            select_conditional_token_type(scanner, lexer, &ctx);
-        return true;
+    const struct CondKeyword *kw = &COND_KEYWORDS[info->index];
+
+    struct CondTokens ctx = {
+        .top = kw->top,
+        .subsection = kw->subsection,
+        .scriptlet = kw->scriptlet,
+        .files = kw->files,
+        .top_valid = (valid & TOKEN_BIT(kw->top)) != 0,
+        .subsection_valid = (valid & TOKEN_BIT(kw->subsection)) != 0,
+        .scriptlet_valid = (valid & TOKEN_BIT(kw->scriptlet)) != 0,
+        .files_valid = (valid & TOKEN_BIT(kw->files)) != 0,
+    };
+
+    if (!ctx.top_valid && !ctx.subsection_valid && !ctx.scriptlet_valid &&
+        !ctx.files_valid) {
+        return false;
     }
 
-    return false;
+    lexer->mark_end(lexer);
+    lexer->result_symbol = select_conditional_token_type(scanner, lexer, &ctx);
+    return true;
 }
 
 /**
@@ -1224,12 +1013,14 @@ static bool try_scan_conditional(struct Scanner *scanner,
  *
  * @param lexer The lexer
  * @param allow_parametric Whether parametric macros are allowed in this context
+ * @param info The classification of the peeked keyword
  * @param keyword The keyword that was peeked
  * @param keyword_len Length of the keyword
  * @return true if a parametric macro token was matched
  */
 static bool try_scan_parametric_macro(TSLexer *lexer,
                                       bool allow_parametric,
+                                      const struct KeywordInfo *info,
                                       const char *keyword,
                                       size_t keyword_len)
 {
@@ -1238,9 +1029,8 @@ static bool try_scan_parametric_macro(TSLexer *lexer,
     }
 
     /* Exclude reserved keywords and file directive keywords */
-    if (is_keyword(keyword, keyword_len) ||
-        is_files_keyword(keyword, keyword_len) ||
-        is_patch_legacy(keyword, keyword_len) || is_nil(keyword, keyword_len)) {
+    if ((info->flags & (KW_MACRO_RESERVED | KW_FILE_DIRECTIVE | KW_NIL)) ||
+        is_patch_legacy(keyword, keyword_len)) {
         return false;
     }
 
@@ -1326,191 +1116,164 @@ static void skip_leading_whitespace(TSLexer *lexer)
 }
 
 /**
- * @brief Main scanning function for RPM spec tokens
- *
- * This is the primary entry point for external token recognition. It handles
- * tokens that cannot be expressed in the grammar DSL alone, such as tokens
- * requiring keyword exclusion, context-aware lookahead, or balanced delimiter
- * tracking.
+ * @brief Check if character is whitespace (space, tab, newline, ...)
  *
- * Token categories (in priority order):
- *
- * 1. **Percent-prefixed tokens** (conditionals, parametric macros)
- *    Scanner consumes the '%' as part of the token:
- *    - Conditionals: `%if`, `%ifarch`, `%else`, `%endif`, etc.
- *    - Parametric macros: `%configure --prefix=/usr` (only at line start)
- *
- *    These require peeking at the keyword after '%' to route correctly.
- *    Conditionals have priority over parametric macros.
- *    MUST be checked first so section keywords are recognized during
- *    error recovery.
+ * ASCII-only replacement for isspace(), which costs a locale table lookup
+ * per character and is undefined for code points above 255.
+ */
+static inline bool is_space(int32_t c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * @brief Handle newlines for line-sensitive contexts
  *
- * 2. **Simple macro tokens** (SIMPLE_MACRO, NEGATED_MACRO, etc.)
- *    Grammar handles '%', scanner matches the identifier:
- *    - `%name` -> grammar matches '%', scanner matches 'name'
- *    - `%{name}` -> handled entirely by grammar
+ * When the grammar expects a newline (NEWLINE is valid), we emit the
+ * NEWLINE token to give it priority over extras.
  *
- * 3. **Contextual tokens** (EXPAND_CODE, SCRIPT_CODE)
- *    Only valid inside specific constructs:
- *    - EXPAND_CODE: inside `%{expand:...}`
- *    - SCRIPT_CODE: inside `%(...)`
+ * When the grammar doesn't expect a newline, skip them as whitespace.
+ * This ensures newlines are consumed as extras in contexts where they
+ * don't matter (like between statements).
  *
- *    These are checked LAST because they are greedy and would consume
- *    section keywords during error recovery if checked earlier.
+ * IMPORTANT: Don't call this when content tokens (EXPAND_CODE, SCRIPT_CODE)
+ * are valid - they need to capture whitespace as content.
  *
- * @param scanner The scanner state (for lookahead caching)
  * @param lexer The tree-sitter lexer
- * @param valid_symbols Array indicating which tokens are valid at this position
- * @return true if a token was matched, false otherwise
+ * @param valid Fingerprint of the valid tokens
+ * @return true if a NEWLINE token was emitted, false if whitespace was skipped
  */
-static inline bool
-rpmspec_scan(struct Scanner *scanner, TSLexer *lexer, const bool *valid_symbols)
+static inline bool scan_newline(TSLexer *lexer, uint64_t valid)
 {
-    /*
-     * 0. Handle newlines for line-sensitive contexts
-     *
-     * When the grammar expects a newline (valid_symbols[NEWLINE] is true),
-     * we emit the NEWLINE token to give it priority over extras.
-     *
-     * When the grammar doesn't expect a newline, skip them as whitespace.
-     * This ensures newlines are consumed as extras in contexts where they
-     * don't matter (like between statements).
-     *
-     * IMPORTANT: Don't skip whitespace when content tokens (EXPAND_CODE,
-     * SCRIPT_CODE) are valid - they need to capture whitespace as content.
-     */
-    if (!valid_symbols[EXPAND_CODE] && !valid_symbols[SCRIPT_CODE]) {
-        while (isspace(lexer->lookahead)) {
-            if (lexer->lookahead == '\n') {
-                if (valid_symbols[NEWLINE]) {
-                    /* Emit newline token */
-                    lexer->advance(lexer, false);
-                    lexer->mark_end(lexer);
-                    lexer->result_symbol = NEWLINE;
-                    return true;
-                }
-                /* Skip newline as whitespace */
-            } else if (lexer->lookahead == '\r') {
-                if (valid_symbols[NEWLINE]) {
-                    /* Handle \r\n or just \r */
+    while (is_space(lexer->lookahead)) {
+        if (lexer->lookahead == '\n') {
+            if (valid & TOKEN_BIT(NEWLINE)) {
+                /* Emit newline token */
+                lexer->advance(lexer, false);
+                lexer->mark_end(lexer);
+                lexer->result_symbol = NEWLINE;
+                return true;
+            }
+            /* Skip newline as whitespace */
+        } else if (lexer->lookahead == '\r') {
+            if (valid & TOKEN_BIT(NEWLINE)) {
+                /* Handle \r\n or just \r */
+                lexer->advance(lexer, false);
+                if (lexer->lookahead == '\n') {
                     lexer->advance(lexer, false);
-                    if (lexer->lookahead == '\n') {
-                        lexer->advance(lexer, false);
-                    }
-                    lexer->mark_end(lexer);
-                    lexer->result_symbol = NEWLINE;
-                    return true;
                 }
-                /* Skip carriage return as whitespace */
+                lexer->mark_end(lexer);
+                lexer->result_symbol = NEWLINE;
+                return true;
             }
-            lexer->advance(lexer, true); /* skip */
+            /* Skip carriage return as whitespace */
         }
+        lexer->advance(lexer, true); /* skip */
     }
 
+    return false;
+}
+
+/**
+ * @brief Scan percent-prefixed tokens - the scanner handles the '%'
+ *
+ * This handles:
+ * - Conditionals (%if, %else, etc.)
+ * - Parametric macros (%configure)
+ * - Scriptlet sections (%prep, %build, %conf, etc.)
+ *
+ * Section tokens are checked here (not separately) to prevent %conf
+ * from matching %configure. We consume %identifier once, then check
+ * in order: conditionals, sections, parametric macros.
+ *
+ * @param scanner The scanner state (for instrumentation counters)
+ * @param lexer The tree-sitter lexer
+ * @param valid Fingerprint of the valid tokens
+ * @return true if a token was matched, false otherwise
+ */
+static bool
+scan_percent_tokens(struct Scanner *scanner, TSLexer *lexer, uint64_t valid)
+{
     /*
-     * 1. Percent-prefixed tokens - scanner handles the '%'
+     * Determine if parametric macros should match in this context.
      *
-     * This handles:
-     * - Conditionals (%if, %else, etc.)
-     * - Parametric macros (%configure)
-     * - Scriptlet sections (%prep, %build, %conf, etc.)
+     * In scriptlet context (inside %build, %install, etc.), we use shell
+     * semantics: macros expand inline and the rest is shell arguments.
+     *   %gobuild -o foo bar   <- %gobuild is simple, "-o foo bar" is shell
      *
-     * Section tokens are checked here (not separately) to prevent %conf
-     * from matching %configure. We consume %identifier once, then check
-     * in order: conditionals, sections, parametric macros.
+     * Outside scriptlet context (top-level, inside %ifarch, etc.), we use
+     * macro semantics: the macro consumes arguments.
+     *   %bcond_without luajit <- %bcond_without is parametric with arg
      */
-    bool conditionals_valid = any_conditional_valid(valid_symbols);
-    bool parametric_valid = valid_symbols[PARAMETRIC_MACRO_NAME];
-    bool sections_valid = any_section_token_valid(valid_symbols);
-
-    if (conditionals_valid || parametric_valid || sections_valid) {
-        /*
-         * Determine if parametric macros should match in this context.
-         *
-         * In scriptlet context (inside %build, %install, etc.), we use shell
-         * semantics: macros expand inline and the rest is shell arguments.
-         *   %gobuild -o foo bar   <- %gobuild is simple, "-o foo bar" is shell
-         *
-         * Outside scriptlet context (top-level, inside %ifarch, etc.), we use
-         * macro semantics: the macro consumes arguments.
-         *   %bcond_without luajit <- %bcond_without is parametric with arg
-         */
-        bool allow_parametric = !in_scriptlet_context(valid_symbols);
-
-        /* Skip any remaining whitespace */
-        skip_leading_whitespace(lexer);
-
-        if (lexer->lookahead == '%') {
-            lexer->mark_end(lexer);
+    bool allow_parametric = !(valid & VALID_SCRIPTLET_CONDITIONALS);
 
-            char keyword[64];
-            size_t keyword_len = 0;
-
-            if (consume_percent_and_identifier(lexer,
-                                               keyword,
-                                               sizeof(keyword),
-                                               &keyword_len)) {
-                /* Try conditional first (highest priority) */
-                if (conditionals_valid &&
-                    is_cond_keyword(keyword, keyword_len)) {
-                    if (try_scan_conditional(scanner,
-                                             lexer,
-                                             valid_symbols,
-                                             keyword,
-                                             keyword_len)) {
-                        return true;
-                    }
-                }
+    /* Skip any remaining whitespace */
+    skip_leading_whitespace(lexer);
 
-                /* Try section token (with word boundary check) */
-                if (sections_valid && !is_identifier_char(lexer->lookahead)) {
-                    const struct SectionKeyword *kw =
-                        lookup_section_keyword(keyword, keyword_len);
-                    if (kw != NULL && valid_symbols[kw->token]) {
-                        lexer->mark_end(lexer);
-                        lexer->result_symbol = kw->token;
-                        return true;
-                    }
-                }
+    if (lexer->lookahead != '%') {
+        return false;
+    }
 
-                /* Try parametric macro */
-                if (parametric_valid) {
-                    if (try_scan_parametric_macro(lexer,
-                                                  allow_parametric,
-                                                  keyword,
-                                                  keyword_len)) {
-                        return true;
-                    }
-                }
-            }
+    lexer->mark_end(lexer);
+
+    char keyword[64];
+    size_t keyword_len = 0;
+
+    if (!consume_percent_and_identifier(
+            lexer, keyword, sizeof(keyword), &keyword_len)) {
+        return false;
+    }
+
+    struct KeywordInfo info = keyword_lookup(keyword, keyword_len);
+
+    /* Try conditional first (highest priority) */
+    if ((valid & VALID_CONDITIONALS) && (info.flags & KW_CONDITIONAL)) {
+        if (try_scan_conditional(scanner, lexer, valid, &info)) {
+            return true;
         }
     }
 
-    /*
-     * 2. Simple macro tokens - grammar handles '%', scanner matches identifier
-     */
-    bool macros_valid =
-        valid_symbols[SIMPLE_MACRO] || valid_symbols[NEGATED_MACRO] ||
-        valid_symbols[SPECIAL_MACRO] || valid_symbols[ESCAPED_PERCENT];
+    /* Try section token (with word boundary check) */
+    if ((valid & VALID_SECTIONS) && (info.flags & KW_SECTION_TOKEN) &&
+        !is_identifier_char(lexer->lookahead)) {
+        enum TokenType token = SECTION_TOKENS[info.index];
+        if (valid & TOKEN_BIT(token)) {
+            lexer->mark_end(lexer);
+            lexer->result_symbol = token;
+            return true;
+        }
+    }
 
-    if (macros_valid) {
-        return scan_macro(lexer, valid_symbols);
+    /* Try parametric macro */
+    if (valid & TOKEN_BIT(PARAMETRIC_MACRO_NAME)) {
+        if (try_scan_parametric_macro(
+                lexer, allow_parametric, &info, keyword, keyword_len)) {
+            return true;
+        }
     }
 
-    /*
-     * 3. Contextual content tokens - only valid inside specific constructs
-     *
-     * These are checked LAST because they are greedy and would consume
-     * section keywords during error recovery if checked earlier.
-     * - EXPAND_CODE: content inside %{expand:...}
-     * - SCRIPT_CODE: content inside %(...)
-     */
-    if (valid_symbols[EXPAND_CODE] && scan_expand_content(lexer)) {
+    return false;
+}
+
+/**
+ * @brief Scan contextual content tokens
+ *
+ * These are only valid inside specific constructs:
+ * - EXPAND_CODE: content inside %{expand:...}
+ * - SCRIPT_CODE: content inside %(...)
+ *
+ * @param lexer The tree-sitter lexer
+ * @param valid Fingerprint of the valid tokens
+ * @return true if a token was matched, false otherwise
+ */
+static bool scan_content(TSLexer *lexer, uint64_t valid)
+{
+    if ((valid & TOKEN_BIT(EXPAND_CODE)) && scan_expand_content(lexer)) {
         lexer->result_symbol = EXPAND_CODE;
         return true;
     }
 
-    if (valid_symbols[SCRIPT_CODE] && scan_shell_content(lexer)) {
+    if ((valid & TOKEN_BIT(SCRIPT_CODE)) && scan_shell_content(lexer)) {
         lexer->result_symbol = SCRIPT_CODE;
         return true;
     }
@@ -1519,74 +1282,305 @@ rpmspec_scan(struct Scanner *scanner, TSLexer *lexer, const bool *valid_symbols)
 }
 
 /* ========================================================================== */
-/* TREE-SITTER API                                                            */
+/* VALID SYMBOL DISPATCH                                                      */
 /* ========================================================================== */
 
 /**
- * @brief Serializes the scanner state into a byte buffer
+ * @brief Pack eight valid_symbols entries into the bits of one byte
  *
- * This function copies the complete state of the scanner into the given byte
- * buffer and returns the number of bytes written. Used by Tree-sitter for
- * incremental parsing and error recovery.
+ * Each bool is 0 or 1, so the multiplication moves byte i of the
+ * little-endian word to bit 56 + i without any carries between them.
+ */
+static inline uint64_t pack_valid_symbols8(const bool *valid_symbols)
+{
+    uint64_t word;
+
+    memcpy(&word, valid_symbols, sizeof(word));
+    return (word * UINT64_C(0x0102040810204080)) >> 56;
+}
+
+/**
+ * @brief Fold the valid_symbols array into a fingerprint
  *
- * @param scanner The scanner instance to serialize
- * @param buffer The byte buffer to write the state to
- * @return The number of bytes written to the buffer
+ * @param valid_symbols Array indicating which token types are valid
+ * @return Bitmask with TOKEN_BIT(token) set for every valid token
  */
-static inline unsigned rpmspec_serialize(struct Scanner *scanner, char *buffer)
+static inline uint64_t valid_symbols_fingerprint(const bool *valid_symbols)
 {
-    /* Serialize the lookahead cache (2 bytes) */
-    if (2 > TREE_SITTER_SERIALIZATION_BUFFER_SIZE) {
-        return 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (sizeof(bool) == 1 && NEWLINE >= 32) {
+        uint64_t valid = pack_valid_symbols8(valid_symbols) |
+                         pack_valid_symbols8(valid_symbols + 8) << 8 |
+                         pack_valid_symbols8(valid_symbols + 16) << 16 |
+                         pack_valid_symbols8(valid_symbols + 24) << 24;
+
+        for (unsigned i = 32; i <= NEWLINE; i++) {
+            valid |= (uint64_t)valid_symbols[i] << i;
+        }
+        return valid;
     }
+#endif
+    uint64_t valid = 0;
 
-    buffer[0] = scanner->lookahead_cache_valid ? 1 : 0;
-    buffer[1] = scanner->lookahead_has_section ? 1 : 0;
+    for (unsigned i = 0; i <= NEWLINE; i++) {
+        valid |= (uint64_t)valid_symbols[i] << i;
+    }
 
-    return 2;
+    return valid;
 }
 
 /**
- * @brief Deserializes the scanner state from a byte buffer
+ * @brief Token categories a parse state can accept
  *
- * This function restores the state of the scanner based on the bytes that were
- * previously written by the serialize function. Used by Tree-sitter for
- * incremental parsing and error recovery.
+ * Only a handful of combinations occur in the parse table: most states
+ * accept percent-prefixed tokens only, a few only macros, only raw content
+ * or only NEWLINE, and error recovery accepts everything. Each combination
+ * has its own scan routine which skips the categories it can't accept.
+ */
+enum ScanRoute {
+    SCAN_ROUTE_PERCENT = 1 << 0, /**< VALID_PERCENT_TOKENS */
+    SCAN_ROUTE_MACRO = 1 << 1,   /**< VALID_MACROS */
+    SCAN_ROUTE_CONTENT = 1 << 2, /**< VALID_CONTENT */
+};
+
+/**
+ * @brief Scan when at most NEWLINE can be accepted
  *
- * @param scanner The scanner instance to restore state to
- * @param buffer The byte buffer containing the serialized state
- * @param length The number of bytes to read from the buffer
+ * Returns right away unless NEWLINE is valid and the lexer is at whitespace.
  */
-static inline void rpmspec_deserialize(struct Scanner *scanner,
-                                       const char *buffer,
-                                       unsigned length)
+static bool
+scan_route_newline(struct Scanner *scanner, TSLexer *lexer, uint64_t valid)
 {
-    /* Clear cache by default */
-    scanner->lookahead_cache_valid = false;
-    scanner->lookahead_has_section = false;
+    (void)scanner;
 
-    if (length < 2) {
-        return;
+    if (!(valid & TOKEN_BIT(NEWLINE)) || !is_space(lexer->lookahead)) {
+        return false;
     }
+    return scan_newline(lexer, valid);
+}
 
-    /* Deserialize the lookahead cache */
-    scanner->lookahead_cache_valid = buffer[0] != 0;
-    scanner->lookahead_has_section = buffer[1] != 0;
+/**
+ * @brief Scan when only percent-prefixed tokens (and NEWLINE) are valid
+ *
+ * Every token of this route starts with whitespace or '%', which rules out
+ * most positions with a single check.
+ */
+static bool
+scan_route_percent(struct Scanner *scanner, TSLexer *lexer, uint64_t valid)
+{
+    if (lexer->lookahead != '%' && !is_space(lexer->lookahead)) {
+        return false;
+    }
+    if (scan_newline(lexer, valid)) {
+        return true;
+    }
+    return scan_percent_tokens(scanner, lexer, valid);
+}
+
+/** @brief Scan when only macro tokens (and NEWLINE) are valid */
+static bool
+scan_route_macro(struct Scanner *scanner, TSLexer *lexer, uint64_t valid)
+{
+    (void)scanner;
+
+    if (scan_newline(lexer, valid)) {
+        return true;
+    }
+    return scan_macro(lexer, valid);
+}
+
+/** @brief Scan when only raw content tokens are valid */
+static bool
+scan_route_content(struct Scanner *scanner, TSLexer *lexer, uint64_t valid)
+{
+    (void)scanner;
+
+    return scan_content(lexer, valid);
+}
+
+/**
+ * @brief Scan any combination of token categories
+ *
+ * Used for error recovery, where every token is valid. Token categories
+ * are tried in priority order:
+ *
+ * 1. **Percent-prefixed tokens** (conditionals, parametric macros)
+ *    Scanner consumes the '%' as part of the token:
+ *    - Conditionals: `%if`, `%ifarch`, `%else`, `%endif`, etc.
+ *    - Parametric macros: `%configure --prefix=/usr` (only at line start)
+ *
+ *    These require peeking at the keyword after '%' to route correctly.
+ *    Conditionals have priority over parametric macros.
+ *    MUST be checked first so section keywords are recognized during
+ *    error recovery.
+ *
+ * 2. **Simple macro tokens** (SIMPLE_MACRO, NEGATED_MACRO, etc.)
+ *    Grammar handles '%', scanner matches the identifier:
+ *    - `%name` -> grammar matches '%', scanner matches 'name'
+ *    - `%{name}` -> handled entirely by grammar
+ *
+ * 3. **Contextual tokens** (EXPAND_CODE, SCRIPT_CODE)
+ *    Only valid inside specific constructs:
+ *    - EXPAND_CODE: inside `%{expand:...}`
+ *    - SCRIPT_CODE: inside `%(...)`
+ *
+ *    These are checked LAST because they are greedy and would consume
+ *    section keywords during error recovery if checked earlier.
+ */
+static bool
+scan_route_all(struct Scanner *scanner, TSLexer *lexer, uint64_t valid)
+{
+    if (!(valid & VALID_CONTENT) && scan_newline(lexer, valid)) {
+        return true;
+    }
+
+    if ((valid & VALID_PERCENT_TOKENS) &&
+        scan_percent_tokens(scanner, lexer, valid)) {
+        return true;
+    }
+
+    if (valid & VALID_MACROS) {
+        return scan_macro(lexer, valid);
+    }
+
+    return scan_content(lexer, valid);
 }
 
+/** @brief Scan routine for one combination of SCAN_ROUTE_* bits */
+typedef bool (*scan_route_fn)(struct Scanner *, TSLexer *, uint64_t);
+
+/**
+ * @brief Scan routines indexed by the SCAN_ROUTE_* bits of a fingerprint
+ */
+static const scan_route_fn SCAN_ROUTES[] = {
+    [0] = scan_route_newline,
+    [SCAN_ROUTE_PERCENT] = scan_route_percent,
+    [SCAN_ROUTE_MACRO] = scan_route_macro,
+    [SCAN_ROUTE_PERCENT | SCAN_ROUTE_MACRO] = scan_route_all,
+    [SCAN_ROUTE_CONTENT] = scan_route_content,
+    [SCAN_ROUTE_PERCENT | SCAN_ROUTE_CONTENT] = scan_route_all,
+    [SCAN_ROUTE_MACRO | SCAN_ROUTE_CONTENT] = scan_route_all,
+    [SCAN_ROUTE_PERCENT | SCAN_ROUTE_MACRO | SCAN_ROUTE_CONTENT] =
+        scan_route_all,
+};
+
+/**
+ * @brief Main scanning function for RPM spec tokens
+ *
+ * This is the primary entry point for external token recognition. It handles
+ * tokens that cannot be expressed in the grammar DSL alone, such as tokens
+ * requiring keyword exclusion, context-aware lookahead, or balanced delimiter
+ * tracking.
+ *
+ * The valid_symbols array is folded into a fingerprint once, which selects
+ * the scan routine for the token categories the parse state can accept. All
+ * further validity checks are mask tests on the fingerprint.
+ *
+ * @param scanner The scanner state (for instrumentation counters)
+ * @param lexer The tree-sitter lexer
+ * @param valid_symbols Array indicating which tokens are valid at this position
+ * @return true if a token was matched, false otherwise
+ */
+static inline bool
+rpmspec_scan(struct Scanner *scanner, TSLexer *lexer, const bool *valid_symbols)
+{
+    uint64_t valid = valid_symbols_fingerprint(valid_symbols);
+    unsigned route = ((valid & VALID_PERCENT_TOKENS) ? SCAN_ROUTE_PERCENT : 0) |
+                     ((valid & VALID_MACROS) ? SCAN_ROUTE_MACRO : 0) |
+                     ((valid & VALID_CONTENT) ? SCAN_ROUTE_CONTENT : 0);
+
+    return SCAN_ROUTES[route](scanner, lexer, valid);
+}
+
+/* ========================================================================== */
+/* INSTRUMENTATION                                                            */
+/* ========================================================================== */
+
+#ifdef TREE_SITTER_SCANNER_STATS
+/** @brief Counters of all destroyed scanners */
+static TSRpmScannerStats scanner_stats_totals;
+
+/** @brief External token names for the stats dump, in TokenType order */
+static const char *const TOKEN_NAMES[] = {
+    "simple_macro",
+    "parametric_macro_name",
+    "negated_macro",
+    "special_macro",
+    "escaped_percent",
+    "top_level_if",
+    "top_level_ifarch",
+    "top_level_ifnarch",
+    "top_level_ifos",
+    "top_level_ifnos",
+    "subsection_if",
+    "subsection_ifarch",
+    "subsection_ifnarch",
+    "subsection_ifos",
+    "subsection_ifnos",
+    "scriptlet_if",
+    "scriptlet_ifarch",
+    "scriptlet_ifnarch",
+    "scriptlet_ifos",
+    "scriptlet_ifnos",
+    "files_if",
+    "files_ifarch",
+    "files_ifnarch",
+    "files_ifos",
+    "files_ifnos",
+    "expand_code",
+    "script_code",
+    "section_prep",
+    "section_generate_buildrequires",
+    "section_conf",
+    "section_build",
+    "section_install",
+    "section_check",
+    "section_clean",
+    "newline",
+};
+
+_Static_assert(ARRAY_SIZE(TOKEN_NAMES) == NEWLINE + 1,
+               "TOKEN_NAMES must name every TokenType");
+#endif
+
+/**
+ * @brief Get the counters of all destroyed rpmspec scanners
+ *
+ * @param stats Receives the counters
+ * @return false if the scanner was built without ENABLE_SCANNER_STATS
+ */
+bool tree_sitter_rpmspec_scanner_stats(TSRpmScannerStats *stats)
+{
+#ifdef TREE_SITTER_SCANNER_STATS
+    scanner_stats_load(stats, &scanner_stats_totals);
+    return true;
+#else
+    (void)stats;
+    return false;
+#endif
+}
+
+/* ========================================================================== */
+/* TREE-SITTER API                                                            */
+/* ========================================================================== */
+
 /**
  * @brief Creates and initializes a new scanner instance
  *
  * This function is called by Tree-sitter to create a new external scanner
- * instance. It allocates memory and initializes the scanner state.
+ * instance. The scanner is stateless, so only the instrumentation counters
+ * are allocated.
  *
- * @return A pointer to the newly created scanner instance
+ * @return A pointer to the newly created scanner instance, NULL without
+ *         ENABLE_SCANNER_STATS
  */
 void *tree_sitter_rpmspec_external_scanner_create(void)
 {
-    struct Scanner *scanner = ts_calloc(1, sizeof(struct Scanner));
-
-    return scanner;
+#ifdef TREE_SITTER_SCANNER_STATS
+    return ts_calloc(1, sizeof(struct Scanner));
+#else
+    return NULL;
+#endif
 }
 
 /**
@@ -1595,38 +1589,50 @@ void *tree_sitter_rpmspec_external_scanner_create(void)
  * This function is called by Tree-sitter to clean up and destroy an external
  * scanner instance, releasing all allocated memory.
  *
+ * With ENABLE_SCANNER_STATS the counters of the scanner are added to the
+ * process-wide totals first, and printed if TREE_SITTER_SCANNER_STATS is set.
+ *
  * @param payload The scanner instance to destroy (cast from void*)
  */
 void tree_sitter_rpmspec_external_scanner_destroy(void *payload)
 {
+#ifdef TREE_SITTER_SCANNER_STATS
     struct Scanner *scanner = (struct Scanner *)payload;
 
+    scanner_stats_merge(&scanner_stats_totals, &scanner->stats);
+    scanner_stats_dump(
+        "rpmspec", &scanner->stats, TOKEN_NAMES, ARRAY_SIZE(TOKEN_NAMES));
     ts_free(scanner);
+#else
+    (void)payload;
+#endif
 }
 
 /**
  * @brief Tree-sitter API function for serializing scanner state
  *
- * This is the Tree-sitter external scanner API function that delegates
- * to the internal serialization implementation.
+ * The scanner is stateless, so the serialized state is always empty. Every
+ * external token then carries the same state, and tree-sitter never has to
+ * discard a reusable subtree after an edit because the state differs.
  *
  * @param payload The scanner instance (cast from void*)
  * @param buffer The buffer to write serialized state to
- * @return The number of bytes written
+ * @return The number of bytes written, always 0
  */
 unsigned tree_sitter_rpmspec_external_scanner_serialize(void *payload,
                                                         char *buffer)
 {
-    struct Scanner *scanner = (struct Scanner *)payload;
+    (void)payload;
+    (void)buffer;
 
-    return rpmspec_serialize(scanner, buffer);
+    return 0;
 }
 
 /**
  * @brief Tree-sitter API function for deserializing scanner state
  *
- * This is the Tree-sitter external scanner API function that delegates
- * to the internal deserialization implementation.
+ * Nothing to restore, see tree_sitter_rpmspec_external_scanner_serialize().
+ * States written by older versions of the scanner are ignored.
  *
  * @param payload The scanner instance (cast from void*)
  * @param buffer The buffer containing serialized state
@@ -1636,9 +1642,9 @@ void tree_sitter_rpmspec_external_scanner_deserialize(void *payload,
                                                       const char *buffer,
                                                       unsigned length)
 {
-    struct Scanner *scanner = (struct Scanner *)payload;
-
-    rpmspec_deserialize(scanner, buffer, length);
+    (void)payload;
+    (void)buffer;
+    (void)length;
 }
 
 /**
@@ -1660,5 +1666,14 @@ bool tree_sitter_rpmspec_external_scanner_scan(void *payload,
 {
     struct Scanner *scanner = (struct Scanner *)payload;
 
+#ifdef TREE_SITTER_SCANNER_STATS
+    SCANNER_STATS_INC(&scanner->stats, scan_calls);
+    if (!rpmspec_scan(scanner, lexer, valid_symbols)) {
+        return false;
+    }
+    SCANNER_STATS_TOKEN(&scanner->stats, lexer->result_symbol);
+    return true;
+#else
     return rpmspec_scan(scanner, lexer, valid_symbols);
+#endif
 }
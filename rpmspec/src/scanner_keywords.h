@@ -0,0 +1,636 @@
+/* Generated by scripts/gen-scanner-keywords.py from scanner_keywords.txt. */
+/* Do not edit, edit the table and regenerate instead. */
+
+#ifndef SCANNER_KEYWORDS_H
+#define SCANNER_KEYWORDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** @brief Keyword properties returned by keyword_lookup() */
+enum KeywordFlag {
+    KW_RESERVED = 1 << 0,       /**< Never a simple or parametric macro */
+    KW_SUBSECTION = 1 << 1,     /**< %package, %description, ... */
+    KW_SCRIPTLET = 1 << 2,      /**< Shell section, scriptlet or trigger */
+    KW_FILES = 1 << 3,          /**< The %files section */
+    KW_FILE_DIRECTIVE = 1 << 4, /**< Reserved in %files: %doc, %config, ... */
+    KW_CONDITIONAL = 1 << 5,    /**< Opens a conditional: %if, %ifarch, ... */
+    KW_ENDIF = 1 << 6,          /**< Closes a conditional */
+    KW_SECTION_TOKEN = 1 << 7,  /**< Emitted as a SECTION_* external token */
+    KW_NIL = 1 << 8,            /**< The %nil special macro */
+};
+
+/** @brief Result of keyword_lookup() */
+struct KeywordInfo {
+    uint16_t flags; /**< KW_* bitmask, 0 for other identifiers */
+    uint8_t index;  /**< Position among CONDITIONAL/SECTION_TOKEN */
+};
+
+/** @brief Length of the longest keyword */
+#define KW_MAX_LEN 22
+
+/**
+ * @brief Classify an identifier
+ *
+ * @param id The identifier (not null-terminated)
+ * @param len Length of the identifier
+ * @return The keyword properties, flags are 0 for non-keywords
+ */
+static inline struct KeywordInfo keyword_lookup(const char *id, size_t len)
+{
+    struct KeywordInfo kw = {0, 0};
+
+    switch (len) {
+    case 2:
+        switch (id[0]) {
+        case 'i':
+            if (memcmp(id, "if", 2) == 0) {
+                kw.flags = KW_RESERVED | KW_CONDITIONAL;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 3:
+        switch (id[0]) {
+        case 'd':
+            if (memcmp(id, "dnl", 3) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "doc", 3) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            if (memcmp(id, "dir", 3) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'l':
+            if (memcmp(id, "len", 3) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "lua", 3) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'n':
+            if (memcmp(id, "nil", 3) == 0) {
+                kw.flags = KW_NIL;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "pre", 3) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 'r':
+            if (memcmp(id, "rep", 3) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 's':
+            if (memcmp(id, "sub", 3) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'u':
+            if (memcmp(id, "u2p", 3) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 4:
+        switch (id[0]) {
+        case 'a':
+            if (memcmp(id, "attr", 4) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'c':
+            if (memcmp(id, "conf", 4) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                kw.index = 2;
+                return kw;
+            }
+            break;
+        case 'd':
+            if (memcmp(id, "dump", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'e':
+            if (memcmp(id, "elif", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "else", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "echo", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "expr", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'g':
+            if (memcmp(id, "gsub", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'i':
+            if (memcmp(id, "ifos", 4) == 0) {
+                kw.flags = KW_RESERVED | KW_CONDITIONAL;
+                kw.index = 3;
+                return kw;
+            }
+            break;
+        case 'l':
+            if (memcmp(id, "load", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "prep", 4) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                return kw;
+            }
+            if (memcmp(id, "post", 4) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 'w':
+            if (memcmp(id, "warn", 4) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 5:
+        switch (id[0]) {
+        case 'b':
+            if (memcmp(id, "build", 5) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                kw.index = 3;
+                return kw;
+            }
+            break;
+        case 'c':
+            if (memcmp(id, "check", 5) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                kw.index = 5;
+                return kw;
+            }
+            if (memcmp(id, "clean", 5) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                kw.index = 6;
+                return kw;
+            }
+            break;
+        case 'e':
+            if (memcmp(id, "endif", 5) == 0) {
+                kw.flags = KW_RESERVED | KW_ENDIF;
+                return kw;
+            }
+            if (memcmp(id, "error", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'f':
+            if (memcmp(id, "files", 5) == 0) {
+                kw.flags = KW_FILES;
+                return kw;
+            }
+            break;
+        case 'g':
+            if (memcmp(id, "ghost", 5) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'i':
+            if (memcmp(id, "ifnos", 5) == 0) {
+                kw.flags = KW_RESERVED | KW_CONDITIONAL;
+                kw.index = 4;
+                return kw;
+            }
+            break;
+        case 'l':
+            if (memcmp(id, "lower", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "patch", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "preun", 5) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 'q':
+            if (memcmp(id, "quote", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 's':
+            if (memcmp(id, "setup", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 't':
+            if (memcmp(id, "trace", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'u':
+            if (memcmp(id, "upper", 5) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 6:
+        switch (id[0]) {
+        case 'c':
+            if (memcmp(id, "config", 6) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'd':
+            if (memcmp(id, "define", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "docdir", 6) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'e':
+            if (memcmp(id, "elifos", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "expand", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "exists", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'g':
+            if (memcmp(id, "global", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "getenv", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'i':
+            if (memcmp(id, "ifarch", 6) == 0) {
+                kw.flags = KW_RESERVED | KW_CONDITIONAL;
+                kw.index = 1;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "postun", 6) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 'r':
+            if (memcmp(id, "readme", 6) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 's':
+            if (memcmp(id, "shrink", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "suffix", 6) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'v':
+            if (memcmp(id, "verify", 6) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 7:
+        switch (id[0]) {
+        case 'd':
+            if (memcmp(id, "dirname", 7) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "defattr", 7) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'e':
+            if (memcmp(id, "exclude", 7) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'i':
+            if (memcmp(id, "ifnarch", 7) == 0) {
+                kw.flags = KW_RESERVED | KW_CONDITIONAL;
+                kw.index = 2;
+                return kw;
+            }
+            if (memcmp(id, "install", 7) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                kw.index = 4;
+                return kw;
+            }
+            break;
+        case 'l':
+            if (memcmp(id, "license", 7) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "package", 7) == 0) {
+                kw.flags = KW_SUBSECTION;
+                return kw;
+            }
+            break;
+        case 'r':
+            if (memcmp(id, "reverse", 7) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'v':
+            if (memcmp(id, "verbose", 7) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 8:
+        switch (id[0]) {
+        case 'a':
+            if (memcmp(id, "artifact", 8) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'b':
+            if (memcmp(id, "basename", 8) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'e':
+            if (memcmp(id, "elifarch", 8) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'g':
+            if (memcmp(id, "getncpus", 8) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "pretrans", 8) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 's':
+            if (memcmp(id, "shescape", 8) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'u':
+            if (memcmp(id, "undefine", 8) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "url2path", 8) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 9:
+        switch (id[0]) {
+        case 'a':
+            if (memcmp(id, "autosetup", 9) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "autopatch", 9) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 'c':
+            if (memcmp(id, "changelog", 9) == 0) {
+                kw.flags = KW_SUBSECTION;
+                return kw;
+            }
+            break;
+        case 'm':
+            if (memcmp(id, "macrobody", 9) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            if (memcmp(id, "missingok", 9) == 0) {
+                kw.flags = KW_FILE_DIRECTIVE;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "patchlist", 9) == 0) {
+                kw.flags = KW_SUBSECTION;
+                return kw;
+            }
+            if (memcmp(id, "posttrans", 9) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 't':
+            if (memcmp(id, "triggerin", 9) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            if (memcmp(id, "triggerun", 9) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 10:
+        switch (id[0]) {
+        case 'p':
+            if (memcmp(id, "preuntrans", 10) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 'r':
+            if (memcmp(id, "rpmversion", 10) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        case 's':
+            if (memcmp(id, "sourcelist", 10) == 0) {
+                kw.flags = KW_SUBSECTION;
+                return kw;
+            }
+            break;
+        case 'u':
+            if (memcmp(id, "uncompress", 10) == 0) {
+                kw.flags = KW_RESERVED;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 11:
+        switch (id[0]) {
+        case 'd':
+            if (memcmp(id, "description", 11) == 0) {
+                kw.flags = KW_SUBSECTION;
+                return kw;
+            }
+            break;
+        case 'p':
+            if (memcmp(id, "postuntrans", 11) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 12:
+        switch (id[0]) {
+        case 't':
+            if (memcmp(id, "triggerprein", 12) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 13:
+        switch (id[0]) {
+        case 'f':
+            if (memcmp(id, "filetriggerin", 13) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            if (memcmp(id, "filetriggerun", 13) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        case 't':
+            if (memcmp(id, "triggerpostun", 13) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 17:
+        switch (id[0]) {
+        case 'f':
+            if (memcmp(id, "filetriggerpostun", 17) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 18:
+        switch (id[0]) {
+        case 't':
+            if (memcmp(id, "transfiletriggerin", 18) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            if (memcmp(id, "transfiletriggerun", 18) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    case 22:
+        switch (id[0]) {
+        case 'g':
+            if (memcmp(id, "generate_buildrequires", 22) == 0) {
+                kw.flags = KW_SCRIPTLET | KW_SECTION_TOKEN;
+                kw.index = 1;
+                return kw;
+            }
+            break;
+        case 't':
+            if (memcmp(id, "transfiletriggerpostun", 22) == 0) {
+                kw.flags = KW_SCRIPTLET;
+                return kw;
+            }
+            break;
+        }
+        break;
+    }
+
+    return kw;
+}
+
+#endif /* SCANNER_KEYWORDS_H */
@@ -0,0 +1,192 @@
+/**
+ * @file scanner_stats.h
+ * @brief Opt-in instrumentation counters of the external scanners
+ *
+ * Configuring with -DENABLE_SCANNER_STATS=ON defines
+ * TREE_SITTER_SCANNER_STATS, which makes the rpmspec and rpmbash scanners
+ * keep a TSRpmScannerStats in their payload. Without it every SCANNER_STATS_*
+ * macro expands to nothing, so regular builds don't pay for the counters.
+ *
+ * The counters are exposed by tree_sitter_rpmspec_scanner_stats() and
+ * tree_sitter_rpmbash_scanner_stats(), see tree-sitter-rpmspec.h.
+ */
+
+#ifndef SCANNER_STATS_H
+#define SCANNER_STATS_H
+
+#ifdef TREE_SITTER_SCANNER_STATS
+
+#include "../bindings/c/tree_sitter/tree-sitter-rpmspec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/** @brief Environment variable enabling the dump at scanner destroy */
+#define SCANNER_STATS_ENV "TREE_SITTER_SCANNER_STATS"
+
+/** @brief Increment a counter */
+#define SCANNER_STATS_INC(stats, field) ((stats)->field++)
+
+/** @brief Add @p n to a counter */
+#define SCANNER_STATS_ADD(stats, field, n) ((stats)->field += (uint64_t)(n))
+
+/** @brief Raise a maximum counter to @p value */
+#define SCANNER_STATS_MAX(stats, field, value)    \
+    do {                                          \
+        if ((uint64_t)(value) > (stats)->field) { \
+            (stats)->field = (uint64_t)(value);   \
+        }                                         \
+    } while (0)
+
+/** @brief Count a returned token */
+#define SCANNER_STATS_TOKEN(stats, token)            \
+    do {                                             \
+        if ((token) < TS_RPM_SCANNER_STATS_TOKENS) { \
+            (stats)->tokens[(token)]++;              \
+        }                                            \
+    } while (0)
+
+/*
+ * Parsers may be deleted from several threads at once, so the process-wide
+ * totals are updated atomically where the compiler supports it.
+ */
+#if defined(__GNUC__)
+#define SCANNER_STATS_ATOMIC_ADD(ptr, n) \
+    __atomic_fetch_add((ptr), (n), __ATOMIC_RELAXED)
+#define SCANNER_STATS_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#else
+#define SCANNER_STATS_ATOMIC_ADD(ptr, n) (*(ptr) += (n))
+#define SCANNER_STATS_ATOMIC_LOAD(ptr) (*(ptr))
+#endif
+
+/** @brief Raise a process-wide maximum to @p value */
+static inline void scanner_stats_atomic_max(uint64_t *ptr, uint64_t value)
+{
+#if defined(__GNUC__)
+    uint64_t cur = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+
+    while (value > cur &&
+           !__atomic_compare_exchange_n(
+               ptr, &cur, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+#else
+    if (value > *ptr) {
+        *ptr = value;
+    }
+#endif
+}
+
+/**
+ * @brief Add the counters of one scanner to the process-wide totals
+ *
+ * @param totals The process-wide totals
+ * @param stats The counters of the scanner being destroyed
+ */
+static inline void scanner_stats_merge(TSRpmScannerStats *totals,
+                                       const TSRpmScannerStats *stats)
+{
+    SCANNER_STATS_ATOMIC_ADD(&totals->scan_calls, stats->scan_calls);
+    for (size_t i = 0; i < TS_RPM_SCANNER_STATS_TOKENS; i++) {
+        SCANNER_STATS_ATOMIC_ADD(&totals->tokens[i], stats->tokens[i]);
+    }
+    SCANNER_STATS_ATOMIC_ADD(&totals->lookahead_calls, stats->lookahead_calls);
+    SCANNER_STATS_ATOMIC_ADD(&totals->lookahead_chars, stats->lookahead_chars);
+    scanner_stats_atomic_max(&totals->max_lookahead_chars,
+                             stats->max_lookahead_chars);
+    scanner_stats_atomic_max(&totals->max_lookahead_depth,
+                             stats->max_lookahead_depth);
+    SCANNER_STATS_ATOMIC_ADD(&totals->no_keyword_retries,
+                             stats->no_keyword_retries);
+}
+
+/**
+ * @brief Copy the process-wide totals
+ *
+ * @param out Receives the totals
+ * @param totals The process-wide totals
+ */
+static inline void scanner_stats_load(TSRpmScannerStats *out,
+                                      const TSRpmScannerStats *totals)
+{
+    out->scan_calls = SCANNER_STATS_ATOMIC_LOAD(&totals->scan_calls);
+    for (size_t i = 0; i < TS_RPM_SCANNER_STATS_TOKENS; i++) {
+        out->tokens[i] = SCANNER_STATS_ATOMIC_LOAD(&totals->tokens[i]);
+    }
+    out->lookahead_calls = SCANNER_STATS_ATOMIC_LOAD(&totals->lookahead_calls);
+    out->lookahead_chars = SCANNER_STATS_ATOMIC_LOAD(&totals->lookahead_chars);
+    out->max_lookahead_chars =
+        SCANNER_STATS_ATOMIC_LOAD(&totals->max_lookahead_chars);
+    out->max_lookahead_depth =
+        SCANNER_STATS_ATOMIC_LOAD(&totals->max_lookahead_depth);
+    out->no_keyword_retries =
+        SCANNER_STATS_ATOMIC_LOAD(&totals->no_keyword_retries);
+}
+
+/**
+ * @brief Print the counters of a scanner if TREE_SITTER_SCANNER_STATS is set
+ *
+ * @param name Name of the grammar
+ * @param stats The counters to print
+ * @param token_names Names of the external tokens, NULL to print indexes
+ * @param num_tokens Number of external tokens
+ */
+static inline void scanner_stats_dump(const char *name,
+                                      const TSRpmScannerStats *stats,
+                                      const char *const *token_names,
+                                      size_t num_tokens)
+{
+    const char *env = getenv(SCANNER_STATS_ENV);
+
+    if (env == NULL || env[0] == '\0' || (env[0] == '0' && env[1] == '\0')) {
+        return;
+    }
+
+    fprintf(stderr,
+            "%s scanner stats:\n"
+            "  scan calls           %llu\n"
+            "  lookahead calls      %llu\n"
+            "  lookahead chars      %llu\n"
+            "  max lookahead chars  %llu\n"
+            "  max lookahead depth  %llu\n"
+            "  no keyword retries   %llu\n",
+            name,
+            (unsigned long long)stats->scan_calls,
+            (unsigned long long)stats->lookahead_calls,
+            (unsigned long long)stats->lookahead_chars,
+            (unsigned long long)stats->max_lookahead_chars,
+            (unsigned long long)stats->max_lookahead_depth,
+            (unsigned long long)stats->no_keyword_retries);
+
+    if (num_tokens > TS_RPM_SCANNER_STATS_TOKENS) {
+        num_tokens = TS_RPM_SCANNER_STATS_TOKENS;
+    }
+    for (size_t i = 0; i < num_tokens; i++) {
+        if (stats->tokens[i] == 0) {
+            continue;
+        }
+        if (token_names != NULL) {
+            fprintf(stderr,
+                    "  token %-30s %llu\n",
+                    token_names[i],
+                    (unsigned long long)stats->tokens[i]);
+        } else {
+            fprintf(stderr,
+                    "  token %-30zu %llu\n",
+                    i,
+                    (unsigned long long)stats->tokens[i]);
+        }
+    }
+}
+
+#else /* TREE_SITTER_SCANNER_STATS */
+
+typedef struct TSRpmScannerStats TSRpmScannerStats;
+
+#define SCANNER_STATS_INC(stats, field) ((void)0)
+#define SCANNER_STATS_ADD(stats, field, n) ((void)0)
+#define SCANNER_STATS_MAX(stats, field, value) ((void)0)
+#define SCANNER_STATS_TOKEN(stats, token) ((void)0)
+
+#endif /* TREE_SITTER_SCANNER_STATS */
+
+#endif /* SCANNER_STATS_H */
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 Andreas Schneider <asn@cryptomilk.org>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+"""
+Benchmark conditional lookahead on deeply nested %if blocks.
+
+Every ambiguous %if makes the rpmspec scanner look ahead to the matching
+%endif (see "Conditional Lookahead Cost" in rpmspec/DESIGN.md). This script
+generates specs with N nested conditionals for a range of depths, parses
+each one with `tree-sitter parse --time` and prints the parse time together
+with the growth exponent between two consecutive depths:
+
+    exponent ~ 1.0  -> linear in the nesting depth
+    exponent ~ 2.0  -> quadratic in the nesting depth
+
+Shapes:
+  scriptlet  nested %if inside %build, shell lines between the levels
+  files      nested %if inside %files, file entries between the levels
+  top        nested top-level %if, each level wrapping a %package
+"""
+
+import argparse
+import math
+import re
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+PREAMBLE = """\
+Name:           nested
+Version:        1.0
+Release:        1
+Summary:        Nested conditionals
+License:        MIT
+
+%description
+Nested conditionals benchmark.
+
+"""
+
+
+def gen_scriptlet(depth: int) -> str:
+    lines = ["%build"]
+    for i in range(depth):
+        lines.append(f"%if %{{with feature{i}}}")
+        lines.append(f"echo level {i}")
+    for i in reversed(range(depth)):
+        lines.append(f"echo leave {i}")
+        lines.append("%endif")
+    lines.append("make")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_files(depth: int) -> str:
+    lines = ["%files"]
+    for i in range(depth):
+        lines.append(f"%if %{{with feature{i}}}")
+        lines.append(f"%{{_bindir}}/tool{i}")
+    for i in reversed(range(depth)):
+        lines.append(f"%{{_datadir}}/nested/data{i}")
+        lines.append("%endif")
+    lines.append("%license LICENSE")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_top(depth: int) -> str:
+    lines = ["%build", "make"]
+    for i in range(depth):
+        lines.append(f"%if %{{with sub{i}}}")
+        lines.append(f"%package sub{i}")
+        lines.append(f"Summary: Subpackage {i}")
+        lines.append(f"%description sub{i}")
+        lines.append(f"Subpackage {i}.")
+    for i in reversed(range(depth)):
+        lines.append("%endif")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+SHAPES = {
+    "scriptlet": gen_scriptlet,
+    "files": gen_files,
+    "top": gen_top,
+}
+
+PARSE_TIME_RE = re.compile(r"Parse:\s+([0-9.]+)\s*ms")
+
+
+def parse_time_ms(ts: str, grammar_dir: Path, spec: Path, runs: int) -> float:
+    """Return the best-of-N parse time in milliseconds."""
+    best = math.inf
+    for _ in range(runs):
+        proc = subprocess.run(
+            [ts, "parse", "--time", "--quiet", str(spec)],
+            cwd=grammar_dir,
+            capture_output=True,
+            text=True,
+        )
+        match = PARSE_TIME_RE.search(proc.stdout + proc.stderr)
+        if match is None:
+            raise RuntimeError(
+                f"Unexpected output from '{ts} parse':\n"
+                f"{proc.stdout}{proc.stderr}"
+            )
+        best = min(best, float(match.group(1)))
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark rpmspec conditional lookahead on nested %if",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument(
+        "--tree-sitter",
+        default="tree-sitter",
+        metavar="PATH",
+        help="tree-sitter CLI to use (default: tree-sitter)",
+    )
+    parser.add_argument(
+        "--grammar-dir",
+        type=Path,
+        default=Path(__file__).resolve().parent.parent / "rpmspec",
+        metavar="DIR",
+        help="Grammar directory (default: rpmspec)",
+    )
+    parser.add_argument(
+        "--shape",
+        choices=sorted(SHAPES),
+        action="append",
+        help="Shape to benchmark (default: all, can be repeated)",
+    )
+    parser.add_argument(
+        "--min-depth",
+        type=int,
+        default=64,
+        metavar="N",
+        help="Smallest nesting depth (default: 64)",
+    )
+    parser.add_argument(
+        "--max-depth",
+        type=int,
+        default=4096,
+        metavar="N",
+        help="Largest nesting depth, doubled from --min-depth (default: 4096)",
+    )
+    parser.add_argument(
+        "--runs",
+        type=int,
+        default=3,
+        metavar="N",
+        help="Parse each spec N times and keep the best time (default: 3)",
+    )
+    args = parser.parse_args()
+
+    shapes = args.shape or sorted(SHAPES)
+
+    with tempfile.TemporaryDirectory(prefix="rpmspec-nested-") as tmp:
+        for shape in shapes:
+            print(f"# {shape}")
+            print(f"{'depth':>8} {'bytes':>10} {'ms':>10} {'us/level':>10} "
+                  f"{'exponent':>9}")
+
+            prev = None
+            depth = args.min_depth
+            while depth <= args.max_depth:
+                spec = Path(tmp) / f"{shape}-{depth}.spec"
+                spec.write_text(SHAPES[shape](depth), encoding="utf-8")
+
+                ms = parse_time_ms(
+                    args.tree_sitter, args.grammar_dir, spec, args.runs
+                )
+
+                exponent = ""
+                if prev is not None and prev[1] > 0 and ms > 0:
+                    exponent = "%.2f" % (
+                        math.log(ms / prev[1]) / math.log(depth / prev[0])
+                    )
+
+                print(f"{depth:>8} {spec.stat().st_size:>10} {ms:>10.2f} "
+                      f"{ms * 1000.0 / depth:>10.2f} {exponent:>9}")
+
+                prev = (depth, ms)
+                depth *= 2
+            print()
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 Andreas Schneider <asn@cryptomilk.org>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+"""
+Generate adversarial rpmspec inputs and check that parsing scales linearly.
+
+Each family grows one construct that stresses the scanner or the parser:
+
+  nested-build      N nested %if inside %build (conditional lookahead)
+  top-files         N top-level %if each wrapping a %files section
+  files-list        %files list with N macro-heavy paths (file_path GLR
+                    conflict)
+  changelog         %changelog with N entries
+  lua-body          %{lua:} body with N lines (SCRIPT_CODE)
+  expand-body       %{expand:} body with N lines (EXPAND_CODE)
+  boolean-requires  BuildRequires with N boolean dependencies
+
+Every family is generated at doubling sizes and parsed with bench-parse
+(tests/bench, built with -DENABLE_BENCHMARKS=ON). A power law
+time = c * bytes^k is fitted to the median parse times by least squares on
+the log-log values. A family fails if its exponent k exceeds
+--max-exponent:
+
+    k ~ 1.0  -> linear in the input size
+    k ~ 2.0  -> quadratic in the input size
+
+With --generate-only the specs are only written to --output-dir.
+"""
+
+import argparse
+import json
+import math
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+HEADER = """\
+Name:           scaling
+Version:        1.0
+Release:        1
+Summary:        Scaling benchmark
+License:        MIT
+"""
+
+DESCRIPTION = """
+%description
+Scaling benchmark.
+
+"""
+
+PREAMBLE = HEADER + DESCRIPTION
+
+
+def gen_nested_build(n: int) -> str:
+    lines = ["%build"]
+    for i in range(n):
+        lines.append(f"%if %{{with feature{i}}}")
+        lines.append(f"echo level {i}")
+    for i in reversed(range(n)):
+        lines.append(f"echo leave {i}")
+        lines.append("%endif")
+    lines.append("make")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_top_files(n: int) -> str:
+    lines = ["%build", "make", ""]
+    for i in range(n):
+        lines.append(f"%if %{{with sub{i}}}")
+        lines.append(f"%files sub{i}")
+        lines.append(f"%{{_bindir}}/tool{i}")
+        lines.append(f"%{{_mandir}}/man1/tool{i}.1*")
+        lines.append("%endif")
+        lines.append("")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_files_list(n: int) -> str:
+    lines = ["%files"]
+    for i in range(n):
+        kind = i % 4
+        if kind == 0:
+            lines.append(f"%{{_libdir}}/%{{name}}/plugin{i}-%{{version}}.so")
+        elif kind == 1:
+            lines.append(f"%dir %{{_datadir}}/%{{name}}/d{i}")
+        elif kind == 2:
+            lines.append(
+                f"%attr(0644,root,root) %config(noreplace) "
+                f"%{{_sysconfdir}}/%{{name}}/c{i}.conf"
+            )
+        else:
+            lines.append(f"%{{python3_sitelib}}/%{{pkgname}}/m{i}.py")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_changelog(n: int) -> str:
+    days = ["Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"]
+    months = ["Jan", "Feb", "Mar", "Apr", "May", "Jun",
+              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"]
+    lines = ["%changelog"]
+    for i in range(n):
+        day = days[i % 7]
+        month = months[i % 12]
+        lines.append(
+            f"* {day} {month} {i % 28 + 1:02d} {2026 - i // 365} "
+            f"Packager <packager@example.org> - 1.{n - i}-1"
+        )
+        lines.append(f"- Update to 1.{n - i}")
+        lines.append(f"- Fix bug #{i} in %{{name}}")
+        lines.append("")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_lua_body(n: int) -> str:
+    lines = ["%{lua:"]
+    lines.append("local t = {}")
+    for i in range(n):
+        lines.append(
+            f"if rpm.expand(\"%{{?with_f{i}}}\") ~= \"\" then "
+            f"t[#t + 1] = {{ name = \"f{i}\", value = {i} }} end"
+        )
+    lines.append("print(#t)")
+    lines.append("}")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_expand_body(n: int) -> str:
+    lines = ["%{expand:"]
+    for i in range(n):
+        lines.append(f"%global m{i} %{{?dist}}{{{i}}}")
+    lines.append("}")
+    return PREAMBLE + "\n".join(lines) + "\n"
+
+
+def gen_boolean_requires(n: int) -> str:
+    lines = []
+    for i in range(n):
+        kind = i % 3
+        if kind == 0:
+            lines.append(f"BuildRequires:  (pkg{i} if feature{i} else alt{i})")
+        elif kind == 1:
+            lines.append(
+                f"BuildRequires:  ((lib{i} >= 1.{i} with lib{i} < 2) "
+                f"or compat-lib{i})"
+            )
+        else:
+            lines.append(
+                f"BuildRequires:  (python3dist(mod{i}) unless "
+                f"python3dist(mod{i}-legacy))"
+            )
+    return HEADER + "\n".join(lines) + "\n" + DESCRIPTION
+
+
+# Family name -> (generator, smallest size). Sizes double from there.
+FAMILIES = {
+    "nested-build": (gen_nested_build, 64),
+    "top-files": (gen_top_files, 128),
+    "files-list": (gen_files_list, 3125),
+    "changelog": (gen_changelog, 1563),
+    "lua-body": (gen_lua_body, 1000),
+    "expand-body": (gen_expand_body, 1000),
+    "boolean-requires": (gen_boolean_requires, 256),
+}
+
+
+def parse_time_ms(bench: str, spec: Path, runs: int) -> float:
+    """Return the median parse time of one spec in milliseconds."""
+    proc = subprocess.run(
+        [bench, "-r", str(runs), "-l", "rpmspec", "-j", "-", str(spec)],
+        capture_output=True,
+        text=True,
+        check=True,
+    )
+    return json.loads(proc.stdout)["grammars"]["rpmspec"]["p50_ms"]
+
+
+def fit_exponent(points):
+    """Least squares fit of log(time) = k * log(bytes) + c, returns k."""
+    xs = [math.log(b) for b, ms in points if ms > 0]
+    ys = [math.log(ms) for b, ms in points if ms > 0]
+    if len(xs) < 2:
+        return None
+    mx = sum(xs) / len(xs)
+    my = sum(ys) / len(ys)
+    sxx = sum((x - mx) ** 2 for x in xs)
+    if sxx == 0:
+        return None
+    return sum((x - mx) * (y - my) for x, y in zip(xs, ys)) / sxx
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Check that rpmspec parse time scales linearly",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument(
+        "--bench",
+        default="build/tests/bench/bench-parse",
+        metavar="PATH",
+        help="bench-parse executable (default: build/tests/bench/bench-parse)",
+    )
+    parser.add_argument(
+        "--family",
+        choices=sorted(FAMILIES),
+        action="append",
+        help="Family to benchmark (default: all, can be repeated)",
+    )
+    parser.add_argument(
+        "--steps",
+        type=int,
+        default=6,
+        metavar="N",
+        help="Number of sizes per family, doubling each time (default: 6)",
+    )
+    parser.add_argument(
+        "--runs",
+        type=int,
+        default=5,
+        metavar="N",
+        help="Parse each spec N times and use the median (default: 5)",
+    )
+    parser.add_argument(
+        "--max-exponent",
+        type=float,
+        default=1.3,
+        metavar="K",
+        help="Fail if a fitted exponent exceeds K (default: 1.3)",
+    )
+    parser.add_argument(
+        "--output-dir",
+        type=Path,
+        metavar="DIR",
+        help="Keep the generated specs in DIR (default: temporary directory)",
+    )
+    parser.add_argument(
+        "--generate-only",
+        action="store_true",
+        help="Only write the specs to --output-dir, don't benchmark",
+    )
+    args = parser.parse_args()
+
+    if args.generate_only and args.output_dir is None:
+        parser.error("--generate-only requires --output-dir")
+
+    families = args.family or sorted(FAMILIES)
+    failed = []
+
+    with tempfile.TemporaryDirectory(prefix="rpmspec-scaling-") as tmp:
+        outdir = args.output_dir or Path(tmp)
+        outdir.mkdir(parents=True, exist_ok=True)
+
+        for family in families:
+            generate, size = FAMILIES[family]
+            points = []
+
+            if not args.generate_only:
+                print(f"# {family}")
+                print(f"{'n':>8} {'bytes':>10} {'ms':>10} {'ns/byte':>9}")
+
+            for _ in range(args.steps):
+                spec = outdir / f"{family}-{size}.spec"
+                spec.write_text(generate(size), encoding="utf-8")
+                nbytes = spec.stat().st_size
+
+                if args.generate_only:
+                    print(spec)
+                else:
+                    ms = parse_time_ms(args.bench, spec, args.runs)
+                    points.append((nbytes, ms))
+                    print(f"{size:>8} {nbytes:>10} {ms:>10.2f} "
+                          f"{ms * 1e6 / nbytes:>9.1f}")
+                size *= 2
+
+            if args.generate_only:
+                continue
+
+            exponent = fit_exponent(points)
+            if exponent is None:
+                print("exponent: n/a (parse times too small)\n")
+                continue
+            verdict = "ok"
+            if exponent > args.max_exponent:
+                verdict = "SUPERLINEAR"
+                failed.append(family)
+            print(f"exponent: {exponent:.2f} {verdict}\n")
+
+    if failed:
+        print(f"Superlinear families: {', '.join(failed)}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 Andreas Schneider <asn@cryptomilk.org>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+"""
+Generate the symbol and field tables of the binary tree format.
+
+Reads node-types.json and writes a C header numbering every node type and
+every field name. The tree serializer (util/src/treefile.c) stores these
+numbers instead of the TSSymbol and TSFieldId of the generated parser,
+which change whenever parser.c is regenerated. Serialized trees therefore
+stay readable as long as node-types.json keeps its types.
+
+Symbol 0 is ERROR, which node-types.json doesn't list. The other types
+follow in node-types.json order. Field 0 means "no field", the field names
+follow sorted.
+"""
+
+import argparse
+import json
+import sys
+from pathlib import Path
+
+
+def c_string(s: str) -> str:
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def load(path: Path):
+    """Return ([(type, named)], [field]) from node-types.json."""
+    types = [("ERROR", True)]
+    seen = set(types)
+    fields = set()
+
+    for node in json.loads(path.read_text()):
+        key = (node["type"], node["named"])
+        if key in seen:
+            raise ValueError(f"{path}: duplicate type {key}")
+        seen.add(key)
+        types.append(key)
+        fields.update(node.get("fields", {}))
+
+    return types, sorted(fields)
+
+
+def generate(types: list, fields: list, source: str, prefix: str) -> str:
+    out = []
+    emit = out.append
+    guard = f"{prefix.upper()}_NODE_TYPES_H"
+
+    emit(f"/* Generated by scripts/gen-node-types.py from {source}. */")
+    emit("/* Do not edit, regenerate instead. */")
+    emit("")
+    emit(f"#ifndef {guard}")
+    emit(f"#define {guard}")
+    emit("")
+    emit("#include <stdint.h>")
+    emit("")
+    emit("/** @brief A node type of node-types.json */")
+    emit(f"struct {prefix.capitalize()}NodeType {{")
+    emit("    const char *name;")
+    emit("    uint8_t named;")
+    emit("};")
+    emit("")
+    emit(f"#define {prefix.upper()}_NODE_TYPE_COUNT {len(types)}")
+    emit(f"#define {prefix.upper()}_FIELD_COUNT {len(fields) + 1}")
+    emit("")
+    emit(f"static const struct {prefix.capitalize()}NodeType "
+         f"{prefix}_node_types[] = {{")
+    for name, named in types:
+        emit(f"    {{{c_string(name)}, {1 if named else 0}}},")
+    emit("};")
+    emit("")
+    emit(f"static const char *const {prefix}_field_names[] = {{")
+    emit("    \"\",")
+    for name in fields:
+        emit(f"    {c_string(name)},")
+    emit("};")
+    emit("")
+    emit(f"#endif /* {guard} */")
+
+    return "\n".join(out) + "\n"
+
+
+def main():
+    repo = Path(__file__).resolve().parent.parent
+
+    parser = argparse.ArgumentParser(
+        description="Generate the node type tables of the tree format",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument(
+        "--node-types",
+        type=Path,
+        default=repo / "rpmspec" / "src" / "node-types.json",
+        metavar="FILE",
+        help="node-types.json to read "
+        "(default: rpmspec/src/node-types.json)",
+    )
+    parser.add_argument(
+        "--prefix",
+        default="rpmspec",
+        help="Prefix of the generated names (default: rpmspec)",
+    )
+    parser.add_argument(
+        "--output",
+        type=Path,
+        default=repo / "util" / "src" / "rpmspec_node_types.h",
+        metavar="FILE",
+        help="Header to write (default: util/src/rpmspec_node_types.h)",
+    )
+    args = parser.parse_args()
+
+    try:
+        types, fields = load(args.node_types)
+    except (OSError, ValueError, KeyError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    try:
+        source = args.node_types.resolve().relative_to(repo).as_posix()
+    except ValueError:
+        source = args.node_types.name
+    args.output.write_text(generate(types, fields, source, args.prefix))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 Andreas Schneider <asn@cryptomilk.org>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+"""
+Generate the keyword classifier of the rpmspec external scanner.
+
+Reads the keyword table (rpmspec/src/scanner_keywords.txt) and writes a C
+header with a single lookup function. The lookup switches on the identifier
+length and first character and compares at most a few candidates, so the
+scanner hot path has no keyword arrays to walk. It returns every property of
+the identifier as a flag bitmask.
+
+All keywords are checked against grammar.json: each one must appear there as
+"name", "%name" or "name:", otherwise the table has drifted from the grammar.
+"""
+
+import argparse
+import json
+import sys
+from collections import defaultdict
+from pathlib import Path
+
+# Flag names in bit order. The generated header exposes them as KW_<name>.
+FLAGS = [
+    ("RESERVED", "Never a simple or parametric macro"),
+    ("SUBSECTION", "%package, %description, ..."),
+    ("SCRIPTLET", "Shell section, scriptlet or trigger"),
+    ("FILES", "The %files section"),
+    ("FILE_DIRECTIVE", "Reserved in %files: %doc, %config, ..."),
+    ("CONDITIONAL", "Opens a conditional: %if, %ifarch, ..."),
+    ("ENDIF", "Closes a conditional"),
+    ("SECTION_TOKEN", "Emitted as a SECTION_* external token"),
+    ("NIL", "The %nil special macro"),
+]
+
+# Flags whose keywords are numbered in table order (KeywordInfo.index).
+INDEXED_FLAGS = ("CONDITIONAL", "SECTION_TOKEN")
+
+
+def parse_table(path: Path) -> list:
+    """Return a list of (name, [flags], index) tuples in table order."""
+    known = {name for name, _ in FLAGS}
+    counters = defaultdict(int)
+    keywords = []
+    seen = set()
+
+    for lineno, line in enumerate(path.read_text().splitlines(), 1):
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+
+        name, *flags = line.split()
+        where = f"{path}:{lineno}"
+        if not name.isidentifier() or not name.isascii():
+            raise ValueError(f"{where}: invalid keyword '{name}'")
+        if name in seen:
+            raise ValueError(f"{where}: duplicate keyword '{name}'")
+        if not flags:
+            raise ValueError(f"{where}: keyword '{name}' has no flags")
+        for flag in flags:
+            if flag not in known:
+                raise ValueError(f"{where}: unknown flag '{flag}'")
+
+        indexed = [f for f in flags if f in INDEXED_FLAGS]
+        if len(indexed) > 1:
+            raise ValueError(
+                f"{where}: '{name}' combines {' and '.join(indexed)}"
+            )
+        index = 0
+        if indexed:
+            index = counters[indexed[0]]
+            counters[indexed[0]] += 1
+
+        seen.add(name)
+        keywords.append((name, flags, index))
+
+    return keywords
+
+
+def grammar_strings(path: Path) -> set:
+    """Return all STRING values of a grammar.json."""
+    strings = set()
+
+    def walk(node):
+        if isinstance(node, dict):
+            if node.get("type") == "STRING":
+                strings.add(node["value"])
+            for value in node.values():
+                walk(value)
+        elif isinstance(node, list):
+            for value in node:
+                walk(value)
+
+    walk(json.loads(path.read_text()))
+    return strings
+
+
+def check_grammar(keywords: list, strings: set) -> list:
+    """Return the keywords which do not appear in the grammar."""
+    return [
+        name
+        for name, _, _ in keywords
+        if not {name, "%" + name, name + ":"} & strings
+    ]
+
+
+def flags_expr(flags: list) -> str:
+    return " | ".join("KW_" + f for f in flags)
+
+
+def generate(keywords: list, table_name: str) -> str:
+    by_len = defaultdict(lambda: defaultdict(list))
+    for kw in keywords:
+        by_len[len(kw[0])][kw[0][0]].append(kw)
+
+    out = []
+    emit = out.append
+
+    emit("/* Generated by scripts/gen-scanner-keywords.py from "
+         f"{table_name}. */")
+    emit("/* Do not edit, edit the table and regenerate instead. */")
+    emit("")
+    emit("#ifndef SCANNER_KEYWORDS_H")
+    emit("#define SCANNER_KEYWORDS_H")
+    emit("")
+    emit("#include <stddef.h>")
+    emit("#include <stdint.h>")
+    emit("#include <string.h>")
+    emit("")
+    emit("/** @brief Keyword properties returned by keyword_lookup() */")
+    emit("enum KeywordFlag {")
+    width = max(len(name) for name, _ in FLAGS) + len("KW_ = 1 << 0,")
+    for bit, (name, doc) in enumerate(FLAGS):
+        decl = f"KW_{name} = 1 << {bit},"
+        emit(f"    {decl:<{width}} /**< {doc} */")
+    emit("};")
+    emit("")
+    emit("/** @brief Result of keyword_lookup() */")
+    emit("struct KeywordInfo {")
+    emit("    uint16_t flags; /**< KW_* bitmask, 0 for other identifiers */")
+    emit("    uint8_t index;  /**< Position among CONDITIONAL/SECTION_TOKEN */")
+    emit("};")
+    emit("")
+    emit("/** @brief Length of the longest keyword */")
+    emit(f"#define KW_MAX_LEN {max(by_len)}")
+    emit("")
+    emit("/**")
+    emit(" * @brief Classify an identifier")
+    emit(" *")
+    emit(" * @param id The identifier (not null-terminated)")
+    emit(" * @param len Length of the identifier")
+    emit(" * @return The keyword properties, flags are 0 for non-keywords")
+    emit(" */")
+    emit("static inline struct KeywordInfo keyword_lookup(const char *id, "
+         "size_t len)")
+    emit("{")
+    emit("    struct KeywordInfo kw = {0, 0};")
+    emit("")
+    emit("    switch (len) {")
+    for length in sorted(by_len):
+        emit(f"    case {length}:")
+        emit("        switch (id[0]) {")
+        for first in sorted(by_len[length]):
+            emit(f"        case '{first}':")
+            for name, flags, index in by_len[length][first]:
+                emit(f'            if (memcmp(id, "{name}", {length}) == 0) {{')
+                emit(f"                kw.flags = {flags_expr(flags)};")
+                if index:
+                    emit(f"                kw.index = {index};")
+                emit("                return kw;")
+                emit("            }")
+            emit("            break;")
+        emit("        }")
+        emit("        break;")
+    emit("    }")
+    emit("")
+    emit("    return kw;")
+    emit("}")
+    emit("")
+    emit("#endif /* SCANNER_KEYWORDS_H */")
+
+    return "\n".join(out) + "\n"
+
+
+def main():
+    repo = Path(__file__).resolve().parent.parent
+
+    parser = argparse.ArgumentParser(
+        description="Generate the rpmspec scanner keyword classifier",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument(
+        "--table",
+        type=Path,
+        default=repo / "rpmspec" / "src" / "scanner_keywords.txt",
+        metavar="FILE",
+        help="Keyword table (default: rpmspec/src/scanner_keywords.txt)",
+    )
+    parser.add_argument(
+        "--grammar",
+        type=Path,
+        default=repo / "rpmspec" / "src" / "grammar.json",
+        metavar="FILE",
+        help="grammar.json to validate against "
+        "(default: rpmspec/src/grammar.json)",
+    )
+    parser.add_argument(
+        "--output",
+        type=Path,
+        default=repo / "rpmspec" / "src" / "scanner_keywords.h",
+        metavar="FILE",
+        help="Header to write (default: rpmspec/src/scanner_keywords.h)",
+    )
+    args = parser.parse_args()
+
+    try:
+        keywords = parse_table(args.table)
+    except (OSError, ValueError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    missing = check_grammar(keywords, grammar_strings(args.grammar))
+    if missing:
+        print(
+            f"error: keywords not found in {args.grammar}: "
+            + ", ".join(missing),
+            file=sys.stderr,
+        )
+        return 1
+
+    args.output.write_text(generate(keywords, args.table.name))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2026 Andreas Schneider <asn@cryptomilk.org>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+"""
+Report the parse table sizes of a generated parser.c and attribute its
+large states to grammar rules.
+
+tree-sitter stores a state with more than 64 entries as a dense row over all
+symbols (ts_parse_table, LARGE_STATE_COUNT rows), the others in the
+compressed ts_small_parse_table. The dense rows are most of the table bytes
+a parse touches, so they are what to shrink.
+
+Every large state is attributed to one rule:
+
+  goto RULE     the state has gotos; RULE is the repetition it continues
+                (e.g. the content of a section), else its last goto
+  reduce RULE   the state only has actions, and most of them reduce RULE;
+                its lookahead set is as large as everything that can follow
+                RULE, typically a macro or conditional used in many contexts
+  shift         the state only shifts
+
+The terminals found in the most large states are listed as well. Keywords
+among them are candidates for keyword extraction with `word`, which lexes
+them as one identifier token.
+
+Write the results with --json before a grammar change and pass that file
+to --compare after it, which lists the sizes of both side by side. Cache
+misses are not measured here; the ts-bench-cache target runs the benchmark
+under perf for that:
+
+    perf stat -e cache-misses,L1-dcache-load-misses \\
+        build/tests/bench/bench-parse -r 20 example.spec
+"""
+
+import argparse
+import collections
+import json
+import re
+import sys
+from pathlib import Path
+
+# TSParseActionEntry is a union of 8 bytes
+ACTION_ENTRY_BYTES = 8
+# ts_small_parse_table_map has one uint32_t per small state
+SMALL_MAP_ENTRY_BYTES = 4
+
+
+def table(src, declaration):
+    """Return the body of the array declared by declaration"""
+    start = src.index(declaration)
+    start = src.index("{", start) + 1
+    end = src.index("\n};\n", start)
+    return src[start:end]
+
+
+def define(src, name):
+    match = re.search(r"^#define %s (\d+)$" % name, src, re.MULTILINE)
+    if match is None:
+        sys.exit("parser.c: %s not found" % name)
+    return int(match.group(1))
+
+
+def read_parse_actions(src):
+    """Map each index of ts_parse_actions to its list of (kind, symbol)"""
+    body = table(src, "static const TSParseActionEntry ts_parse_actions[]")
+    actions = {}
+    count = 0
+    for match in re.finditer(r"^  \[(\d+)\] = \{\.entry = [^}]*\}\},?(.*)$",
+                             body, re.MULTILINE):
+        items = re.findall(r"(SHIFT\w*|REDUCE|RECOVER|ACCEPT_INPUT)"
+                           r"\(([^,)]*)", match.group(2))
+        actions[int(match.group(1))] = items
+        count = int(match.group(1)) + 1 + len(items)
+    return actions, count
+
+
+def large_states(src):
+    """Yield (state, actions, gotos) of the dense rows of ts_parse_table"""
+    body = table(src, "static const uint16_t ts_parse_table[")
+    parts = re.split(r"^  \[STATE\((\d+)\)\] = \{$", body, flags=re.MULTILINE)
+    for i in range(1, len(parts), 2):
+        row = parts[i + 1]
+        actions = re.findall(r"\[(\w+)\] = ACTIONS\((\d+)\)", row)
+        gotos = re.findall(r"\[(\w+)\] = STATE\((\d+)\)", row)
+        yield int(parts[i]), actions, gotos
+
+
+def small_encoding_bytes(actions, gotos):
+    """Bytes the state would take in ts_small_parse_table
+
+    A small state is its group count followed by one group per distinct
+    value: the value, the number of symbols and the symbols.
+    """
+    groups = collections.Counter(
+        ["A" + value for _, value in actions]
+        + ["S" + value for _, value in gotos]
+    )
+    words = 1 + sum(2 + n for n in groups.values())
+    return words * 2 + SMALL_MAP_ENTRY_BYTES
+
+
+def attribute(actions, gotos, parse_actions):
+    if gotos:
+        repeats = [symbol for symbol, _ in gotos if "_repeat" in symbol]
+        return "goto " + (repeats[0] if repeats else gotos[-1][0])
+    reduced = collections.Counter(
+        symbol
+        for _, index in actions
+        for kind, symbol in parse_actions.get(int(index), [])
+        if kind == "REDUCE"
+    )
+    if reduced:
+        return "reduce " + reduced.most_common(1)[0][0]
+    return "shift"
+
+
+def analyze(path):
+    src = path.read_text()
+    state_count = define(src, "STATE_COUNT")
+    large_count = define(src, "LARGE_STATE_COUNT")
+    symbol_count = define(src, "SYMBOL_COUNT")
+    token_count = define(src, "TOKEN_COUNT")
+
+    small_words = len(re.findall(
+        r"\b(?:ACTIONS|STATE)\(\d+\)|\b\d+,|\b[a-z_]\w*,",
+        table(src, "static const uint16_t ts_small_parse_table[]")))
+    parse_actions, action_count = read_parse_actions(src)
+
+    row_bytes = symbol_count * 2
+    rules = collections.defaultdict(lambda: [0, 0])
+    terminals = collections.Counter()
+    entries = collections.Counter()
+    as_small = 0
+
+    for _, actions, gotos in large_states(src):
+        rule = attribute(actions, gotos, parse_actions)
+        small = small_encoding_bytes(actions, gotos)
+        rules[rule][0] += 1
+        rules[rule][1] += row_bytes - small
+        as_small += small
+        entries[(len(actions) + len(gotos)) // 50 * 50] += 1
+        terminals.update(symbol for symbol, _ in actions)
+
+    return {
+        "parser": str(path),
+        "state_count": state_count,
+        "large_state_count": large_count,
+        "symbol_count": symbol_count,
+        "token_count": token_count,
+        "large_table_bytes": large_count * row_bytes,
+        "large_as_small_bytes": as_small,
+        "small_table_bytes": small_words * 2
+        + (state_count - large_count) * SMALL_MAP_ENTRY_BYTES,
+        "parse_actions_bytes": action_count * ACTION_ENTRY_BYTES,
+        "large_state_entries": {
+            "%d-%d" % (low, low + 49): n for low, n in sorted(entries.items())
+        },
+        "rules": [
+            {"rule": rule, "large_states": n, "excess_bytes": excess}
+            for rule, (n, excess) in sorted(
+                rules.items(), key=lambda item: -item[1][1]
+            )
+        ],
+        "terminals": [
+            {"symbol": symbol, "large_states": n}
+            for symbol, n in terminals.most_common()
+        ],
+    }
+
+
+def kib(n):
+    return "%.1f KiB" % (n / 1024.0)
+
+
+def print_report(stats, top):
+    print("%s:" % stats["parser"])
+    print("  states %d, large %d, symbols %d (%d tokens)" % (
+        stats["state_count"],
+        stats["large_state_count"],
+        stats["symbol_count"],
+        stats["token_count"],
+    ))
+    print("  large table   %12s" % kib(stats["large_table_bytes"]))
+    print("  small table   %12s" % kib(stats["small_table_bytes"]))
+    print("  parse actions %12s" % kib(stats["parse_actions_bytes"]))
+    print("  large states in the small encoding would take %s" %
+          kib(stats["large_as_small_bytes"]))
+    print()
+    print("Entries per large state:")
+    for bucket, n in stats["large_state_entries"].items():
+        print("  %-9s %6d" % (bucket, n))
+    print()
+    print("Large states by rule (excess = dense row - small encoding):")
+    print("  %6s %12s  %s" % ("states", "excess", "rule"))
+    for rule in stats["rules"][:top]:
+        print("  %6d %12s  %s" % (
+            rule["large_states"], kib(rule["excess_bytes"]), rule["rule"]))
+    print()
+    print("Terminals in the most large states:")
+    for terminal in stats["terminals"][:top]:
+        print("  %6d  %s" % (terminal["large_states"], terminal["symbol"]))
+
+
+# Sizes listed by --compare, in order
+COMPARED = [
+    ("states", "state_count", str),
+    ("large states", "large_state_count", str),
+    ("symbols", "symbol_count", str),
+    ("large table", "large_table_bytes", kib),
+    ("small table", "small_table_bytes", kib),
+    ("parse actions", "parse_actions_bytes", kib),
+]
+
+
+def print_comparison(before, after):
+    print()
+    print("Compared with %s:" % before["parser"])
+    print("  %-14s %12s %12s %8s" % ("", "before", "after", "change"))
+    for label, key, fmt in COMPARED:
+        old = before[key]
+        new = after[key]
+        print("  %-14s %12s %12s %7.1f%%" % (
+            label, fmt(old), fmt(new),
+            100.0 * (new - old) / old if old else 0.0))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Report parse table sizes and attribute large states",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument(
+        "--parser",
+        type=Path,
+        default=Path("rpmspec/src/parser.c"),
+        metavar="PATH",
+        help="Generated parser (default: rpmspec/src/parser.c)",
+    )
+    parser.add_argument(
+        "--top",
+        type=int,
+        default=25,
+        metavar="N",
+        help="Number of rules and terminals to list (default: 25)",
+    )
+    parser.add_argument(
+        "--json",
+        type=Path,
+        metavar="FILE",
+        help="Also write all results as JSON to FILE",
+    )
+    parser.add_argument(
+        "--compare",
+        type=Path,
+        metavar="FILE",
+        help="Compare the sizes with an earlier --json FILE",
+    )
+    args = parser.parse_args()
+
+    stats = analyze(args.parser)
+    print_report(stats, args.top)
+    if args.compare is not None:
+        print_comparison(json.loads(args.compare.read_text()), stats)
+    if args.json is not None:
+        args.json.write_text(json.dumps(stats, indent=2) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,550 @@
+/**
+ * @file forks.c
+ * @brief GLR fork report for the rpmspec grammar
+ *
+ * Where the parse table has more than one action for a lookahead, the
+ * parser splits its stack into versions which run side by side until all
+ * but one fail, or until they reach the same state and are merged. Each
+ * entry of `conflicts` in grammar.js allows such forks. A fork copies the
+ * stack head and parses the following tokens once per version.
+ *
+ * The counts come from the parse log of tree-sitter, which is written
+ * before every step of a stack version:
+ *
+ *   process version:0, version_count:1, state:42, row:3, col:0
+ *
+ * A version count higher than at the step before is a fork, a lower one is
+ * a version merged into another or dropped while the stack is condensed. A
+ * fork is attributed to the first rule reduced in the step that caused it,
+ * which is one of the rules of the conflict it came from. Forks in error
+ * recovery are counted separately.
+ *
+ * Directories are walked recursively, .sh files (rpmbash) are skipped.
+ *
+ * -w writes the whole log to a file, one message per line and lexer
+ * messages indented by two spaces. -r reads such a log back instead of
+ * parsing, which reports on a log captured elsewhere and checks the
+ * reading of the log itself: each "new_parse" starts the next of the
+ * files given, which only provide the byte counts. Lines starting with #
+ * are comments.
+ *
+ * Usage:
+ *   bench-forks [-n TOP] [-w LOG] PATH...
+ *   bench-forks [-n TOP] -r LOG FILE...
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+#define RULE_NAME_MAX 64
+
+/** @brief Forks attributed to one rule */
+struct Rule {
+    char name[RULE_NAME_MAX];
+    uint64_t forks;
+};
+
+/** @brief Forks of one file */
+struct File {
+    char *path;
+    size_t len;
+    uint64_t forks;
+};
+
+/** @brief State of the log parser and totals of all files */
+struct Report {
+    /* The current step */
+    uint32_t version_count;
+    char reduced[RULE_NAME_MAX];
+    int recovering;
+
+    uint64_t bytes;
+    uint64_t steps;
+    uint64_t ambiguous_steps; /**< Steps with more than one version */
+    uint64_t forks;
+    uint64_t condensed; /**< Versions merged or dropped */
+    uint32_t max_versions;
+
+    struct Rule *rules;
+    size_t rule_count;
+    size_t rule_cap;
+
+    struct File *files;
+    size_t file_count;
+    size_t file_cap;
+
+    FILE *log; /**< Copy of the log, or NULL */
+};
+
+/* ========================================================================== */
+/* PARSE LOG                                                                  */
+/* ========================================================================== */
+
+static void attribute(struct Report *report, const char *name, uint32_t forks)
+{
+    struct Rule *rule;
+
+    for (size_t i = 0; i < report->rule_count; i++) {
+        if (strcmp(report->rules[i].name, name) == 0) {
+            report->rules[i].forks += forks;
+            return;
+        }
+    }
+
+    if (report->rule_count == report->rule_cap) {
+        report->rule_cap = report->rule_cap ? report->rule_cap * 2 : 16;
+        report->rules =
+            realloc(report->rules, report->rule_cap * sizeof(*report->rules));
+        if (report->rules == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    rule = &report->rules[report->rule_count++];
+    snprintf(rule->name, sizeof(rule->name), "%s", name);
+    rule->forks = forks;
+}
+
+/** @brief Account the step of a version, given the current version count */
+static void step(struct Report *report, uint32_t version_count)
+{
+    report->steps++;
+    if (version_count > 1) {
+        report->ambiguous_steps++;
+    }
+    if (version_count > report->max_versions) {
+        report->max_versions = version_count;
+    }
+
+    /* The count is 0 before the first step of a file */
+    if (report->version_count > 0 && version_count > report->version_count) {
+        uint32_t forks = version_count - report->version_count;
+        const char *cause = report->reduced;
+
+        if (report->recovering) {
+            cause = "(error recovery)";
+        } else if (cause[0] == '\0') {
+            cause = "(no reduce)";
+        }
+        report->forks += forks;
+        report->files[report->file_count - 1].forks += forks;
+        attribute(report, cause, forks);
+    } else if (version_count < report->version_count) {
+        report->condensed += report->version_count - version_count;
+    }
+
+    report->version_count = version_count;
+    report->reduced[0] = '\0';
+    report->recovering = 0;
+}
+
+static int has_prefix(const char *str, const char *prefix)
+{
+    return strncmp(str, prefix, strlen(prefix)) == 0;
+}
+
+static void on_log(void *payload, TSLogType type, const char *msg)
+{
+    struct Report *report = payload;
+    unsigned version;
+    unsigned version_count;
+
+    if (report->log != NULL) {
+        fprintf(report->log,
+                "%s%s\n",
+                type == TSLogTypeLex ? "  " : "",
+                msg);
+    }
+    if (type != TSLogTypeParse) {
+        return;
+    }
+
+    if (sscanf(msg,
+               "process version:%u, version_count:%u",
+               &version,
+               &version_count) == 2) {
+        step(report, version_count);
+    } else if (has_prefix(msg, "reduce sym:") && report->reduced[0] == '\0') {
+        const char *name = msg + strlen("reduce sym:");
+        size_t len = strcspn(name, ",");
+
+        if (len >= sizeof(report->reduced)) {
+            len = sizeof(report->reduced) - 1;
+        }
+        memcpy(report->reduced, name, len);
+        report->reduced[len] = '\0';
+    } else if (has_prefix(msg, "detect_error") || has_prefix(msg, "recover") ||
+               has_prefix(msg, "skip_token")) {
+        report->recovering = 1;
+    }
+}
+
+/* ========================================================================== */
+/* CORPUS                                                                     */
+/* ========================================================================== */
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *fp = fopen(path, "rb");
+    char *data = NULL;
+    size_t cap = 0;
+    size_t n;
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    *len = 0;
+    do {
+        if (*len + 65536 > cap) {
+            cap = (*len + 65536) * 2;
+            data = realloc(data, cap);
+            if (data == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        n = fread(data + *len, 1, cap - *len, fp);
+        *len += n;
+    } while (n > 0);
+    fclose(fp);
+
+    return data;
+}
+
+static int has_suffix(const char *str, const char *suffix)
+{
+    size_t len = strlen(str);
+    size_t n = strlen(suffix);
+
+    return len >= n && strcmp(str + len - n, suffix) == 0;
+}
+
+/** @brief Start the counts of a file */
+static void add_file(struct Report *report, const char *path, size_t len)
+{
+    struct File *file;
+
+    if (report->file_count == report->file_cap) {
+        report->file_cap = report->file_cap ? report->file_cap * 2 : 64;
+        report->files =
+            realloc(report->files, report->file_cap * sizeof(*report->files));
+        if (report->files == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    file = &report->files[report->file_count++];
+    file->path = strdup(path);
+    file->len = len;
+    file->forks = 0;
+
+    report->version_count = 0;
+    report->bytes += len;
+}
+
+static int parse_file(TSParser *parser,
+                      struct Report *report,
+                      const char *path)
+{
+    size_t len;
+    char *data = read_file(path, &len);
+    TSTree *tree;
+
+    if (data == NULL) {
+        return -1;
+    }
+
+    add_file(report, path, len);
+    tree = ts_parser_parse_string(parser, NULL, data, (uint32_t)len);
+    ts_tree_delete(tree);
+    free(data);
+
+    return 0;
+}
+
+/** @brief Parse a file, or all files below a directory */
+static int parse_path(TSParser *parser,
+                      struct Report *report,
+                      const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        int rc = 0;
+
+        if (dir == NULL) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        while (rc == 0 && (entry = readdir(dir)) != NULL) {
+            char child[4096];
+
+            if (entry->d_name[0] == '.' || has_suffix(entry->d_name, ".sh")) {
+                continue;
+            }
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            rc = parse_path(parser, report, child);
+        }
+        closedir(dir);
+        return rc;
+    }
+
+    return parse_file(parser, report, path);
+}
+
+/**
+ * @brief Read a log written with -w back, for the files it was written for
+ *
+ * @return 0, or -1 if a file can't be read or the number of parses in the
+ *         log doesn't match the number of files
+ */
+static int replay(struct Report *report,
+                  const char *log,
+                  char *const *paths,
+                  int count)
+{
+    FILE *fp = fopen(log, "r");
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    int parses = 0;
+    int rc = 0;
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: %s\n", log, strerror(errno));
+        return -1;
+    }
+    while (rc == 0 && (len = getline(&line, &cap, fp)) != -1) {
+        TSLogType type = TSLogTypeParse;
+        const char *msg = line;
+
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+        if (has_prefix(line, "  ")) {
+            type = TSLogTypeLex;
+            msg += 2;
+        } else if (strcmp(line, "new_parse") == 0) {
+            size_t size;
+            char *data;
+
+            if (parses == count) {
+                fprintf(stderr, "%s: more parses than files\n", log);
+                rc = -1;
+                break;
+            }
+            data = read_file(paths[parses], &size);
+            if (data == NULL) {
+                rc = -1;
+                break;
+            }
+            free(data);
+            add_file(report, paths[parses++], size);
+        }
+        if (report->file_count == 0) {
+            fprintf(stderr, "%s: log doesn't start with new_parse\n", log);
+            rc = -1;
+            break;
+        }
+        on_log(report, type, msg);
+    }
+    if (rc == 0 && parses != count) {
+        fprintf(stderr, "%s: %d parses for %d files\n", log, parses, count);
+        rc = -1;
+    }
+
+    free(line);
+    fclose(fp);
+    return rc;
+}
+
+/* ========================================================================== */
+/* REPORT                                                                     */
+/* ========================================================================== */
+
+static int compare_rules(const void *a, const void *b)
+{
+    const struct Rule *x = a;
+    const struct Rule *y = b;
+
+    /* Ties by name, so the report doesn't depend on qsort */
+    if (x->forks != y->forks) {
+        return (x->forks < y->forks) - (x->forks > y->forks);
+    }
+    return strcmp(x->name, y->name);
+}
+
+static double forks_per_kb(uint64_t forks, uint64_t bytes)
+{
+    return bytes > 0 ? (double)forks * 1024.0 / (double)bytes : 0.0;
+}
+
+static int compare_files(const void *a, const void *b)
+{
+    const struct File *x = a;
+    const struct File *y = b;
+    double fx = forks_per_kb(x->forks, x->len);
+    double fy = forks_per_kb(y->forks, y->len);
+
+    if (fx != fy) {
+        return (fx < fy) - (fx > fy);
+    }
+    return strcmp(x->path, y->path);
+}
+
+static void print_report(struct Report *report, size_t top)
+{
+    printf("files %zu, bytes %llu, steps %llu, %.1f%% with several versions\n",
+           report->file_count,
+           (unsigned long long)report->bytes,
+           (unsigned long long)report->steps,
+           report->steps > 0 ? 100.0 * (double)report->ambiguous_steps /
+                                   (double)report->steps
+                             : 0.0);
+    printf("forks %llu (%.2f/KB), merged or dropped %llu (%.2f/KB), "
+           "max versions %u\n",
+           (unsigned long long)report->forks,
+           forks_per_kb(report->forks, report->bytes),
+           (unsigned long long)report->condensed,
+           forks_per_kb(report->condensed, report->bytes),
+           report->max_versions);
+
+    qsort(report->rules,
+          report->rule_count,
+          sizeof(*report->rules),
+          compare_rules);
+    printf("\n%-40s %10s %8s %7s\n", "rule", "forks", "per KB", "share");
+    for (size_t i = 0; i < report->rule_count && i < top; i++) {
+        /* A rule is only listed after it caused a fork */
+        printf("%-40s %10llu %8.2f %6.1f%%\n",
+               report->rules[i].name,
+               (unsigned long long)report->rules[i].forks,
+               forks_per_kb(report->rules[i].forks, report->bytes),
+               100.0 * (double)report->rules[i].forks /
+                   (double)report->forks);
+    }
+
+    qsort(report->files,
+          report->file_count,
+          sizeof(*report->files),
+          compare_files);
+    printf("\n%-40s %10s %10s %8s\n", "file", "bytes", "forks", "per KB");
+    for (size_t i = 0; i < report->file_count && i < top; i++) {
+        const char *name = strrchr(report->files[i].path, '/');
+
+        printf("%-40s %10zu %10llu %8.2f\n",
+               name != NULL ? name + 1 : report->files[i].path,
+               report->files[i].len,
+               (unsigned long long)report->files[i].forks,
+               forks_per_kb(report->files[i].forks, report->files[i].len));
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-n TOP] [-w LOG] PATH...\n"
+            "       %s [-n TOP] -r LOG FILE...\n"
+            "\n"
+            "  -n TOP  Number of rules and files to list (default: 15)\n"
+            "  -w LOG  Write the parse log to LOG\n"
+            "  -r LOG  Report on LOG, written for FILE..., instead of "
+            "parsing\n",
+            prog,
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct Report report = {0};
+    TSLogger logger = {.payload = &report, .log = on_log};
+    size_t top = 15;
+    const char *write_log = NULL;
+    const char *read_log = NULL;
+    TSParser *parser;
+    int rc = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:w:r:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            top = (size_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            write_log = optarg;
+            break;
+        case 'r':
+            read_log = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc || (write_log != NULL && read_log != NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (read_log != NULL) {
+        rc = replay(&report, read_log, argv + optind, argc - optind);
+    } else {
+        if (write_log != NULL) {
+            report.log = fopen(write_log, "w");
+            if (report.log == NULL) {
+                fprintf(stderr, "%s: %s\n", write_log, strerror(errno));
+                return 1;
+            }
+        }
+
+        parser = ts_parser_new();
+        if (!ts_parser_set_language(parser, tree_sitter_rpmspec())) {
+            fprintf(stderr, "Incompatible tree-sitter library\n");
+            return 1;
+        }
+        ts_parser_set_logger(parser, logger);
+
+        for (int i = optind; rc == 0 && i < argc; i++) {
+            rc = parse_path(parser, &report, argv[i]);
+        }
+        ts_parser_delete(parser);
+
+        if (report.log != NULL && fclose(report.log) != 0) {
+            fprintf(stderr, "%s: %s\n", write_log, strerror(errno));
+            rc = -1;
+        }
+    }
+
+    if (rc == 0) {
+        print_report(&report, top);
+    }
+
+    for (size_t i = 0; i < report.file_count; i++) {
+        free(report.files[i].path);
+    }
+    free(report.files);
+    free(report.rules);
+    return rc == 0 ? 0 : 1;
+}
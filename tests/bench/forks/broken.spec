@@ -0,0 +1,2 @@
+Name: foo
+%if
@@ -0,0 +1,4 @@
+Name: foo
+
+%files
+/usr/lib/%{name}/a
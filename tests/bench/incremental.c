@@ -0,0 +1,551 @@
+/**
+ * @file incremental.c
+ * @brief Incremental reparse benchmark for the rpmspec grammar
+ *
+ * Applies keystroke-sized edits to a spec and reparses after each one, the
+ * way an editor does. For every reparse it measures the latency and the
+ * share of nodes tree-sitter reused from the old tree. Subtrees are only
+ * reused if the external scanner state before them matches, so a low reuse
+ * ratio points at scanner state that depends on more than the input (see
+ * "Serialized Scanner State" in rpmspec/DESIGN.md).
+ *
+ * Usage:
+ *   bench-incremental [-n EDITS] [-s SEED] [-g PACKAGES] [FILE...]
+ *
+ * Every FILE is benchmarked, and with -g a synthetic spec with PACKAGES
+ * subpackages, each wrapped in conditionals, is benchmarked as well.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+/** @brief Growable byte buffer holding the document */
+struct Buffer {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+/** @brief Results of all reparses of one document */
+struct Results {
+    double *latency_ms; /**< Latency of every reparse */
+    double *reused;     /**< Reused node ratio of every reparse */
+    size_t count;
+};
+
+/* ========================================================================== */
+/* DOCUMENT                                                                   */
+/* ========================================================================== */
+
+static void buffer_reserve(struct Buffer *buf, size_t len)
+{
+    if (len <= buf->cap) {
+        return;
+    }
+    buf->cap = len * 2;
+    buf->data = realloc(buf->data, buf->cap);
+    if (buf->data == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+}
+
+static void buffer_append(struct Buffer *buf, const char *str)
+{
+    size_t n = strlen(str);
+
+    buffer_reserve(buf, buf->len + n);
+    memcpy(buf->data + buf->len, str, n);
+    buf->len += n;
+}
+
+static int buffer_load(struct Buffer *buf, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    char chunk[65536];
+    size_t n;
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        buffer_reserve(buf, buf->len + n);
+        memcpy(buf->data + buf->len, chunk, n);
+        buf->len += n;
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+/**
+ * @brief Generate a spec with @p packages conditional subpackages
+ *
+ * Each subpackage is wrapped in a top-level %if and has conditionals in its
+ * %files section, so edits land in and around conditional bodies.
+ */
+static void generate_spec(struct Buffer *buf, unsigned packages)
+{
+    char line[512];
+
+    buffer_append(buf,
+                  "Name:           synthetic\n"
+                  "Version:        1.0\n"
+                  "Release:        1%{?dist}\n"
+                  "Summary:        Synthetic incremental benchmark\n"
+                  "License:        MIT\n"
+                  "\n"
+                  "%description\n"
+                  "Synthetic spec for the incremental reparse benchmark.\n"
+                  "\n");
+
+    for (unsigned i = 0; i < packages; i++) {
+        snprintf(line,
+                 sizeof(line),
+                 "%%if %%{with sub%u}\n"
+                 "%%package sub%u\n"
+                 "Summary:        Subpackage %u\n"
+                 "Requires:       %%{name}%%{?_isa} = %%{version}-%%{release}\n"
+                 "\n"
+                 "%%description sub%u\n"
+                 "Subpackage %u of the synthetic spec.\n"
+                 "%%endif\n"
+                 "\n",
+                 i,
+                 i,
+                 i,
+                 i,
+                 i);
+        buffer_append(buf, line);
+    }
+
+    buffer_append(buf,
+                  "%prep\n"
+                  "%autosetup -p1\n"
+                  "\n"
+                  "%build\n"
+                  "%if %{with tests}\n"
+                  "%configure --enable-tests\n"
+                  "%else\n"
+                  "%configure\n"
+                  "%endif\n"
+                  "%make_build\n"
+                  "\n"
+                  "%install\n"
+                  "%make_install\n"
+                  "\n");
+
+    for (unsigned i = 0; i < packages; i++) {
+        snprintf(line,
+                 sizeof(line),
+                 "%%if %%{with sub%u}\n"
+                 "%%files sub%u\n"
+                 "%%{_bindir}/tool%u\n"
+                 "%%ifarch x86_64\n"
+                 "%%{_libdir}/tool%u/x86_64.so\n"
+                 "%%endif\n"
+                 "%%endif\n"
+                 "\n",
+                 i,
+                 i,
+                 i,
+                 i);
+        buffer_append(buf, line);
+    }
+
+    buffer_append(buf,
+                  "%changelog\n"
+                  "* Mon Jan 05 2026 Packager <packager@example.org> - 1.0-1\n"
+                  "- Initial package\n");
+}
+
+/** @brief Row and column of a byte offset */
+static TSPoint point_at(const struct Buffer *buf, size_t offset)
+{
+    TSPoint point = {0, 0};
+
+    for (size_t i = 0; i < offset; i++) {
+        if (buf->data[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+
+    return point;
+}
+
+/**
+ * @brief Replace @p old_len bytes at @p offset with @p text
+ *
+ * @return The edit to pass to ts_tree_edit()
+ */
+static TSInputEdit buffer_edit(struct Buffer *buf,
+                               size_t offset,
+                               size_t old_len,
+                               const char *text)
+{
+    size_t new_len = strlen(text);
+    TSInputEdit edit = {
+        .start_byte = (uint32_t)offset,
+        .old_end_byte = (uint32_t)(offset + old_len),
+        .new_end_byte = (uint32_t)(offset + new_len),
+        .start_point = point_at(buf, offset),
+        .old_end_point = point_at(buf, offset + old_len),
+    };
+
+    buffer_reserve(buf, buf->len - old_len + new_len);
+    memmove(buf->data + offset + new_len,
+            buf->data + offset + old_len,
+            buf->len - offset - old_len);
+    memcpy(buf->data + offset, text, new_len);
+    buf->len = buf->len - old_len + new_len;
+    edit.new_end_point = point_at(buf, offset + new_len);
+
+    return edit;
+}
+
+/* ========================================================================== */
+/* NODE REUSE                                                                 */
+/* ========================================================================== */
+
+/** @brief Open addressing set of node ids */
+struct IdSet {
+    const void **slots;
+    size_t mask;
+};
+
+static size_t id_hash(const void *id)
+{
+    uint64_t h = (uint64_t)(uintptr_t)id;
+
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    return (size_t)h;
+}
+
+static void id_set_init(struct IdSet *set, size_t count)
+{
+    size_t size = 16;
+
+    while (size < count * 2) {
+        size *= 2;
+    }
+    set->slots = calloc(size, sizeof(*set->slots));
+    if (set->slots == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    set->mask = size - 1;
+}
+
+static void id_set_add(struct IdSet *set, const void *id)
+{
+    size_t i = id_hash(id) & set->mask;
+
+    while (set->slots[i] != NULL && set->slots[i] != id) {
+        i = (i + 1) & set->mask;
+    }
+    set->slots[i] = id;
+}
+
+static int id_set_contains(const struct IdSet *set, const void *id)
+{
+    size_t i = id_hash(id) & set->mask;
+
+    while (set->slots[i] != NULL) {
+        if (set->slots[i] == id) {
+            return 1;
+        }
+        i = (i + 1) & set->mask;
+    }
+    return 0;
+}
+
+/**
+ * @brief Collect the ids of all inner nodes of a tree
+ *
+ * Leaves are skipped: small leaves are stored inline in their parent, so
+ * their ids are addresses inside the parent and not stable across trees.
+ */
+static void collect_ids(TSTreeCursor *cursor, struct IdSet *set)
+{
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(cursor);
+
+        if (ts_node_child_count(node) > 0) {
+            id_set_add(set, node.id);
+            if (ts_tree_cursor_goto_first_child(cursor)) {
+                continue;
+            }
+        }
+        while (!ts_tree_cursor_goto_next_sibling(cursor)) {
+            if (!ts_tree_cursor_goto_parent(cursor)) {
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Count the nodes of @p tree inside subtrees taken from the old tree
+ *
+ * A reused subtree keeps its identity, so it has the same id in both trees.
+ * All nodes below a reused inner node count as reused.
+ */
+static uint32_t count_reused(TSTreeCursor *cursor, const struct IdSet *old)
+{
+    uint32_t reused = 0;
+
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(cursor);
+        int descend = 0;
+
+        if (ts_node_child_count(node) > 0) {
+            if (id_set_contains(old, node.id)) {
+                reused += ts_node_descendant_count(node);
+            } else {
+                descend = ts_tree_cursor_goto_first_child(cursor);
+            }
+        }
+        if (descend) {
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(cursor)) {
+            if (!ts_tree_cursor_goto_parent(cursor)) {
+                return reused;
+            }
+        }
+    }
+}
+
+/* ========================================================================== */
+/* BENCHMARK                                                                  */
+/* ========================================================================== */
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng_state = 1;
+
+static uint32_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile(double *values, size_t count, double p)
+{
+    qsort(values, count, sizeof(*values), compare_double);
+    return values[(size_t)(p * (double)(count - 1) + 0.5)];
+}
+
+/**
+ * @brief Apply one edit, reparse and record latency and node reuse
+ */
+static TSTree *reparse(TSParser *parser,
+                       TSTree *tree,
+                       struct Buffer *buf,
+                       size_t offset,
+                       size_t old_len,
+                       const char *text,
+                       struct Results *results)
+{
+    TSInputEdit edit = buffer_edit(buf, offset, old_len, text);
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    struct IdSet old;
+    TSTree *new_tree;
+    double start;
+    uint32_t total;
+    uint32_t reused;
+
+    id_set_init(&old, ts_node_descendant_count(ts_tree_root_node(tree)));
+    collect_ids(&cursor, &old);
+    ts_tree_cursor_delete(&cursor);
+
+    ts_tree_edit(tree, &edit);
+    start = now_ms();
+    new_tree =
+        ts_parser_parse_string(parser, tree, buf->data, (uint32_t)buf->len);
+    results->latency_ms[results->count] = now_ms() - start;
+
+    cursor = ts_tree_cursor_new(ts_tree_root_node(new_tree));
+    total = ts_node_descendant_count(ts_tree_root_node(new_tree));
+    reused = count_reused(&cursor, &old);
+    ts_tree_cursor_delete(&cursor);
+    results->reused[results->count] = total > 0 ? (double)reused / total : 0.0;
+    results->count++;
+
+    free(old.slots);
+    ts_tree_delete(tree);
+    return new_tree;
+}
+
+/**
+ * @brief Benchmark @p edits keystrokes on one document
+ *
+ * Every keystroke types one character at a random offset and deletes it
+ * again, so the document returns to its original content after each pair.
+ */
+static void bench_document(TSParser *parser,
+                           const char *name,
+                           struct Buffer *buf,
+                           unsigned edits)
+{
+    static const char KEYS[] = "x%{ \n";
+    struct Results results = {
+        .latency_ms = calloc(edits * 2, sizeof(double)),
+        .reused = calloc(edits * 2, sizeof(double)),
+    };
+    double start = now_ms();
+    TSTree *tree =
+        ts_parser_parse_string(parser, NULL, buf->data, (uint32_t)buf->len);
+    double full_ms = now_ms() - start;
+    uint32_t nodes = ts_node_descendant_count(ts_tree_root_node(tree));
+    double reused_sum = 0.0;
+    double reused_min = 1.0;
+
+    if (results.latency_ms == NULL || results.reused == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    for (unsigned i = 0; i < edits && buf->len > 0; i++) {
+        size_t offset = rng_next() % buf->len;
+        char key[2] = {KEYS[rng_next() % (sizeof(KEYS) - 1)], '\0'};
+
+        tree = reparse(parser, tree, buf, offset, 0, key, &results);
+        tree = reparse(parser, tree, buf, offset, 1, "", &results);
+    }
+    ts_tree_delete(tree);
+
+    for (size_t i = 0; i < results.count; i++) {
+        reused_sum += results.reused[i];
+        if (results.reused[i] < reused_min) {
+            reused_min = results.reused[i];
+        }
+    }
+
+    printf("%-28s %10zu %8u %9.3f", name, buf->len, nodes, full_ms);
+    if (results.count > 0) {
+        printf(" %8.3f %8.3f %7.1f%% %7.1f%%",
+               percentile(results.latency_ms, results.count, 0.5),
+               percentile(results.latency_ms, results.count, 0.99),
+               100.0 * reused_sum / (double)results.count,
+               100.0 * reused_min);
+    }
+    printf("\n");
+
+    free(results.latency_ms);
+    free(results.reused);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-n EDITS] [-s SEED] [-g PACKAGES] [FILE...]\n"
+            "\n"
+            "  -n EDITS     Keystrokes per document (default: 200)\n"
+            "  -s SEED      Seed for the edit positions (default: 1)\n"
+            "  -g PACKAGES  Also benchmark a synthetic spec with PACKAGES\n"
+            "               conditional subpackages\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned edits = 200;
+    unsigned packages = 0;
+    TSParser *parser;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:g:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            edits = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            rng_state = strtoull(optarg, NULL, 10) | 1;
+            break;
+        case 'g':
+            packages = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc && packages == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    parser = ts_parser_new();
+    if (!ts_parser_set_language(parser, tree_sitter_rpmspec())) {
+        fprintf(stderr, "Incompatible tree-sitter library\n");
+        return 1;
+    }
+
+    printf("%-28s %10s %8s %9s %8s %8s %8s %8s\n",
+           "document",
+           "bytes",
+           "nodes",
+           "full ms",
+           "p50 ms",
+           "p99 ms",
+           "reused",
+           "min");
+
+    for (int i = optind; i < argc; i++) {
+        struct Buffer buf = {0};
+        const char *name = strrchr(argv[i], '/');
+
+        if (buffer_load(&buf, argv[i]) != 0) {
+            ts_parser_delete(parser);
+            return 1;
+        }
+        bench_document(parser, name != NULL ? name + 1 : argv[i], &buf, edits);
+        free(buf.data);
+    }
+
+    if (packages > 0) {
+        struct Buffer buf = {0};
+        char name[64];
+
+        generate_spec(&buf, packages);
+        snprintf(name, sizeof(name), "synthetic-%u", packages);
+        bench_document(parser, name, &buf, edits);
+        free(buf.data);
+    }
+
+    ts_parser_delete(parser);
+    return 0;
+}
@@ -0,0 +1,960 @@
+/**
+ * @file parse.c
+ * @brief Parse throughput benchmark for the rpmspec and rpmbash grammars
+ *
+ * Parses a corpus of files and reports per grammar:
+ * - throughput in MB/s and ns/byte
+ * - p50/p99 latency of a single file parse
+ * - number of nodes in the resulting trees
+ * - peak heap memory allocated by tree-sitter for a single file
+ * - number of allocations of all files, and the time to free the trees
+ *
+ * Files ending in .sh are parsed with rpmbash, all others with rpmspec,
+ * unless the grammar is forced with -l. Where the tree-sitter CLI is
+ * found, -l rpmspec-coarse selects the variant of rpmspec/coarse, whose
+ * script lines only have macros as children. Directories are walked
+ * recursively. With -j the results are also written as JSON, so runs can
+ * be compared for regression tracking.
+ *
+ * With -t the nodes are also counted by type, and the most frequent types
+ * of each grammar are listed with their share of all nodes.
+ *
+ * With -a the allocator of tree-sitter is chosen:
+ * - malloc: the libc allocator (default)
+ * - classes: jemalloc-like size classes with free lists, see below
+ * - arena: tree_sitter/rpmspec/arena.h, with a parser per run and a reset
+ *   instead of ts_tree_delete()
+ *
+ * Usage:
+ *   bench-parse [-r RUNS] [-l GRAMMAR] [-a ALLOCATOR] [-t TOP] [-j FILE]
+ *               PATH...
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/arena.h>
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+const TSLanguage *tree_sitter_rpmbash(void);
+#ifdef BENCH_RPMSPEC_COARSE
+const TSLanguage *tree_sitter_rpmspec_coarse(void);
+#endif
+
+/** @brief A file of the corpus, loaded into memory */
+struct File {
+    char *path;
+    char *data;
+    size_t len;
+};
+
+/** @brief A grammar and the files parsed with it */
+struct Grammar {
+    const char *name;
+    const TSLanguage *(*language)(void);
+    struct File *files;
+    size_t count;
+    size_t cap;
+};
+
+/** @brief Results of one grammar */
+struct Results {
+    size_t files;
+    uint64_t bytes;    /**< Bytes of all files, counted once */
+    uint64_t nodes;    /**< Nodes of all trees, counted once */
+    uint64_t errors;   /**< Files whose tree contains errors */
+    double total_ms;   /**< Time of all parses of all files */
+    double p50_ms;     /**< Median single file latency */
+    double p99_ms;     /**< 99th percentile single file latency */
+    double max_ms;     /**< Slowest single file */
+    size_t peak_heap;  /**< Largest heap use of a single parse */
+    uint64_t allocs;   /**< Allocations of all parses, counted once */
+    double release_ms; /**< Time of freeing all trees of all runs */
+    const char *slowest;
+    uint64_t *types; /**< Nodes per symbol, NULL unless counted */
+};
+
+/** @brief The allocators tree-sitter can be benchmarked with */
+enum Allocator {
+    ALLOCATOR_MALLOC,
+    ALLOCATOR_CLASSES,
+    ALLOCATOR_ARENA,
+};
+
+static const char *const allocator_names[] = {
+    [ALLOCATOR_MALLOC] = "malloc",
+    [ALLOCATOR_CLASSES] = "classes",
+    [ALLOCATOR_ARENA] = "arena",
+};
+
+/* ========================================================================== */
+/* HEAP ACCOUNTING                                                            */
+/* ========================================================================== */
+
+/*
+ * tree-sitter allocates through ts_set_allocator(). Every block carries its
+ * size in a header, so the benchmark can track the heap in use.
+ */
+#define HEAP_HEADER 16
+
+static size_t heap_current;
+static size_t heap_peak;
+/** Calls of malloc, calloc and realloc */
+static uint64_t heap_allocs;
+
+static void heap_account(size_t add, size_t sub)
+{
+    heap_current = heap_current + add - sub;
+    if (heap_current > heap_peak) {
+        heap_peak = heap_current;
+    }
+}
+
+static void *heap_malloc(size_t size)
+{
+    char *ptr = malloc(size + HEAP_HEADER);
+
+    heap_allocs++;
+    if (ptr == NULL) {
+        return NULL;
+    }
+    memcpy(ptr, &size, sizeof(size));
+    heap_account(size, 0);
+    return ptr + HEAP_HEADER;
+}
+
+static void *heap_calloc(size_t count, size_t size)
+{
+    void *ptr;
+
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    ptr = heap_malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+static void heap_free(void *ptr)
+{
+    size_t size;
+
+    if (ptr == NULL) {
+        return;
+    }
+    ptr = (char *)ptr - HEAP_HEADER;
+    memcpy(&size, ptr, sizeof(size));
+    heap_account(0, size);
+    free(ptr);
+}
+
+static void *heap_realloc(void *ptr, size_t size)
+{
+    size_t old = 0;
+    char *block;
+
+    if (ptr == NULL) {
+        return heap_malloc(size);
+    }
+    heap_allocs++;
+    block = (char *)ptr - HEAP_HEADER;
+    memcpy(&old, block, sizeof(old));
+    block = realloc(block, size + HEAP_HEADER);
+    if (block == NULL) {
+        return NULL;
+    }
+    memcpy(block, &size, sizeof(size));
+    heap_account(size, old);
+    return block + HEAP_HEADER;
+}
+
+/* ========================================================================== */
+/* SIZE CLASSES                                                               */
+/* ========================================================================== */
+
+/*
+ * A jemalloc-like allocator to compare with: requests are rounded up to a
+ * size class, in steps of 16 bytes up to 128 and four classes per doubling
+ * above, and carved from large slabs. Freed blocks go to a free list per
+ * class and are reused. Blocks above the largest class go to malloc. The
+ * header holds the class and the requested size, and the heap is accounted
+ * in class sizes.
+ */
+#define CLASS_SMALL 8
+#define CLASS_COUNT (CLASS_SMALL + 4 * 8)
+#define CLASS_MAX 32768
+#define CLASS_LARGE SIZE_MAX
+#define SLAB_SIZE (256 * 1024)
+
+struct ClassHeader {
+    size_t index;
+    size_t size;
+};
+
+static void *class_free_list[CLASS_COUNT];
+/** Slabs are chained through their first word */
+static void *class_slabs;
+static char *class_slab;
+static size_t class_slab_left;
+
+static size_t class_index(size_t size, size_t *class_size)
+{
+    size_t base = 128;
+    size_t group = 0;
+    size_t step;
+    size_t k;
+
+    if (size <= 128) {
+        size_t index = size > 0 ? (size - 1) / 16 : 0;
+
+        *class_size = (index + 1) * 16;
+        return index;
+    }
+    while (size > base * 2) {
+        base *= 2;
+        group++;
+    }
+    step = base / 4;
+    k = (size - base + step - 1) / step;
+    *class_size = base + k * step;
+    return CLASS_SMALL + group * 4 + k - 1;
+}
+
+static void *class_carve(size_t size)
+{
+    char *ptr;
+
+    if (class_slab_left < size) {
+        char *slab = malloc(SLAB_SIZE);
+
+        if (slab == NULL) {
+            return NULL;
+        }
+        memcpy(slab, &class_slabs, sizeof(class_slabs));
+        class_slabs = slab;
+        class_slab = slab + HEAP_HEADER;
+        class_slab_left = SLAB_SIZE - HEAP_HEADER;
+    }
+    ptr = class_slab;
+    class_slab += size;
+    class_slab_left -= size;
+    return ptr;
+}
+
+static void *class_malloc(size_t size)
+{
+    struct ClassHeader header = {CLASS_LARGE, size};
+    size_t class_size = size;
+    char *ptr;
+
+    heap_allocs++;
+    if (size > CLASS_MAX) {
+        ptr = malloc(size + HEAP_HEADER);
+    } else {
+        header.index = class_index(size, &class_size);
+        ptr = class_free_list[header.index];
+        if (ptr != NULL) {
+            memcpy(&class_free_list[header.index], ptr, sizeof(void *));
+        } else {
+            ptr = class_carve(class_size + HEAP_HEADER);
+        }
+    }
+    if (ptr == NULL) {
+        return NULL;
+    }
+    memcpy(ptr, &header, sizeof(header));
+    heap_account(class_size, 0);
+    return ptr + HEAP_HEADER;
+}
+
+static void *class_calloc(size_t count, size_t size)
+{
+    void *ptr;
+
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    ptr = class_malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+static void class_free(void *ptr)
+{
+    struct ClassHeader header;
+    size_t class_size;
+
+    if (ptr == NULL) {
+        return;
+    }
+    ptr = (char *)ptr - HEAP_HEADER;
+    memcpy(&header, ptr, sizeof(header));
+    if (header.index == CLASS_LARGE) {
+        heap_account(0, header.size);
+        free(ptr);
+        return;
+    }
+    class_index(header.size, &class_size);
+    heap_account(0, class_size);
+    memcpy(ptr, &class_free_list[header.index], sizeof(void *));
+    class_free_list[header.index] = ptr;
+}
+
+static void *class_realloc(void *ptr, size_t size)
+{
+    struct ClassHeader header;
+    size_t class_size;
+    void *moved;
+
+    if (ptr == NULL) {
+        return class_malloc(size);
+    }
+    memcpy(&header, (char *)ptr - HEAP_HEADER, sizeof(header));
+    if (header.index != CLASS_LARGE && size <= CLASS_MAX &&
+        class_index(size, &class_size) == header.index) {
+        /* Still the same class */
+        heap_allocs++;
+        header.size = size;
+        memcpy((char *)ptr - HEAP_HEADER, &header, sizeof(header));
+        return ptr;
+    }
+    moved = class_malloc(size);
+    if (moved != NULL) {
+        memcpy(moved, ptr, header.size < size ? header.size : size);
+        class_free(ptr);
+    }
+    return moved;
+}
+
+static void class_release(void)
+{
+    while (class_slabs != NULL) {
+        void *next;
+
+        memcpy(&next, class_slabs, sizeof(next));
+        free(class_slabs);
+        class_slabs = next;
+    }
+}
+
+/* ========================================================================== */
+/* CORPUS                                                                     */
+/* ========================================================================== */
+
+static int load_file(struct Grammar *grammar, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    struct File *file;
+    char *data = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    size_t n;
+
+    if (fp == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    do {
+        if (len + 65536 > cap) {
+            cap = (len + 65536) * 2;
+            data = realloc(data, cap);
+            if (data == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+        }
+        n = fread(data + len, 1, cap - len, fp);
+        len += n;
+    } while (n > 0);
+    fclose(fp);
+
+    if (grammar->count == grammar->cap) {
+        grammar->cap = grammar->cap ? grammar->cap * 2 : 64;
+        grammar->files =
+            realloc(grammar->files, grammar->cap * sizeof(*grammar->files));
+        if (grammar->files == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    file = &grammar->files[grammar->count++];
+    file->path = strdup(path);
+    file->data = data;
+    file->len = len;
+
+    return 0;
+}
+
+static int has_suffix(const char *str, const char *suffix)
+{
+    size_t len = strlen(str);
+    size_t n = strlen(suffix);
+
+    return len >= n && strcmp(str + len - n, suffix) == 0;
+}
+
+/**
+ * @brief Add a file, or all files below a directory, to the corpus
+ *
+ * @param grammars rpmspec and rpmbash, in this order
+ * @param forced The grammar selected with -l, NULL to pick by extension
+ * @param path File or directory to add
+ */
+static int load_path(struct Grammar *grammars,
+                     struct Grammar *forced,
+                     const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        int rc = 0;
+
+        if (dir == NULL) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        while (rc == 0 && (entry = readdir(dir)) != NULL) {
+            char child[4096];
+
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            rc = load_path(grammars, forced, child);
+        }
+        closedir(dir);
+        return rc;
+    }
+
+    if (forced != NULL) {
+        return load_file(forced, path);
+    }
+    return load_file(has_suffix(path, ".sh") ? &grammars[1] : &grammars[0],
+                     path);
+}
+
+/* ========================================================================== */
+/* BENCHMARK                                                                  */
+/* ========================================================================== */
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, size_t count, double p)
+{
+    return sorted[(size_t)(p * (double)(count - 1) + 0.5)];
+}
+
+static TSParser *new_parser(const struct Grammar *grammar)
+{
+    TSParser *parser = ts_parser_new();
+
+    if (!ts_parser_set_language(parser, grammar->language())) {
+        fprintf(stderr,
+                "%s: incompatible tree-sitter library\n",
+                grammar->name);
+        exit(1);
+    }
+    return parser;
+}
+
+/** @brief Count the nodes of a tree by symbol */
+static void count_types(TSTree *tree, uint64_t *types)
+{
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+
+    for (;;) {
+        types[ts_node_symbol(ts_tree_cursor_current_node(&cursor))]++;
+        if (ts_tree_cursor_goto_first_child(&cursor)) {
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Parse every file of a grammar @p runs times
+ *
+ * The latency of a file is the median of its runs, which filters out
+ * scheduler noise without hiding a consistently slow file.
+ *
+ * With an arena every run gets a new parser, as a parser can't outlive
+ * the arena it allocated from. Creating and deleting it isn't timed.
+ */
+static void bench_grammar(const struct Grammar *grammar,
+                          RpmspecArena *arena,
+                          unsigned runs,
+                          int count_nodes,
+                          struct Results *res)
+{
+    TSParser *parser = arena == NULL ? new_parser(grammar) : NULL;
+    double *latency = calloc(grammar->count, sizeof(double));
+    double *samples = calloc(runs, sizeof(double));
+
+    if (latency == NULL || samples == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    memset(res, 0, sizeof(*res));
+    res->files = grammar->count;
+    if (count_nodes) {
+        res->types = calloc(ts_language_symbol_count(grammar->language()),
+                            sizeof(*res->types));
+        if (res->types == NULL) {
+            perror("calloc");
+            exit(1);
+        }
+    }
+
+    for (size_t i = 0; i < grammar->count; i++) {
+        const struct File *file = &grammar->files[i];
+
+        for (unsigned r = 0; r < runs; r++) {
+            size_t heap_base = heap_current;
+            uint64_t allocs_base = heap_allocs;
+            size_t peak;
+            uint64_t allocs;
+            double start;
+            TSTree *tree;
+
+            if (arena != NULL) {
+                rpmspec_arena_begin(arena);
+                parser = new_parser(grammar);
+            }
+            heap_peak = heap_current;
+            start = now_ms();
+            tree = ts_parser_parse_string(
+                parser, NULL, file->data, (uint32_t)file->len);
+            samples[r] = now_ms() - start;
+            res->total_ms += samples[r];
+
+            if (arena != NULL) {
+                RpmspecArenaStats stats;
+
+                /* Nothing is freed in an arena, so the end is the peak */
+                rpmspec_arena_stats(arena, &stats);
+                peak = stats.used;
+                allocs = stats.allocations;
+            } else {
+                peak = heap_peak - heap_base;
+                allocs = heap_allocs - allocs_base;
+            }
+            if (peak > res->peak_heap) {
+                res->peak_heap = peak;
+            }
+            if (r == 0) {
+                TSNode root = ts_tree_root_node(tree);
+
+                res->bytes += file->len;
+                res->nodes += ts_node_descendant_count(root);
+                res->allocs += allocs;
+                if (ts_node_has_error(root)) {
+                    res->errors++;
+                }
+                if (res->types != NULL) {
+                    count_types(tree, res->types);
+                }
+            }
+
+            if (arena != NULL) {
+                ts_parser_delete(parser);
+                rpmspec_arena_end(arena);
+                start = now_ms();
+                rpmspec_arena_reset(arena);
+            } else {
+                start = now_ms();
+                ts_tree_delete(tree);
+            }
+            res->release_ms += now_ms() - start;
+        }
+
+        qsort(samples, runs, sizeof(*samples), compare_double);
+        latency[i] = samples[runs / 2];
+        if (latency[i] > res->max_ms) {
+            res->max_ms = latency[i];
+            res->slowest = file->path;
+        }
+    }
+
+    if (grammar->count > 0) {
+        qsort(latency, grammar->count, sizeof(*latency), compare_double);
+        res->p50_ms = percentile(latency, grammar->count, 0.5);
+        res->p99_ms = percentile(latency, grammar->count, 0.99);
+    }
+
+    free(samples);
+    free(latency);
+    if (parser != NULL && arena == NULL) {
+        ts_parser_delete(parser);
+    }
+}
+
+static double mb_per_s(const struct Results *res, unsigned runs)
+{
+    if (res->total_ms <= 0.0) {
+        return 0.0;
+    }
+    return (double)res->bytes * runs / 1e6 / (res->total_ms / 1e3);
+}
+
+static double ns_per_byte(const struct Results *res, unsigned runs)
+{
+    if (res->bytes == 0) {
+        return 0.0;
+    }
+    return res->total_ms * 1e6 / ((double)res->bytes * runs);
+}
+
+static void print_results(FILE *fp,
+                          const struct Grammar *grammar,
+                          const struct Results *res,
+                          unsigned runs)
+{
+    fprintf(fp,
+            "%-14s %6zu %10llu %9.2f %8.1f %8.3f %8.3f %10llu %9.1f %10llu "
+            "%6llu\n",
+            grammar->name,
+            res->files,
+            (unsigned long long)res->bytes,
+            mb_per_s(res, runs),
+            ns_per_byte(res, runs),
+            res->p50_ms,
+            res->p99_ms,
+            (unsigned long long)res->nodes,
+            (double)res->peak_heap / 1024.0,
+            (unsigned long long)res->allocs,
+            (unsigned long long)res->errors);
+}
+
+/** @brief List the @p top most frequent node types of a grammar */
+static void print_types(FILE *fp,
+                        const struct Grammar *grammar,
+                        const struct Results *res,
+                        size_t top)
+{
+    const TSLanguage *language = grammar->language();
+    uint32_t count = ts_language_symbol_count(language);
+    char *listed = calloc(count, 1);
+
+    if (listed == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    fprintf(fp,
+            "\n%-8s %-32s %10s %7s\n",
+            grammar->name,
+            "type",
+            "nodes",
+            "share");
+    for (size_t n = 0; n < top; n++) {
+        uint32_t best = count;
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!listed[i] && res->types[i] > 0 &&
+                (best == count || res->types[i] > res->types[best])) {
+                best = i;
+            }
+        }
+        if (best == count) {
+            break;
+        }
+        listed[best] = 1;
+        fprintf(fp,
+                "%-14s %-32s %10llu %6.1f%%\n",
+                "",
+                ts_language_symbol_name(language, (TSSymbol)best),
+                (unsigned long long)res->types[best],
+                100.0 * (double)res->types[best] / (double)res->nodes);
+    }
+
+    free(listed);
+}
+
+/** @brief Write a string as a JSON string literal */
+static void json_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (; str != NULL && *str != '\0'; str++) {
+        unsigned char c = (unsigned char)*str;
+
+        if (c == '"' || c == '\\') {
+            fprintf(fp, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static void write_json(FILE *fp,
+                       const struct Grammar *grammars,
+                       const struct Results *results,
+                       size_t count,
+                       unsigned runs,
+                       enum Allocator allocator)
+{
+    struct rusage usage;
+    int first = 1;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(fp, "{\n  \"runs\": %u,\n", runs);
+    fprintf(fp, "  \"allocator\": \"%s\",\n", allocator_names[allocator]);
+    fprintf(fp, "  \"max_rss_kb\": %ld,\n", usage.ru_maxrss);
+    fprintf(fp, "  \"grammars\": {");
+    for (size_t i = 0; i < count; i++) {
+        const struct Results *res = &results[i];
+
+        if (res->files == 0) {
+            continue;
+        }
+        fprintf(fp, "%s\n    ", first ? "" : ",");
+        json_string(fp, grammars[i].name);
+        fprintf(fp,
+                ": {\n"
+                "      \"files\": %zu,\n"
+                "      \"bytes\": %llu,\n"
+                "      \"nodes\": %llu,\n"
+                "      \"errors\": %llu,\n"
+                "      \"total_ms\": %.3f,\n"
+                "      \"mb_per_s\": %.3f,\n"
+                "      \"ns_per_byte\": %.3f,\n"
+                "      \"p50_ms\": %.4f,\n"
+                "      \"p99_ms\": %.4f,\n"
+                "      \"max_ms\": %.4f,\n"
+                "      \"peak_heap_bytes\": %zu,\n"
+                "      \"allocations\": %llu,\n"
+                "      \"release_ms\": %.3f,\n"
+                "      \"slowest\": ",
+                res->files,
+                (unsigned long long)res->bytes,
+                (unsigned long long)res->nodes,
+                (unsigned long long)res->errors,
+                res->total_ms,
+                mb_per_s(res, runs),
+                ns_per_byte(res, runs),
+                res->p50_ms,
+                res->p99_ms,
+                res->max_ms,
+                res->peak_heap,
+                (unsigned long long)res->allocs,
+                res->release_ms);
+        json_string(fp, res->slowest);
+        fprintf(fp, "\n    }");
+        first = 0;
+    }
+    fprintf(fp, "\n  }\n}\n");
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-r RUNS] [-l GRAMMAR] [-a ALLOCATOR] [-t TOP] "
+            "[-j FILE] PATH...\n"
+            "\n"
+            "  -r RUNS       Parse every file RUNS times (default: 5)\n"
+            "  -l GRAMMAR    Parse all files with rpmspec, rpmbash or\n"
+            "                rpmspec-coarse, if built\n"
+            "                (default: .sh files with rpmbash, others "
+            "rpmspec)\n"
+            "  -a ALLOCATOR  Allocate with malloc, classes or arena\n"
+            "                (default: malloc)\n"
+            "  -t TOP        List the TOP most frequent node types\n"
+            "  -j FILE       Write the results as JSON to FILE, - for stdout\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct Grammar grammars[] = {
+        {.name = "rpmspec", .language = tree_sitter_rpmspec},
+        {.name = "rpmbash", .language = tree_sitter_rpmbash},
+#ifdef BENCH_RPMSPEC_COARSE
+        {.name = "rpmspec-coarse", .language = tree_sitter_rpmspec_coarse},
+#endif
+    };
+    const size_t num_grammars = sizeof(grammars) / sizeof(grammars[0]);
+    struct Results results[sizeof(grammars) / sizeof(grammars[0])];
+    struct Grammar *forced = NULL;
+    enum Allocator allocator = ALLOCATOR_MALLOC;
+    RpmspecArena *arena = NULL;
+    const char *json = NULL;
+    FILE *table = stdout;
+    unsigned runs = 5;
+    size_t top_types = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:l:a:t:j:h")) != -1) {
+        switch (opt) {
+        case 'r':
+            runs = (unsigned)strtoul(optarg, NULL, 10);
+            if (runs == 0) {
+                runs = 1;
+            }
+            break;
+        case 'l':
+            for (size_t i = 0; i < num_grammars; i++) {
+                if (strcmp(optarg, grammars[i].name) == 0) {
+                    forced = &grammars[i];
+                }
+            }
+            if (forced == NULL) {
+                fprintf(stderr, "Unknown grammar: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            for (size_t i = 0; i < sizeof(allocator_names) /
+                                       sizeof(allocator_names[0]);
+                 i++) {
+                if (strcmp(optarg, allocator_names[i]) == 0) {
+                    allocator = (enum Allocator)i;
+                    break;
+                }
+            }
+            if (strcmp(optarg, allocator_names[allocator]) != 0) {
+                fprintf(stderr, "Unknown allocator: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            top_types = (size_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            json = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (load_path(grammars, forced, argv[i]) != 0) {
+            return 1;
+        }
+    }
+
+    switch (allocator) {
+    case ALLOCATOR_MALLOC:
+        ts_set_allocator(heap_malloc, heap_calloc, heap_realloc, heap_free);
+        break;
+    case ALLOCATOR_CLASSES:
+        ts_set_allocator(
+            class_malloc, class_calloc, class_realloc, class_free);
+        break;
+    case ALLOCATOR_ARENA:
+        rpmspec_arena_install();
+        arena = rpmspec_arena_new(0);
+        if (arena == NULL) {
+            perror("rpmspec_arena_new");
+            return 1;
+        }
+        break;
+    }
+
+    /* Keep stdout clean for JSON */
+    if (json != NULL && strcmp(json, "-") == 0) {
+        table = stderr;
+    }
+
+    fprintf(table,
+            "%-14s %6s %10s %9s %8s %8s %8s %10s %9s %10s %6s\n",
+            "grammar",
+            "files",
+            "bytes",
+            "MB/s",
+            "ns/byte",
+            "p50 ms",
+            "p99 ms",
+            "nodes",
+            "peak KiB",
+            "allocs",
+            "errors");
+    for (size_t i = 0; i < num_grammars; i++) {
+        bench_grammar(
+            &grammars[i], arena, runs, top_types > 0, &results[i]);
+        if (results[i].files > 0) {
+            print_results(table, &grammars[i], &results[i], runs);
+        }
+    }
+    for (size_t i = 0; i < num_grammars && top_types > 0; i++) {
+        if (results[i].files > 0) {
+            print_types(table, &grammars[i], &results[i], top_types);
+        }
+    }
+
+    if (json != NULL) {
+        FILE *fp = strcmp(json, "-") == 0 ? stdout : fopen(json, "w");
+
+        if (fp == NULL) {
+            fprintf(stderr, "%s: %s\n", json, strerror(errno));
+            return 1;
+        }
+        write_json(fp, grammars, results, num_grammars, runs, allocator);
+        if (fp != stdout) {
+            fclose(fp);
+        }
+    }
+
+    for (size_t i = 0; i < num_grammars; i++) {
+        for (size_t j = 0; j < grammars[i].count; j++) {
+            free(grammars[i].files[j].path);
+            free(grammars[i].files[j].data);
+        }
+        free(grammars[i].files);
+        free(results[i].types);
+    }
+    rpmspec_arena_delete(arena);
+    class_release();
+
+    return 0;
+}
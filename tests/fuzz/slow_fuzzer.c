@@ -0,0 +1,177 @@
+/**
+ * @file slow_fuzzer.c
+ * @brief libFuzzer driver hunting for superlinear parse time
+ *
+ * fuzzer.c only checks memory safety and skips inputs above 4096 bytes, so a
+ * quadratic path (e.g. repeated conditional lookahead) never shows up there.
+ * This driver measures the parse time of every input relative to its size:
+ *
+ * - The time per byte is reported to libFuzzer as an extra counter, one
+ *   counter per power of two of ns/byte. An input reaching a slower bucket
+ *   counts as new coverage, so libFuzzer keeps it and mutates it further.
+ * - An input above the threshold is parsed again to rule out noise. If it
+ *   is still slow, the driver aborts, so libFuzzer saves it as a crash
+ *   artifact which can be minimized and triaged like any other crash.
+ *
+ * Environment:
+ *   SLOW_FUZZ_NS_PER_BYTE  Threshold in ns/byte (default: 20000)
+ *   SLOW_FUZZ_MIN_MS       Ignore parses faster than this (default: 5)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <tree_sitter/api.h>
+
+#ifndef TS_LANG
+#error TS_LANG must be defined
+#endif
+
+const TSLanguage *TS_LANG(void);
+
+/** @brief Default threshold, far above any linear parse even with ASan */
+#define SLOW_DEFAULT_NS_PER_BYTE 20000.0
+
+/** @brief Parses faster than this are dominated by noise */
+#define SLOW_DEFAULT_MIN_MS 5.0
+
+/** @brief Inputs smaller than this are dominated by the fixed parse cost */
+#define SLOW_MIN_LEN 32
+
+/** @brief Larger inputs are skipped, raise -max_len up to this */
+#define SLOW_MAX_LEN (1024 * 1024)
+
+/** @brief Parses of a slow input to confirm it, the fastest one counts */
+#define SLOW_CONFIRM_RUNS 3
+
+/** @brief Number of ns/byte buckets reported to libFuzzer */
+#define SLOW_BUCKETS 32
+
+/*
+ * libFuzzer treats every non-zero byte in this section as a coverage
+ * feature and clears the section before each input.
+ */
+#if defined(__linux__)
+__attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t slow_buckets[SLOW_BUCKETS];
+
+static TSParser *parser;
+static double threshold_ns_per_byte = SLOW_DEFAULT_NS_PER_BYTE;
+static double min_ms = SLOW_DEFAULT_MIN_MS;
+
+static double getenv_double(const char *name, double fallback)
+{
+    const char *value = getenv(name);
+    char *end = NULL;
+    double d;
+
+    if (value == NULL || value[0] == '\0') {
+        return fallback;
+    }
+    d = strtod(value, &end);
+    if (*end != '\0' || d <= 0) {
+        fprintf(stderr, "Ignoring invalid %s=%s\n", name, value);
+        return fallback;
+    }
+    return d;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/** @brief Parse the input once and return the time in milliseconds */
+static double parse_ms(const uint8_t *data, size_t len)
+{
+    double start = now_ms();
+    TSTree *tree = ts_parser_parse_string(
+        parser, NULL, (const char *)data, (uint32_t)len);
+    double ms = now_ms() - start;
+
+    ts_tree_delete(tree);
+    return ms;
+}
+
+/** @brief Map a time per byte to a bucket, one bucket per power of two */
+static size_t ns_per_byte_bucket(double ns_per_byte)
+{
+    size_t bucket = 0;
+
+    while (ns_per_byte >= 2.0 && bucket < SLOW_BUCKETS - 1) {
+        ns_per_byte /= 2.0;
+        bucket++;
+    }
+    return bucket;
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
+
+    threshold_ns_per_byte =
+        getenv_double("SLOW_FUZZ_NS_PER_BYTE", SLOW_DEFAULT_NS_PER_BYTE);
+    min_ms = getenv_double("SLOW_FUZZ_MIN_MS", SLOW_DEFAULT_MIN_MS);
+
+    /* One parser for all inputs, so its setup isn't part of the timing */
+    parser = ts_parser_new();
+    if (parser == NULL || !ts_parser_set_language(parser, TS_LANG())) {
+        fprintf(stderr, "Failed to create the parser\n");
+        abort();
+    }
+
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, const size_t len)
+{
+    double ms;
+    double ns_per_byte;
+
+    if (len > SLOW_MAX_LEN) {
+        return 0;
+    }
+    if (len < SLOW_MIN_LEN) {
+        (void)parse_ms(data, len);
+        return 0;
+    }
+
+    ms = parse_ms(data, len);
+    ns_per_byte = ms * 1e6 / (double)len;
+    slow_buckets[ns_per_byte_bucket(ns_per_byte)] = 1;
+
+    if (ms < min_ms || ns_per_byte < threshold_ns_per_byte) {
+        return 0;
+    }
+
+    /* Confirm with the fastest of several parses, scheduling noise is common */
+    for (int i = 0; i < SLOW_CONFIRM_RUNS; i++) {
+        double again = parse_ms(data, len);
+
+        if (again < ms) {
+            ms = again;
+        }
+    }
+    ns_per_byte = ms * 1e6 / (double)len;
+    if (ms < min_ms || ns_per_byte < threshold_ns_per_byte) {
+        return 0;
+    }
+
+    fprintf(stderr,
+            "==SLOW== %zu bytes parsed in %.2f ms (%.0f ns/byte, "
+            "threshold %.0f ns/byte)\n",
+            len,
+            ms,
+            ns_per_byte,
+            threshold_ns_per_byte);
+    abort();
+}
@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/treefile.h>
+
+#ifndef TS_LANG
+#error TS_LANG must be defined
+#endif
+
+const TSLanguage *TS_LANG(void);
+
+// Serialized trees start with this magic, other input is parsed first
+#define TREE_MAGIC "RPMTREE"
+
+// Corrupted copies checked per round trip
+#define BIT_FLIPS 64
+
+/**
+ * @brief Walk a view in pre-order with the public accessors
+ *
+ * rpmspec_tree_view_init() promises that navigation stays in bounds for
+ * any input it accepts, so AddressSanitizer catches every broken check.
+ *
+ * @return The number of nodes visited
+ */
+static uint32_t walk_view(const RpmspecTreeView *view)
+{
+    uint32_t visited = 0;
+    uint32_t node = 0;
+
+    for (;;) {
+        (void)strlen(rpmspec_tree_symbol_name(view, node));
+        const char *field = rpmspec_tree_field_name(view, node);
+        if (field != NULL) {
+            (void)strlen(field);
+        }
+        visited++;
+
+        // Descend, else move to the next sibling of the node or an ancestor
+        uint32_t next = rpmspec_tree_first_child(view, node);
+        while (next == RPMSPEC_TREE_NONE) {
+            if (node == 0) {
+                return visited;
+            }
+            next = rpmspec_tree_next_sibling(view, node);
+            if (next == RPMSPEC_TREE_NONE) {
+                node = view->parent[node];
+            }
+        }
+        node = next;
+    }
+}
+
+/** @brief Check arbitrary bytes, copied to get the required alignment */
+static void check_bytes(const uint8_t *data, size_t len)
+{
+    void *copy = malloc(len > 0 ? len : 1);
+    RpmspecTreeView view;
+
+    assert(copy != NULL);
+    memcpy(copy, data, len);
+    if (rpmspec_tree_view_init(&view, copy, len) == 0) {
+        assert(walk_view(&view) <= view.node_count);
+    }
+    free(copy);
+}
+
+/**
+ * @brief Parse a spec, serialize the tree and read it back
+ *
+ * The view of an intact tree must be accepted and walk every node. Copies
+ * with a flipped bit, picked by a hash of the input, must never be read
+ * out of bounds.
+ */
+static void check_round_trip(const uint8_t *data, size_t len)
+{
+    TSParser *parser = ts_parser_new();
+    assert(parser != NULL);
+    assert(ts_parser_set_language(parser, TS_LANG()));
+
+    TSTree *tree =
+        ts_parser_parse_string(parser, NULL, (const char *)data, len);
+    void *bytes = NULL;
+    size_t size = 0;
+    RpmspecTreeView view;
+
+    if (tree != NULL && rpmspec_tree_serialize(tree, &bytes, &size) == 0) {
+        assert(rpmspec_tree_view_init(&view, bytes, size) == 0);
+        assert(view.node_count ==
+               ts_node_descendant_count(ts_tree_root_node(tree)));
+        assert(walk_view(&view) == view.node_count);
+
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        for (int i = 0; i < BIT_FLIPS; i++) {
+            size_t bit;
+
+            hash = hash * 1103515245u + 12345u;
+            bit = hash % (size * 8);
+            ((uint8_t *)bytes)[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            if (rpmspec_tree_view_init(&view, bytes, size) == 0) {
+                assert(walk_view(&view) <= view.node_count);
+            }
+            ((uint8_t *)bytes)[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        }
+    }
+
+    free(bytes);
+    ts_tree_delete(tree);
+    ts_parser_delete(parser);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, const size_t len)
+{
+    // Same limit as the parser fuzzers, larger inputs only slow them down
+    if (len > 4096) {
+        return 0;
+    }
+
+    if (len >= sizeof(TREE_MAGIC) &&
+        memcmp(data, TREE_MAGIC, sizeof(TREE_MAGIC)) == 0) {
+        check_bytes(data, len);
+    } else {
+        check_round_trip(data, len);
+    }
+    return 0;
+}
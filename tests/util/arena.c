@@ -0,0 +1,201 @@
+/**
+ * @file arena.c
+ * @brief Checks of the arena allocator, meant to run under AddressSanitizer
+ *
+ * The test is linked with util/src/arena.c instead of the library and
+ * defines ts_set_allocator() itself, so it gets hold of the hooks which
+ * rpmspec_arena_install() hands to tree-sitter and calls them the way the
+ * runtime does. Blocks are allocated inside and outside of arenas, moved
+ * across the boundary with realloc, and released by a reset; a block freed
+ * through the wrong path shows up as an ASan report or a leak.
+ *
+ * Freeing a block allocated before the install, and installing after the
+ * first allocation, must abort; both are checked in a child process.
+ *
+ * Usage:
+ *   test-arena
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/arena.h>
+
+static void *(*ts_malloc)(size_t);
+static void *(*ts_calloc)(size_t, size_t);
+static void *(*ts_realloc)(void *, size_t);
+static void (*ts_free)(void *);
+
+static int failed;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            failed = 1;                                                     \
+        }                                                                   \
+    } while (0)
+
+/* Stands in for the runtime, which keeps the hooks for all allocations */
+void ts_set_allocator(void *(*new_malloc)(size_t),
+                      void *(*new_calloc)(size_t, size_t),
+                      void *(*new_realloc)(void *, size_t),
+                      void (*new_free)(void *))
+{
+    ts_malloc = new_malloc;
+    ts_calloc = new_calloc;
+    ts_realloc = new_realloc;
+    ts_free = new_free;
+}
+
+/** @brief Whether all bytes of a block have the value @p c */
+static int filled(const void *ptr, int c, size_t len)
+{
+    const unsigned char *p = ptr;
+
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] != (unsigned char)c) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Check that @p fn aborts with a message containing @p expected
+ *
+ * The message tells the checks of the arena apart from those of malloc,
+ * which abort on a bad pointer, too.
+ */
+static void expect_abort(void (*fn)(void), const char *expected)
+{
+    char msg[256] = "";
+    size_t len = 0;
+    int fds[2];
+    pid_t pid;
+    ssize_t n;
+    int status;
+
+    CHECK(pipe(fds) == 0);
+    pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDERR_FILENO);
+        fn();
+        _exit(0);
+    }
+    close(fds[1]);
+    while (len < sizeof(msg) - 1 &&
+           (n = read(fds[0], msg + len, sizeof(msg) - 1 - len)) > 0) {
+        len += (size_t)n;
+    }
+    close(fds[0]);
+
+    CHECK(pid > 0);
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+    if (strstr(msg, expected) == NULL) {
+        fprintf(stderr, "expected \"%s\", got \"%s\"\n", expected, msg);
+        failed = 1;
+    }
+}
+
+/** @brief Free a block which doesn't come from the hooks */
+static void free_foreign(void)
+{
+    /* Room before the block, so the header read stays in bounds */
+    char *block = calloc(1, 64);
+
+    ts_free(block + 32);
+}
+
+int main(void)
+{
+    RpmspecArena *arena;
+    RpmspecArenaStats stats;
+    size_t reserved;
+    char *outside;
+    char *inside;
+    char *other;
+    char *grown;
+    int *zeroed;
+
+    rpmspec_arena_install();
+    CHECK(ts_malloc != NULL);
+
+    /* Outside of an arena the blocks come from malloc */
+    outside = ts_malloc(100);
+    memset(outside, 'o', 100);
+    outside = ts_realloc(outside, 10000);
+    CHECK(filled(outside, 'o', 100));
+
+    arena = rpmspec_arena_new(4096);
+    CHECK(arena != NULL);
+    rpmspec_arena_begin(arena);
+
+    /* The most recent block grows in place, others move */
+    inside = ts_malloc(24);
+    memset(inside, 'i', 24);
+    grown = ts_realloc(inside, 48);
+    CHECK(grown == inside);
+    CHECK(filled(grown, 'i', 24));
+    other = ts_malloc(16);
+    grown = ts_realloc(inside, 100);
+    CHECK(grown != inside);
+    CHECK(filled(grown, 'i', 24));
+    ts_free(other);
+
+    /* Larger than a chunk */
+    other = ts_malloc(10000);
+    memset(other, 'x', 10000);
+
+    zeroed = ts_calloc(32, sizeof(*zeroed));
+    CHECK(filled(zeroed, 0, 32 * sizeof(*zeroed)));
+    CHECK(ts_calloc(SIZE_MAX / 2, 4) == NULL);
+
+    /* A malloc block stays one inside the arena and can be freed there */
+    outside = ts_realloc(outside, 20000);
+    CHECK(filled(outside, 'o', 100));
+
+    rpmspec_arena_stats(arena, &stats);
+    CHECK(stats.allocations == 5);
+    CHECK(stats.reserved >= 10000 + 4096);
+    rpmspec_arena_end(arena);
+
+    /* An arena block reallocated outside moves to malloc */
+    grown = ts_realloc(grown, 200);
+    CHECK(filled(grown, 'i', 24));
+    ts_free(grown);
+
+    /* A reset releases everything, the chunks merge into one */
+    rpmspec_arena_stats(arena, &stats);
+    reserved = stats.reserved;
+    rpmspec_arena_reset(arena);
+    rpmspec_arena_stats(arena, &stats);
+    CHECK(stats.allocations == 0 && stats.used == 0);
+
+    rpmspec_arena_begin(arena);
+    inside = ts_malloc(10000);
+    memset(inside, 'j', 10000);
+    rpmspec_arena_stats(arena, &stats);
+    CHECK(stats.reserved == reserved);
+    rpmspec_arena_end(arena);
+    rpmspec_arena_reset(arena);
+
+    ts_free(outside);
+    ts_free(NULL);
+    rpmspec_arena_delete(arena);
+
+    expect_abort(free_foreign, "allocated before rpmspec_arena_install()");
+    expect_abort(rpmspec_arena_install, "after the first allocation");
+
+    printf("arena checks %s\n", failed ? "failed" : "passed");
+    return failed;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file changelog.c
+ * @brief Fixed cases for the %changelog entry index of lazy parses
+ *
+ * rpmspec_lazy_parse() cuts the bodies of the %changelog sections into
+ * entries at the lines starting with '*'. Each case lists the text of every
+ * entry in order; their byte ranges and positions must match exactly. The
+ * trees themselves are compared with full parses by ts-check-split.
+ *
+ * Usage:
+ *   test-changelog
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/changelog.h>
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+#define MAX_ENTRIES 4
+
+struct Case {
+    const char *name;
+    const char *spec;
+    /** The text of each entry, in order */
+    const char *entries[MAX_ENTRIES];
+};
+
+static const struct Case cases[] = {
+    {
+        "entries",
+        "Name: foo\n\n%changelog\n"
+        "* Mon Jan 01 2024 A <a@example.com> - 2\n- two\n\n"
+        "* Sun Dec 31 2023 A <a@example.com> - 1\n- one\n",
+        {
+            "* Mon Jan 01 2024 A <a@example.com> - 2\n- two\n\n",
+            "* Sun Dec 31 2023 A <a@example.com> - 1\n- one\n",
+        },
+    },
+    {
+        /* Lines before the first '*' belong to the first entry */
+        "body without a leading entry line",
+        "Name: foo\n%changelog\n- stray\n"
+        "* Mon Jan 01 2024 A <a@example.com> - 1\n- one\n",
+        {"- stray\n* Mon Jan 01 2024 A <a@example.com> - 1\n- one\n"},
+    },
+    {
+        "CRLF line endings",
+        "Name: foo\r\n%changelog\r\n"
+        "* Mon Jan 01 2024 A <a@example.com> - 2\r\n- two\r\n"
+        "* Sun Dec 31 2023 A <a@example.com> - 1\r\n- one\r\n",
+        {
+            "* Mon Jan 01 2024 A <a@example.com> - 2\r\n- two\r\n",
+            "* Sun Dec 31 2023 A <a@example.com> - 1\r\n- one\r\n",
+        },
+    },
+    {
+        /* Entries keep the order of the spec across sections */
+        "several changelog sections",
+        "Name: foo\n%changelog\n* Mon Jan 01 2024 A <a@example.com> - 2\n"
+        "- two\n%description\nText\n%changelog\n"
+        "* Sun Dec 31 2023 A <a@example.com> - 1\n- one\n"
+        "* Sat Dec 30 2023 A <a@example.com> - 0\n- zero\n",
+        {
+            "* Mon Jan 01 2024 A <a@example.com> - 2\n- two\n",
+            "* Sun Dec 31 2023 A <a@example.com> - 1\n- one\n",
+            "* Sat Dec 30 2023 A <a@example.com> - 0\n- zero\n",
+        },
+    },
+    {
+        "changelog ending the file",
+        "Name: foo\n%changelog\n",
+        {NULL},
+    },
+    {
+        "entry without a final line break",
+        "Name: foo\n%changelog\n* Mon Jan 01 2024 A <a@example.com> - 1",
+        {"* Mon Jan 01 2024 A <a@example.com> - 1"},
+    },
+    {
+        "no changelog",
+        "Name: foo\n%description\nText\n",
+        {NULL},
+    },
+};
+
+/** @brief Row and column of an offset */
+static TSPoint point_at(const char *spec, uint32_t offset)
+{
+    TSPoint point = {0, 0};
+
+    for (uint32_t i = 0; i < offset; i++) {
+        if (spec[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+    return point;
+}
+
+static int same_point(TSPoint a, TSPoint b)
+{
+    return a.row == b.row && a.column == b.column;
+}
+
+static int check_case(TSParser *parser, const struct Case *test)
+{
+    const char *spec = test->spec;
+    uint32_t size = (uint32_t)strlen(spec);
+    RpmspecLazyTree *lazy = rpmspec_lazy_parse(parser, spec, size);
+    const char *from = spec;
+    uint32_t expected_count = 0;
+    int failed = 0;
+
+    if (lazy == NULL) {
+        fprintf(stderr, "%s: rpmspec_lazy_parse failed\n", test->name);
+        return 1;
+    }
+    while (expected_count < MAX_ENTRIES &&
+           test->entries[expected_count] != NULL) {
+        expected_count++;
+    }
+    if (rpmspec_lazy_tree_entry_count(lazy) != expected_count) {
+        fprintf(stderr,
+                "%s: %u entries, expected %u\n",
+                test->name,
+                rpmspec_lazy_tree_entry_count(lazy),
+                expected_count);
+        failed = 1;
+    }
+
+    for (uint32_t i = 0; !failed && i < expected_count; i++) {
+        const RpmspecSection *entry = rpmspec_lazy_tree_entry(lazy, i);
+        const char *text = strstr(from, test->entries[i]);
+        uint32_t start;
+        uint32_t end;
+
+        if (text == NULL) {
+            fprintf(stderr, "%s: no entry %u in the spec\n", test->name, i);
+            failed = 1;
+            break;
+        }
+        start = (uint32_t)(text - spec);
+        end = start + (uint32_t)strlen(test->entries[i]);
+        from = spec + end;
+
+        if (entry->start_byte != start || entry->end_byte != end ||
+            !same_point(entry->start_point, point_at(spec, start)) ||
+            !same_point(entry->end_point, point_at(spec, end))) {
+            fprintf(stderr,
+                    "%s: entry %u is %u-%u, expected %u-%u\n",
+                    test->name,
+                    i,
+                    entry->start_byte,
+                    entry->end_byte,
+                    start,
+                    end);
+            failed = 1;
+        }
+    }
+    if (rpmspec_lazy_tree_entry(lazy, expected_count) != NULL) {
+        fprintf(stderr, "%s: entry after the last one\n", test->name);
+        failed = 1;
+    }
+
+    rpmspec_lazy_tree_delete(lazy);
+    return failed;
+}
+
+int main(void)
+{
+    TSParser *parser = ts_parser_new();
+    size_t failed = 0;
+    size_t total = sizeof(cases) / sizeof(cases[0]);
+
+    if (!ts_parser_set_language(parser, tree_sitter_rpmspec())) {
+        fprintf(stderr, "Incompatible rpmspec language version\n");
+        return 1;
+    }
+    for (size_t i = 0; i < total; i++) {
+        failed += (size_t)check_case(parser, &cases[i]);
+    }
+    ts_parser_delete(parser);
+    printf("%zu of %zu changelog index cases passed\n", total - failed, total);
+
+    return failed == 0 ? 0 : 1;
+}
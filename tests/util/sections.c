@@ -0,0 +1,181 @@
+/**
+ * @file sections.c
+ * @brief Fixed cases for the section index and the preamble length
+ *
+ * rpmspec_sections_find() and rpmspec_preamble_length() only look at the
+ * keywords at the start of lines, so they are checked here without a
+ * parser. Each case lists the lines which must start a range; the first
+ * range always starts at offset 0 and is not listed. The preamble ends at
+ * the first listed line, or at the end of the spec if there is none.
+ * ts-check-split checks the same functions against full parses of the
+ * corpus.
+ *
+ * Usage:
+ *   test-sections
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tree_sitter/rpmspec/preamble.h>
+#include <tree_sitter/rpmspec/sections.h>
+
+#define MAX_STARTS 4
+
+struct Case {
+    const char *name;
+    const char *spec;
+    /** Lines starting a section after the preamble, in order */
+    const char *starts[MAX_STARTS];
+};
+
+static const struct Case cases[] = {
+    {
+        "no sections",
+        "Name: foo\nVersion: 1\n",
+        {NULL},
+    },
+    {
+        "sections",
+        "Name: foo\n\n%description\nText\n\n%prep\n%build\nmake\n",
+        {"%description\n", "%prep\n", "%build\n"},
+    },
+    {
+        /* A scriptlet in the body makes it a top-level conditional */
+        "files with a conditional scriptlet",
+        "Name: foo\n\n%files\n/usr/bin/foo\n"
+        "%if 0%{?fedora}\n%post\n/sbin/ldconfig\n%endif\n",
+        {"%files\n", "%if 0%{?fedora}\n"},
+    },
+    {
+        /* Files alone keep the conditional inside %files */
+        "files with conditional files",
+        "Name: foo\n\n%files\n/usr/bin/foo\n"
+        "%if 0%{?fedora}\n/usr/bin/bar\n%endif\n",
+        {"%files\n"},
+    },
+    {
+        /* The preamble never ends in an open %if */
+        "unterminated conditional with a section",
+        "Name: foo\n%if 0%{?fedora}\n%description\nText\n",
+        {"%if 0%{?fedora}\n"},
+    },
+    {
+        "unterminated conditional without a section",
+        "Name: foo\n%if 0%{?fedora}\nVersion: 1\n",
+        {NULL},
+    },
+    {
+        "define with a continuation line",
+        "Name: foo\n%define desc \\\n%description\n%build\nmake\n",
+        {"%build\n"},
+    },
+    {
+        "CRLF line endings",
+        "Name: foo\r\n%define desc \\\r\n%description\r\n"
+        "\r\n%description devel\r\nText\r\n%prep\r\n",
+        {"%description devel\r\n", "%prep\r\n"},
+    },
+};
+
+/** @brief Row and column of an offset */
+static TSPoint point_at(const char *spec, uint32_t offset)
+{
+    TSPoint point = {0, 0};
+
+    for (uint32_t i = 0; i < offset; i++) {
+        if (spec[i] == '\n') {
+            point.row++;
+            point.column = 0;
+        } else {
+            point.column++;
+        }
+    }
+    return point;
+}
+
+static int check_case(const struct Case *test)
+{
+    const char *spec = test->spec;
+    uint32_t size = (uint32_t)strlen(spec);
+    uint32_t expected[MAX_STARTS + 1];
+    uint32_t expected_count = 0;
+    uint32_t preamble;
+    RpmspecSection *sections;
+    uint32_t count;
+    int failed = 0;
+
+    /* The offsets of the listed lines */
+    expected[expected_count++] = 0;
+    for (int i = 0; i < MAX_STARTS && test->starts[i] != NULL; i++) {
+        const char *line = strstr(spec, test->starts[i]);
+
+        if (line == NULL) {
+            fprintf(stderr, "%s: no line %s\n", test->name, test->starts[i]);
+            return 1;
+        }
+        expected[expected_count++] = (uint32_t)(line - spec);
+    }
+
+    preamble = rpmspec_preamble_length(spec, size);
+    if (preamble != (expected_count > 1 ? expected[1] : size)) {
+        fprintf(stderr,
+                "%s: preamble length %u, expected %u\n",
+                test->name,
+                preamble,
+                expected_count > 1 ? expected[1] : size);
+        failed = 1;
+    }
+
+    if (rpmspec_sections_find(spec, size, &sections, &count) != 0) {
+        fprintf(stderr, "%s: rpmspec_sections_find failed\n", test->name);
+        return 1;
+    }
+    if (count != expected_count) {
+        fprintf(stderr,
+                "%s: %u sections, expected %u\n",
+                test->name,
+                count,
+                expected_count);
+        failed = 1;
+    }
+    for (uint32_t i = 0; !failed && i < count; i++) {
+        uint32_t end = i + 1 < count ? expected[i + 1] : size;
+        TSPoint start_point = point_at(spec, expected[i]);
+        TSPoint end_point = point_at(spec, end);
+
+        if (sections[i].start_byte != expected[i] ||
+            sections[i].end_byte != end ||
+            sections[i].start_point.row != start_point.row ||
+            sections[i].start_point.column != start_point.column ||
+            sections[i].end_point.row != end_point.row ||
+            sections[i].end_point.column != end_point.column) {
+            fprintf(stderr,
+                    "%s: section %u is %u-%u, expected %u-%u\n",
+                    test->name,
+                    i,
+                    sections[i].start_byte,
+                    sections[i].end_byte,
+                    expected[i],
+                    end);
+            failed = 1;
+        }
+    }
+    free(sections);
+
+    return failed;
+}
+
+int main(void)
+{
+    size_t failed = 0;
+    size_t total = sizeof(cases) / sizeof(cases[0]);
+
+    for (size_t i = 0; i < total; i++) {
+        failed += (size_t)check_case(&cases[i]);
+    }
+    printf("%zu of %zu section index cases passed\n", total - failed, total);
+
+    return failed == 0 ? 0 : 1;
+}
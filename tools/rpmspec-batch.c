@@ -0,0 +1,916 @@
+/**
+ * @file rpmspec-batch.c
+ * @brief Parse a tree of spec files in parallel and stream NDJSON results
+ *
+ * Walks the given directories for files ending in the suffix (default
+ * .spec); files named on the command line are always parsed. The files are
+ * split into one contiguous range per worker thread. A worker takes files
+ * from the front of its own range and, once it runs dry, steals the back
+ * half of another worker's range, so a few huge specs don't leave the other
+ * cores idle.
+ *
+ * Every worker keeps one TSParser for its whole life; the TSLanguage
+ * returned by tree_sitter_rpmspec() is immutable and shared by all of them.
+ * Files are mapped, not copied (see tree_sitter/rpmspec/input.h). The only
+ * shared state written during the run is the output stream, which is locked
+ * once per result line.
+ *
+ * One JSON object is written per file as soon as it is parsed:
+ *
+ *   {"path":"a.spec","bytes":1234,"parse_ms":0.512,"nodes":321,
+ *    "error_count":1,"errors":[{"type":"ERROR","start":[4,0],"end":[4,9]}]}
+ *
+ * Positions are zero-based [row, column] pairs like in tree-sitter's own
+ * output. MISSING nodes are reported with the symbol that was inserted.
+ * Files which can't be read get {"path":...,"error":"<reason>"} instead.
+ * A summary is printed to stderr at the end.
+ *
+ * With -c the results are kept in a persistent cache (see
+ * tree_sitter/rpmspec/cache.h). Files whose contents and grammar are
+ * unchanged are reported from the cache with "cached":true instead of
+ * being parsed again. The entry holds the result line only, so with -p
+ * that is the preamble length and not the preamble's tags.
+ *
+ * With -T the tree of every parsed file is cached as well, serialized with
+ * rpmspec_tree_serialize() under the kind RPMSPEC_CACHE_KIND_TREE (or
+ * "tree-preamble" with -p). Other tools can then read it with
+ * rpmspec_tree_view_init() instead of parsing the file. A file is only
+ * reported from the cache if its tree is there too.
+ *
+ * With -p only the preamble of each spec is parsed (see
+ * tree_sitter/rpmspec/preamble.h) and its length is reported as
+ * "preamble_bytes".
+ *
+ * With -a every parse allocates from an arena of its worker (see
+ * tree_sitter/rpmspec/arena.h), which is reset after the file instead of
+ * freeing the tree node by node. The parser is then created per file, as
+ * it can't outlive the arena.
+ *
+ * Usage:
+ *   rpmspec-batch [-a] [-p] [-T] [-t THREADS] [-s SUFFIX] [-c DIR]
+ *                 [-o FILE] PATH...
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/arena.h>
+#include <tree_sitter/rpmspec/cache.h>
+#include <tree_sitter/rpmspec/input.h>
+#include <tree_sitter/rpmspec/preamble.h>
+#include <tree_sitter/rpmspec/treefile.h>
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+/** @brief Errors listed per file, error_count still counts all of them */
+#define MAX_ERRORS_PER_FILE 64
+
+/** @brief Kinds of the cache entries holding a file's result */
+#define CACHE_KIND "batch"
+#define CACHE_KIND_PREAMBLE "batch-preamble"
+
+/** @brief Kind of the cache entries holding a preamble's tree */
+#define CACHE_KIND_TREE_PREAMBLE "tree-preamble"
+
+/** @brief A growable byte buffer */
+struct Buffer {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+/** @brief The files to parse, collected before the workers start */
+struct FileList {
+    char **paths;
+    size_t count;
+    size_t cap;
+};
+
+/** @brief The range of files a worker hasn't taken yet */
+struct Range {
+    pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+};
+
+/** @brief Counts of one parse, cached along with its result */
+struct Summary {
+    uint32_t nodes;
+    uint32_t errors;
+    double parse_ms;
+};
+
+/** @brief Totals of one worker, added up after the run */
+struct Totals {
+    size_t files;
+    size_t cached;
+    size_t failed;
+    size_t with_errors;
+    uint64_t bytes;
+    uint64_t nodes;
+    double parse_ms;
+};
+
+struct Batch;
+
+/** @brief A worker thread with its long-lived parser and buffer */
+struct Worker {
+    struct Batch *batch;
+    size_t id;
+    pthread_t thread;
+    struct Range range;
+    /** NULL with an arena, which gets a new parser per file */
+    TSParser *parser;
+    RpmspecArena *arena;
+    struct Buffer line;
+    struct Totals totals;
+};
+
+/** @brief State shared by all workers */
+struct Batch {
+    const struct FileList *files;
+    struct Worker *workers;
+    size_t num_workers;
+    RpmspecCache *cache;
+    const char *cache_kind;
+    /** NULL unless trees are cached */
+    const char *tree_kind;
+    int preamble_only;
+    int use_arena;
+    FILE *out;
+    pthread_mutex_t out_lock;
+};
+
+static void *xrealloc(void *ptr, size_t size)
+{
+    ptr = realloc(ptr, size);
+    if (ptr == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    return ptr;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* ========================================================================== */
+/* OUTPUT BUFFER                                                              */
+/* ========================================================================== */
+
+static void buffer_reserve(struct Buffer *buf, size_t extra)
+{
+    if (buf->len + extra > buf->cap) {
+        buf->cap = (buf->len + extra) * 2;
+        buf->data = xrealloc(buf->data, buf->cap);
+    }
+}
+
+static void buffer_printf(struct Buffer *buf, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+
+    buffer_reserve(buf, (size_t)n + 1);
+    va_start(ap, fmt);
+    vsnprintf(buf->data + buf->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    buf->len += (size_t)n;
+}
+
+/**
+ * @brief Length of the valid UTF-8 sequence at @p s, 0 if it is invalid
+ *
+ * Overlong forms, surrogates and code points above U+10FFFF are invalid.
+ * The NUL terminator is never a continuation byte, so @p s isn't read past
+ * it.
+ */
+static size_t utf8_length(const unsigned char *s)
+{
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+    size_t len;
+
+    if (s[0] < 0x80) {
+        return 1;
+    } else if (s[0] >= 0xc2 && s[0] <= 0xdf) {
+        len = 2;
+    } else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+        len = 3;
+        lo = s[0] == 0xe0 ? 0xa0 : 0x80;
+        hi = s[0] == 0xed ? 0x9f : 0xbf;
+    } else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+        len = 4;
+        lo = s[0] == 0xf0 ? 0x90 : 0x80;
+        hi = s[0] == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
+    }
+
+    if (s[1] < lo || s[1] > hi) {
+        return 0;
+    }
+    for (size_t i = 2; i < len; i++) {
+        if (s[i] < 0x80 || s[i] > 0xbf) {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Append a string as a JSON string literal
+ *
+ * Paths can be in any encoding, so every byte which isn't part of valid
+ * UTF-8 is replaced by U+FFFD to keep the output valid JSON.
+ */
+static void buffer_json_string(struct Buffer *buf, const char *str)
+{
+    const unsigned char *s = (const unsigned char *)str;
+
+    buffer_reserve(buf, strlen(str) * 6 + 2);
+    buf->data[buf->len++] = '"';
+    while (*s != '\0') {
+        size_t len = utf8_length(s);
+
+        if (*s == '"' || *s == '\\') {
+            buf->data[buf->len++] = '\\';
+            buf->data[buf->len++] = (char)*s;
+        } else if (*s < 0x20) {
+            buf->len +=
+                (size_t)snprintf(buf->data + buf->len, 7, "\\u%04x", *s);
+        } else if (len == 0) {
+            memcpy(buf->data + buf->len, "\\ufffd", 6);
+            buf->len += 6;
+            len = 1;
+        } else {
+            memcpy(buf->data + buf->len, s, len);
+            buf->len += len;
+        }
+        s += len;
+    }
+    buf->data[buf->len++] = '"';
+}
+
+/* ========================================================================== */
+/* FILE DISCOVERY                                                             */
+/* ========================================================================== */
+
+static void file_list_add(struct FileList *files, const char *path)
+{
+    if (files->count == files->cap) {
+        files->cap = files->cap ? files->cap * 2 : 1024;
+        files->paths =
+            xrealloc(files->paths, files->cap * sizeof(*files->paths));
+    }
+    files->paths[files->count] = strdup(path);
+    if (files->paths[files->count] == NULL) {
+        perror("strdup");
+        exit(1);
+    }
+    files->count++;
+}
+
+static int has_suffix(const char *str, const char *suffix)
+{
+    size_t len = strlen(str);
+    size_t n = strlen(suffix);
+
+    return len >= n && strcmp(str + len - n, suffix) == 0;
+}
+
+/**
+ * @brief Add a file, or all matching files below a directory
+ *
+ * @param files The list to add to
+ * @param path File or directory to add
+ * @param suffix Suffix of the files to pick up in directories
+ * @param explicit Whether @p path was named on the command line
+ *
+ * Symbolic links found in directories are followed to files but not to
+ * directories, which could form a loop.
+ */
+static int collect_path(struct FileList *files,
+                        const char *path,
+                        const char *suffix,
+                        int explicit)
+{
+    struct stat st;
+
+    if ((explicit ? stat(path, &st) : lstat(path, &st)) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return explicit ? -1 : 0;
+    }
+    if (S_ISLNK(st.st_mode)) {
+        if (stat(path, &st) != 0) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return 0;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            return 0;
+        }
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        struct dirent *entry;
+        int rc = 0;
+
+        if (dir == NULL) {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            return explicit ? -1 : 0;
+        }
+        while (rc == 0 && (entry = readdir(dir)) != NULL) {
+            char child[4096];
+            int n;
+
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            n = snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            if (n < 0 || (size_t)n >= sizeof(child)) {
+                fprintf(stderr,
+                        "%s/%s: %s\n",
+                        path,
+                        entry->d_name,
+                        strerror(ENAMETOOLONG));
+                continue;
+            }
+            rc = collect_path(files, child, suffix, 0);
+        }
+        closedir(dir);
+        return rc;
+    }
+
+    if (explicit || (S_ISREG(st.st_mode) && has_suffix(path, suffix))) {
+        file_list_add(files, path);
+    }
+    return 0;
+}
+
+/* ========================================================================== */
+/* PARSING                                                                    */
+/* ========================================================================== */
+
+static void append_point(struct Buffer *line, TSPoint point)
+{
+    buffer_printf(line, "[%u,%u]", point.row, point.column);
+}
+
+/**
+ * @brief Append the ERROR and MISSING nodes of a tree to the result line
+ *
+ * Only subtrees containing an error are entered, so trees without errors
+ * cost a single check of the root. ERROR nodes are reported as a whole and
+ * not entered.
+ *
+ * @return The number of errors found, including the ones not listed
+ */
+static size_t append_errors(struct Buffer *line, TSNode root)
+{
+    TSTreeCursor cursor;
+    size_t count = 0;
+
+    buffer_printf(line, ",\"errors\":[");
+    if (!ts_node_has_error(root)) {
+        buffer_printf(line, "]");
+        return 0;
+    }
+
+    cursor = ts_tree_cursor_new(root);
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+        int is_error = ts_node_is_error(node);
+        int is_missing = ts_node_is_missing(node);
+
+        if (is_error || is_missing) {
+            if (count < MAX_ERRORS_PER_FILE) {
+                buffer_printf(line,
+                              "%s{\"type\":\"%s\"",
+                              count > 0 ? "," : "",
+                              is_error ? "ERROR" : "MISSING");
+                if (is_missing) {
+                    buffer_printf(line, ",\"symbol\":");
+                    buffer_json_string(line, ts_node_type(node));
+                }
+                buffer_printf(line, ",\"start\":");
+                append_point(line, ts_node_start_point(node));
+                buffer_printf(line, ",\"end\":");
+                append_point(line, ts_node_end_point(node));
+                buffer_printf(line, "}");
+            }
+            count++;
+        }
+
+        if (!is_error && ts_node_has_error(node) &&
+            ts_tree_cursor_goto_first_child(&cursor)) {
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                goto done;
+            }
+        }
+    }
+
+done:
+    ts_tree_cursor_delete(&cursor);
+    buffer_printf(line, "]");
+    return count;
+}
+
+/** @brief Serialize a tree into the cache */
+static void cache_store_tree(struct Worker *worker,
+                             const RpmspecCacheKey *key,
+                             const TSTree *tree)
+{
+    void *data = NULL;
+    size_t size = 0;
+
+    if (rpmspec_tree_serialize(tree, &data, &size) != 0) {
+        return;
+    }
+    /* Like the result, a tree that isn't stored is parsed again next time */
+    (void)rpmspec_cache_put(
+        worker->batch->cache, key, worker->batch->tree_kind, data, size);
+    free(data);
+}
+
+/**
+ * @brief Parse a file and append its result fields to the line
+ *
+ * @param key The cache key of the file, NULL without a cache
+ * @param summary Receives the counts of the parse
+ */
+static void parse_file(struct Worker *worker,
+                       RpmspecFile *file,
+                       const RpmspecCacheKey *key,
+                       struct Summary *summary)
+{
+    struct Buffer *line = &worker->line;
+    TSParser *parser = worker->parser;
+    uint32_t preamble = 0;
+    double start;
+    TSTree *tree;
+    TSNode root;
+
+    if (worker->arena != NULL) {
+        rpmspec_arena_begin(worker->arena);
+        parser = ts_parser_new();
+        ts_parser_set_language(parser, tree_sitter_rpmspec());
+    }
+
+    start = now_ms();
+    if (worker->batch->preamble_only) {
+        tree = rpmspec_parse_preamble(parser,
+                                      rpmspec_file_data(file),
+                                      rpmspec_file_size(file),
+                                      &preamble);
+    } else {
+        tree = rpmspec_file_parse(parser, NULL, file);
+    }
+    summary->parse_ms = now_ms() - start;
+    root = ts_tree_root_node(tree);
+    summary->nodes = ts_node_descendant_count(root);
+
+    buffer_printf(line,
+                  ",\"bytes\":%u,\"parse_ms\":%.3f,\"nodes\":%u",
+                  rpmspec_file_size(file),
+                  summary->parse_ms,
+                  summary->nodes);
+    if (worker->batch->preamble_only) {
+        buffer_printf(line, ",\"preamble_bytes\":%u", preamble);
+    }
+    summary->errors = (uint32_t)append_errors(line, root);
+    buffer_printf(line, ",\"error_count\":%u", summary->errors);
+    if (key != NULL && worker->batch->tree_kind != NULL) {
+        cache_store_tree(worker, key, tree);
+    }
+
+    if (worker->arena != NULL) {
+        /* The tree goes with the arena, the scanner state may not */
+        ts_parser_delete(parser);
+        rpmspec_arena_end(worker->arena);
+        rpmspec_arena_reset(worker->arena);
+    } else {
+        ts_tree_delete(tree);
+    }
+}
+
+/**
+ * @brief Append the cached result fields of a file to the line
+ *
+ * A cache entry is the Summary followed by the result fields as written
+ * by parse_file(). When trees are cached, a file whose tree is missing
+ * counts as a miss, so that it is parsed and its tree stored.
+ *
+ * @return 1 on a hit, 0 on a miss
+ */
+static int cache_lookup(struct Worker *worker,
+                        const RpmspecCacheKey *key,
+                        struct Summary *summary)
+{
+    void *value = NULL;
+    size_t len = 0;
+    int rc;
+
+    if (worker->batch->tree_kind != NULL) {
+        rc = rpmspec_cache_get(
+            worker->batch->cache, key, worker->batch->tree_kind, &value, &len);
+        free(value);
+        value = NULL;
+        if (rc != 0) {
+            return 0;
+        }
+    }
+
+    rc = rpmspec_cache_get(
+        worker->batch->cache, key, worker->batch->cache_kind, &value, &len);
+    if (rc != 0 || len < sizeof(*summary)) {
+        free(value);
+        return 0;
+    }
+    memcpy(summary, value, sizeof(*summary));
+    buffer_reserve(&worker->line, len);
+    memcpy(worker->line.data + worker->line.len,
+           (char *)value + sizeof(*summary),
+           len - sizeof(*summary));
+    worker->line.len += len - sizeof(*summary);
+    buffer_printf(&worker->line, ",\"cached\":true");
+    free(value);
+
+    return 1;
+}
+
+/** @brief Store the result fields starting at @p fields in the cache */
+static void cache_store(struct Worker *worker,
+                        const RpmspecCacheKey *key,
+                        const struct Summary *summary,
+                        size_t fields)
+{
+    size_t len = worker->line.len - fields;
+    char *value = malloc(sizeof(*summary) + len);
+
+    if (value == NULL) {
+        return;
+    }
+    memcpy(value, summary, sizeof(*summary));
+    memcpy(value + sizeof(*summary), worker->line.data + fields, len);
+    /* A failed store only costs a parse next time */
+    (void)rpmspec_cache_put(worker->batch->cache,
+                            key,
+                            worker->batch->cache_kind,
+                            value,
+                            sizeof(*summary) + len);
+    free(value);
+}
+
+/** @brief Parse one file, or take its result from the cache */
+static void process_file(struct Worker *worker, const char *path)
+{
+    struct Buffer *line = &worker->line;
+    RpmspecFile *file;
+
+    line->len = 0;
+    buffer_printf(line, "{\"path\":");
+    buffer_json_string(line, path);
+
+    file = rpmspec_file_open(path);
+    if (file == NULL) {
+        buffer_printf(line, ",\"error\":");
+        buffer_json_string(line, strerror(errno));
+        worker->totals.failed++;
+    } else {
+        size_t fields = line->len;
+        struct Summary summary;
+        RpmspecCacheKey key;
+        const RpmspecCacheKey *cache_key = NULL;
+        int cached = 0;
+
+        if (worker->batch->cache != NULL) {
+            rpmspec_cache_key(
+                rpmspec_file_data(file), rpmspec_file_size(file), &key);
+            cache_key = &key;
+            cached = cache_lookup(worker, &key, &summary);
+        }
+        if (cached) {
+            worker->totals.cached++;
+        } else {
+            parse_file(worker, file, cache_key, &summary);
+            worker->totals.parse_ms += summary.parse_ms;
+            if (worker->batch->cache != NULL) {
+                cache_store(worker, &key, &summary, fields);
+            }
+        }
+
+        worker->totals.files++;
+        worker->totals.bytes += rpmspec_file_size(file);
+        worker->totals.nodes += summary.nodes;
+        if (summary.errors > 0) {
+            worker->totals.with_errors++;
+        }
+        rpmspec_file_close(file);
+    }
+    buffer_printf(line, "}\n");
+
+    pthread_mutex_lock(&worker->batch->out_lock);
+    fwrite(line->data, 1, line->len, worker->batch->out);
+    pthread_mutex_unlock(&worker->batch->out_lock);
+}
+
+/* ========================================================================== */
+/* WORK STEALING                                                              */
+/* ========================================================================== */
+
+/** @brief Take the next file from the front of the worker's own range */
+static int take_own(struct Worker *worker, size_t *index)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&worker->range.lock);
+    if (worker->range.begin < worker->range.end) {
+        *index = worker->range.begin++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&worker->range.lock);
+    return found;
+}
+
+/**
+ * @brief Steal the back half of another worker's range
+ *
+ * No work is created during the run, so if every other range is empty the
+ * worker is done.
+ */
+static int steal(struct Worker *worker)
+{
+    struct Batch *batch = worker->batch;
+
+    for (size_t i = 1; i < batch->num_workers; i++) {
+        struct Worker *victim =
+            &batch->workers[(worker->id + i) % batch->num_workers];
+        size_t begin = 0;
+        size_t end = 0;
+
+        pthread_mutex_lock(&victim->range.lock);
+        if (victim->range.begin < victim->range.end) {
+            size_t n = (victim->range.end - victim->range.begin + 1) / 2;
+
+            end = victim->range.end;
+            begin = end - n;
+            victim->range.end = begin;
+        }
+        pthread_mutex_unlock(&victim->range.lock);
+
+        if (begin < end) {
+            pthread_mutex_lock(&worker->range.lock);
+            worker->range.begin = begin;
+            worker->range.end = end;
+            pthread_mutex_unlock(&worker->range.lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg)
+{
+    struct Worker *worker = arg;
+    const struct FileList *files = worker->batch->files;
+    size_t index;
+
+    do {
+        while (take_own(worker, &index)) {
+            process_file(worker, files->paths[index]);
+        }
+    } while (steal(worker));
+
+    return NULL;
+}
+
+/* ========================================================================== */
+/* MAIN                                                                       */
+/* ========================================================================== */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-a] [-p] [-T] [-t THREADS] [-s SUFFIX] [-c DIR] "
+            "[-o FILE] PATH...\n"
+            "\n"
+            "  -a          Allocate each parse from a per-thread arena\n"
+            "  -p          Parse only the preamble, up to the first section\n"
+            "  -T          Cache the serialized tree of each file too,\n"
+            "              requires -c\n"
+            "  -t THREADS  Number of worker threads (default: online CPUs)\n"
+            "  -s SUFFIX   Suffix of the files parsed in directories\n"
+            "              (default: .spec)\n"
+            "  -c DIR      Cache results in DIR, reuse them for unchanged\n"
+            "              files\n"
+            "  -o FILE     Write the NDJSON results to FILE, default stdout\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    struct FileList files = {0};
+    struct Batch batch = {0};
+    struct Totals sum = {0};
+    const char *suffix = ".spec";
+    const char *output = NULL;
+    const char *cache_dir = NULL;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t num_workers = ncpu > 0 ? (size_t)ncpu : 1;
+    double start;
+    double wall_ms;
+    int cache_trees = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "apTt:s:c:o:h")) != -1) {
+        switch (opt) {
+        case 'a':
+            batch.use_arena = 1;
+            break;
+        case 'p':
+            batch.preamble_only = 1;
+            break;
+        case 'T':
+            cache_trees = 1;
+            break;
+        case 't':
+            num_workers = (size_t)strtoul(optarg, NULL, 10);
+            if (num_workers == 0) {
+                num_workers = 1;
+            }
+            break;
+        case 's':
+            suffix = optarg;
+            break;
+        case 'c':
+            cache_dir = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc || (cache_trees && cache_dir == NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (collect_path(&files, argv[i], suffix, 1) != 0) {
+            return 1;
+        }
+    }
+    if (num_workers > files.count) {
+        num_workers = files.count > 0 ? files.count : 1;
+    }
+
+    batch.files = &files;
+    batch.cache_kind =
+        batch.preamble_only ? CACHE_KIND_PREAMBLE : CACHE_KIND;
+    if (cache_trees) {
+        batch.tree_kind = batch.preamble_only ? CACHE_KIND_TREE_PREAMBLE
+                                              : RPMSPEC_CACHE_KIND_TREE;
+    }
+    batch.num_workers = num_workers;
+    batch.out = stdout;
+    if (output != NULL) {
+        batch.out = fopen(output, "w");
+        if (batch.out == NULL) {
+            fprintf(stderr, "%s: %s\n", output, strerror(errno));
+            return 1;
+        }
+    }
+    if (cache_dir != NULL) {
+        batch.cache = rpmspec_cache_open(cache_dir);
+        if (batch.cache == NULL) {
+            fprintf(stderr, "%s: %s\n", cache_dir, strerror(errno));
+            return 1;
+        }
+    }
+    pthread_mutex_init(&batch.out_lock, NULL);
+    if (batch.use_arena) {
+        /* Before tree-sitter allocates anything */
+        rpmspec_arena_install();
+    }
+
+    batch.workers = calloc(num_workers, sizeof(*batch.workers));
+    if (batch.workers == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+        struct Worker *worker = &batch.workers[i];
+
+        worker->batch = &batch;
+        worker->id = i;
+        pthread_mutex_init(&worker->range.lock, NULL);
+        worker->range.begin = files.count * i / num_workers;
+        worker->range.end = files.count * (i + 1) / num_workers;
+        worker->parser = ts_parser_new();
+        if (!ts_parser_set_language(worker->parser, tree_sitter_rpmspec())) {
+            fprintf(stderr, "rpmspec: incompatible tree-sitter library\n");
+            return 1;
+        }
+        if (batch.use_arena) {
+            /* Only needed to check the language */
+            ts_parser_delete(worker->parser);
+            worker->parser = NULL;
+            worker->arena = rpmspec_arena_new(0);
+            if (worker->arena == NULL) {
+                perror("rpmspec_arena_new");
+                return 1;
+            }
+        }
+    }
+
+    start = now_ms();
+    for (size_t i = 0; i < num_workers; i++) {
+        struct Worker *worker = &batch.workers[i];
+
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            fprintf(stderr, "Failed to start worker %zu\n", i);
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < num_workers; i++) {
+        struct Worker *worker = &batch.workers[i];
+
+        pthread_join(worker->thread, NULL);
+        sum.files += worker->totals.files;
+        sum.cached += worker->totals.cached;
+        sum.failed += worker->totals.failed;
+        sum.with_errors += worker->totals.with_errors;
+        sum.bytes += worker->totals.bytes;
+        sum.nodes += worker->totals.nodes;
+        sum.parse_ms += worker->totals.parse_ms;
+
+        if (worker->parser != NULL) {
+            ts_parser_delete(worker->parser);
+        }
+        rpmspec_arena_delete(worker->arena);
+        free(worker->line.data);
+        pthread_mutex_destroy(&worker->range.lock);
+    }
+    wall_ms = now_ms() - start;
+
+    if (batch.out != stdout) {
+        fclose(batch.out);
+    } else {
+        fflush(stdout);
+    }
+
+    fprintf(stderr,
+            "%zu files (%zu with errors, %zu unreadable, %zu cached), "
+            "%.1f MiB, %llu nodes\n"
+            "%zu threads, %.1f ms wall, %.1f ms parsing, %.1f MB/s\n",
+            sum.files,
+            sum.with_errors,
+            sum.failed,
+            sum.cached,
+            (double)sum.bytes / (1024.0 * 1024.0),
+            (unsigned long long)sum.nodes,
+            num_workers,
+            wall_ms,
+            sum.parse_ms,
+            wall_ms > 0 ? (double)sum.bytes / 1e3 / wall_ms : 0.0);
+
+    for (size_t i = 0; i < files.count; i++) {
+        free(files.paths[i]);
+    }
+    free(files.paths);
+    free(batch.workers);
+    rpmspec_cache_close(batch.cache);
+    pthread_mutex_destroy(&batch.out_lock);
+
+    return sum.failed > 0 ? 1 : 0;
+}
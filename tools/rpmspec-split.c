@@ -0,0 +1,453 @@
+/**
+ * @file rpmspec-split.c
+ * @brief Check and time the per-section parallel parse against a full parse
+ *
+ * Parses every file twice, once in one piece and once split at its
+ * sections (see tree_sitter/rpmspec/sections.h), and compares the
+ * top-level nodes of both: their S-expressions and byte ranges must be
+ * identical. One line per file reports the number of pieces and both parse
+ * times; files whose trees differ are reported with the first difference.
+ *
+ * By default every section gets its own piece, which checks the section
+ * index as thoroughly as possible. -m sets the smallest piece, e.g. to
+ * the library default of 65536 for realistic timings.
+ *
+ * The lazy parse of tree_sitter/rpmspec/changelog.h is checked the same
+ * way: all of its %changelog entries are expanded at once, and every
+ * changelog node of the expansion must match the one at the same place in
+ * the full parse. Changelog nodes without entries are left out, as the
+ * lazy parse doesn't index them.
+ *
+ * Finally the shell scriptlets are parsed in one go with
+ * tree_sitter/rpmspec/scripts.h, and the top-level rpmbash nodes mapped to
+ * each block must match a parse of that block on its own. Blocks with
+ * errors of their own are skipped: the joint parse carries an unterminated
+ * construct on into the next block by design.
+ *
+ * Usage:
+ *   rpmspec-split [-t THREADS] [-m BYTES] FILE...
+ *
+ * Exits with 1 if any file differs or can't be parsed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/changelog.h>
+#include <tree_sitter/rpmspec/input.h>
+#include <tree_sitter/rpmspec/scripts.h>
+#include <tree_sitter/rpmspec/sections.h>
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+/* rpmbash has no C binding header */
+const TSLanguage *tree_sitter_rpmbash(void);
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Compare the top-level nodes of both parses
+ *
+ * @return 0 if they are identical, otherwise 1 after reporting the first
+ *         difference
+ */
+static int compare(const char *path,
+                   TSNode root,
+                   const RpmspecSplitTree *split)
+{
+    uint32_t count = ts_node_child_count(root);
+    TSTreeCursor cursor = ts_tree_cursor_new(root);
+    uint32_t i = 0;
+    int rc = 0;
+
+    if (count != rpmspec_split_tree_child_count(split)) {
+        fprintf(stderr,
+                "%s: %u top-level nodes, %u when split\n",
+                path,
+                count,
+                rpmspec_split_tree_child_count(split));
+        ts_tree_cursor_delete(&cursor);
+        return 1;
+    }
+    if (!ts_tree_cursor_goto_first_child(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return 0;
+    }
+    do {
+        TSNode full = ts_tree_cursor_current_node(&cursor);
+        TSNode part = rpmspec_split_tree_child(split, i);
+        char *full_sexp = ts_node_string(full);
+        char *part_sexp = ts_node_string(part);
+
+        if (ts_node_start_byte(full) != ts_node_start_byte(part) ||
+            ts_node_end_byte(full) != ts_node_end_byte(part) ||
+            strcmp(full_sexp, part_sexp) != 0) {
+            fprintf(stderr,
+                    "%s: top-level node %u differs\n"
+                    "  full:  [%u, %u] %s\n"
+                    "  split: [%u, %u] %s\n",
+                    path,
+                    i,
+                    ts_node_start_byte(full),
+                    ts_node_end_byte(full),
+                    full_sexp,
+                    ts_node_start_byte(part),
+                    ts_node_end_byte(part),
+                    part_sexp);
+            rc = 1;
+        }
+        free(full_sexp);
+        free(part_sexp);
+        i++;
+    } while (rc == 0 && ts_tree_cursor_goto_next_sibling(&cursor));
+
+    ts_tree_cursor_delete(&cursor);
+    return rc;
+}
+
+/** @brief Growable list of nodes */
+struct Nodes {
+    TSNode *node;
+    uint32_t count;
+    uint32_t cap;
+};
+
+/**
+ * @brief Collect the changelog nodes with children below @p root
+ *
+ * Changelogs may be nested in top-level conditionals.
+ */
+static void collect_changelogs(TSNode root, struct Nodes *nodes)
+{
+    TSTreeCursor cursor = ts_tree_cursor_new(root);
+
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+
+        if (strcmp(ts_node_type(node), "changelog") == 0) {
+            if (ts_node_named_child_count(node) > 0) {
+                if (nodes->count == nodes->cap) {
+                    nodes->cap = nodes->cap ? nodes->cap * 2 : 8;
+                    nodes->node = realloc(nodes->node,
+                                          nodes->cap * sizeof(*nodes->node));
+                    if (nodes->node == NULL) {
+                        perror("realloc");
+                        exit(1);
+                    }
+                }
+                nodes->node[nodes->count++] = node;
+            }
+        } else if (ts_tree_cursor_goto_first_child(&cursor)) {
+            continue;
+        }
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compare the changelogs of the full parse with a lazy parse whose
+ *        entries are all expanded
+ *
+ * @return 0 if they are identical, otherwise 1 after reporting the first
+ *         difference
+ */
+static int compare_changelogs(const char *path,
+                              TSParser *parser,
+                              RpmspecFile *file,
+                              TSNode root)
+{
+    RpmspecLazyTree *lazy = rpmspec_lazy_parse(
+        parser, rpmspec_file_data(file), rpmspec_file_size(file));
+    struct Nodes full = {0};
+    struct Nodes part = {0};
+    TSTree *expanded = NULL;
+    int rc = 0;
+
+    if (lazy == NULL) {
+        fprintf(stderr, "%s: lazy parse failed\n", path);
+        return 1;
+    }
+    if (rpmspec_lazy_tree_entry_count(lazy) > 0) {
+        expanded = rpmspec_lazy_tree_expand(
+            lazy, parser, 0, rpmspec_lazy_tree_entry_count(lazy));
+        if (expanded == NULL) {
+            fprintf(stderr, "%s: expanding the changelog failed\n", path);
+            rpmspec_lazy_tree_delete(lazy);
+            return 1;
+        }
+        collect_changelogs(ts_tree_root_node(expanded), &part);
+    }
+    collect_changelogs(root, &full);
+
+    if (full.count != part.count) {
+        fprintf(stderr,
+                "%s: %u changelogs with entries, %u when expanded\n",
+                path,
+                full.count,
+                part.count);
+        rc = 1;
+    }
+    for (uint32_t i = 0; rc == 0 && i < full.count; i++) {
+        char *full_sexp = ts_node_string(full.node[i]);
+        char *part_sexp = ts_node_string(part.node[i]);
+
+        if (ts_node_start_byte(full.node[i]) !=
+                ts_node_start_byte(part.node[i]) ||
+            ts_node_end_byte(full.node[i]) != ts_node_end_byte(part.node[i]) ||
+            strcmp(full_sexp, part_sexp) != 0) {
+            fprintf(stderr,
+                    "%s: changelog %u differs\n"
+                    "  full:     [%u, %u] %s\n"
+                    "  expanded: [%u, %u] %s\n",
+                    path,
+                    i,
+                    ts_node_start_byte(full.node[i]),
+                    ts_node_end_byte(full.node[i]),
+                    full_sexp,
+                    ts_node_start_byte(part.node[i]),
+                    ts_node_end_byte(part.node[i]),
+                    part_sexp);
+            rc = 1;
+        }
+        free(full_sexp);
+        free(part_sexp);
+    }
+
+    free(full.node);
+    free(part.node);
+    ts_tree_delete(expanded);
+    rpmspec_lazy_tree_delete(lazy);
+    return rc;
+}
+
+/**
+ * @brief Compare the top-level rpmbash nodes of one block with a parse of
+ *        the block alone
+ *
+ * @return 0 if they are identical or the block has errors on its own,
+ *         otherwise 1 after reporting the first difference
+ */
+static int compare_block(const char *path,
+                         TSParser *bash,
+                         RpmspecFile *file,
+                         const RpmspecScripts *scripts,
+                         uint32_t index)
+{
+    TSNode block = rpmspec_scripts_block(scripts, index);
+    TSRange range = {
+        ts_node_start_point(block),
+        ts_node_end_point(block),
+        ts_node_start_byte(block),
+        ts_node_end_byte(block),
+    };
+    uint32_t count = rpmspec_scripts_child_count(scripts, index);
+    TSTree *tree = NULL;
+    TSNode root;
+    int rc = 0;
+
+    if (ts_parser_set_included_ranges(bash, &range, 1)) {
+        tree = ts_parser_parse_string(
+            bash, NULL, rpmspec_file_data(file), rpmspec_file_size(file));
+    }
+    ts_parser_set_included_ranges(bash, NULL, 0);
+    if (tree == NULL) {
+        fprintf(stderr, "%s: rpmbash parse of block %u failed\n", path, index);
+        return 1;
+    }
+    root = ts_tree_root_node(tree);
+    if (ts_node_has_error(root)) {
+        ts_tree_delete(tree);
+        return 0;
+    }
+
+    if (ts_node_child_count(root) != count) {
+        fprintf(stderr,
+                "%s: block %u has %u top-level rpmbash nodes, %u alone\n",
+                path,
+                index,
+                count,
+                ts_node_child_count(root));
+        rc = 1;
+    }
+    for (uint32_t i = 0; rc == 0 && i < count; i++) {
+        TSNode joint = rpmspec_scripts_child(scripts, index, i);
+        TSNode alone = ts_node_child(root, i);
+        char *joint_sexp = ts_node_string(joint);
+        char *alone_sexp = ts_node_string(alone);
+
+        if (ts_node_start_byte(joint) != ts_node_start_byte(alone) ||
+            ts_node_end_byte(joint) != ts_node_end_byte(alone) ||
+            strcmp(joint_sexp, alone_sexp) != 0) {
+            fprintf(stderr,
+                    "%s: rpmbash node %u of block %u differs\n"
+                    "  joint: [%u, %u] %s\n"
+                    "  alone: [%u, %u] %s\n",
+                    path,
+                    i,
+                    index,
+                    ts_node_start_byte(joint),
+                    ts_node_end_byte(joint),
+                    joint_sexp,
+                    ts_node_start_byte(alone),
+                    ts_node_end_byte(alone),
+                    alone_sexp);
+            rc = 1;
+        }
+        free(joint_sexp);
+        free(alone_sexp);
+    }
+
+    ts_tree_delete(tree);
+    return rc;
+}
+
+/**
+ * @brief Compare the joint parse of the shell scriptlets with one parse per
+ *        block
+ *
+ * @return 0 if they are identical, otherwise 1 after reporting the first
+ *         difference
+ */
+static int compare_scripts(const char *path,
+                           TSParser *bash,
+                           RpmspecFile *file,
+                           const TSTree *tree)
+{
+    RpmspecScripts *scripts = rpmspec_scripts_parse(
+        bash, tree, rpmspec_file_data(file), rpmspec_file_size(file));
+    int rc = 0;
+
+    if (scripts == NULL) {
+        fprintf(stderr, "%s: rpmbash parse of the scriptlets failed\n", path);
+        return 1;
+    }
+    for (uint32_t i = 0; rc == 0 && i < rpmspec_scripts_count(scripts); i++) {
+        rc = compare_block(path, bash, file, scripts, i);
+    }
+
+    rpmspec_scripts_delete(scripts);
+    return rc;
+}
+
+static int check_file(TSParser *parser,
+                      TSParser *bash,
+                      const char *path,
+                      unsigned threads,
+                      uint32_t min_piece)
+{
+    RpmspecFile *file = rpmspec_file_open(path);
+    RpmspecSplitTree *split;
+    TSTree *tree;
+    double start;
+    double full_ms;
+    double split_ms;
+    int rc;
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    start = now_ms();
+    tree = rpmspec_file_parse(parser, NULL, file);
+    full_ms = now_ms() - start;
+
+    start = now_ms();
+    split = rpmspec_split_parse(rpmspec_file_data(file),
+                                rpmspec_file_size(file),
+                                threads,
+                                min_piece);
+    split_ms = now_ms() - start;
+
+    if (tree == NULL || split == NULL) {
+        fprintf(stderr, "%s: parse failed\n", path);
+        rc = 1;
+    } else {
+        rc = compare(path, ts_tree_root_node(tree), split);
+        rc |= compare_changelogs(path, parser, file, ts_tree_root_node(tree));
+        rc |= compare_scripts(path, bash, file, tree);
+        printf("%s: %u bytes, %u pieces, full %.3f ms, split %.3f ms%s\n",
+               path,
+               rpmspec_file_size(file),
+               rpmspec_split_tree_count(split),
+               full_ms,
+               split_ms,
+               rc == 0 ? "" : ", DIFFERS");
+    }
+
+    rpmspec_split_tree_delete(split);
+    ts_tree_delete(tree);
+    rpmspec_file_close(file);
+    return rc;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-t THREADS] [-m BYTES] FILE...\n"
+            "\n"
+            "  -t THREADS  Threads of the split parse (default: online "
+            "CPUs)\n"
+            "  -m BYTES    Smallest piece (default: 0, one per section)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned threads = 0;
+    uint32_t min_piece = 0;
+    TSParser *parser;
+    TSParser *bash;
+    int failed = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:m:h")) != -1) {
+        switch (opt) {
+        case 't':
+            threads = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            min_piece = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    parser = ts_parser_new();
+    bash = ts_parser_new();
+    if (!ts_parser_set_language(parser, tree_sitter_rpmspec()) ||
+        !ts_parser_set_language(bash, tree_sitter_rpmbash())) {
+        fprintf(stderr, "Incompatible language version\n");
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        failed |= check_file(parser, bash, argv[i], threads, min_piece);
+    }
+    ts_parser_delete(bash);
+    ts_parser_delete(parser);
+
+    return failed;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file arena.h
+ * @brief Bump allocator for tree-sitter, reset wholesale after each parse
+ *
+ * A parse makes tens of thousands of small allocations for subtrees, stack
+ * nodes and arrays, and ts_tree_delete() frees them one by one again. With
+ * many threads parsing, this traffic contends in malloc. An arena serves
+ * the allocations of a thread from a private chunk by bumping a pointer,
+ * makes free a no-op, and releases everything at once on reset.
+ *
+ * rpmspec_arena_install() sets the allocator of the tree-sitter library
+ * with ts_set_allocator(). It has to be called before anything is
+ * allocated by tree-sitter, as blocks carry a header telling who owns
+ * them. Freeing a block allocated before, or installing the allocator
+ * after it served an allocation, aborts the program with a message.
+ * Outside of an arena, allocations go to malloc as before.
+ *
+ * A thread uses an arena between rpmspec_arena_begin() and
+ * rpmspec_arena_end(). Everything tree-sitter allocates meanwhile belongs
+ * to the arena and is gone after rpmspec_arena_reset(). This includes the
+ * internal buffers of a parser which stay allocated between parses, so a
+ * parser must be created and deleted within the same arena scope:
+ *
+ *   rpmspec_arena_begin(arena);
+ *   parser = ts_parser_new();
+ *   ts_parser_set_language(parser, tree_sitter_rpmspec());
+ *   tree = ts_parser_parse_string(parser, NULL, data, size);
+ *   ... use the tree ...
+ *   ts_parser_delete(parser);
+ *   rpmspec_arena_end(arena);
+ *   rpmspec_arena_reset(arena);
+ *
+ * Trees may be dropped without ts_tree_delete(), which saves walking them.
+ * The parser has to be deleted, unless the project is built with
+ * TREE_SITTER_REUSE_ALLOCATOR: without it the external scanner allocates
+ * its state with the plain libc allocator.
+ *
+ * An arena is used by one thread at a time. Each thread of a batch should
+ * have its own.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_ARENA_H_
+#define TREE_SITTER_RPMSPEC_ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default size of the chunks of an arena */
+#define RPMSPEC_ARENA_CHUNK_SIZE (1024 * 1024)
+
+typedef struct RpmspecArena RpmspecArena;
+
+/** Counters of an arena since the last reset */
+typedef struct {
+    /** Number of blocks allocated */
+    size_t allocations;
+    /** Bytes handed out, including headers and padding */
+    size_t used;
+    /** Bytes of the chunks held by the arena */
+    size_t reserved;
+} RpmspecArenaStats;
+
+/**
+ * Make the arenas the allocator of tree-sitter.
+ *
+ * Call this once, before the first parser is created. Aborts if the
+ * allocator has already served an allocation.
+ */
+void rpmspec_arena_install(void);
+
+/**
+ * Create an arena.
+ *
+ * No memory is reserved until the first allocation. After a reset which
+ * needed more than one chunk, the arena keeps a single chunk as large as
+ * all of them, so a parse of the same size fits into one chunk.
+ *
+ * @param chunk_size Size of the first chunk, 0 for RPMSPEC_ARENA_CHUNK_SIZE
+ *
+ * @return The arena, or NULL if out of memory
+ */
+RpmspecArena *rpmspec_arena_new(size_t chunk_size);
+
+/** Delete an arena with all of its chunks. NULL is ignored. */
+void rpmspec_arena_delete(RpmspecArena *arena);
+
+/** Allocate the tree-sitter memory of the calling thread from @p arena */
+void rpmspec_arena_begin(RpmspecArena *arena);
+
+/** Allocate the tree-sitter memory of the calling thread with malloc */
+void rpmspec_arena_end(RpmspecArena *arena);
+
+/**
+ * Release all blocks of an arena.
+ *
+ * Parsers, trees and cursors created in the arena must not be used or
+ * deleted afterwards.
+ */
+void rpmspec_arena_reset(RpmspecArena *arena);
+
+/** Get the counters of an arena */
+void rpmspec_arena_stats(const RpmspecArena *arena, RpmspecArenaStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_ARENA_H_
@@ -0,0 +1,121 @@
+/**
+ * @file cache.h
+ * @brief Persistent on-disk cache of results derived from a parse
+ *
+ * Most specs don't change between runs, so anything extracted from their
+ * trees (error lists, metadata, serialized trees) can be stored and reused
+ * instead of parsing again. An entry is keyed by:
+ *
+ * - the XXH64 hashes (two seeds, 128 bits) and the size of the file bytes,
+ * - the grammar fingerprint: TREE_SITTER_ABI_VERSION, PROJECT_VERSION and
+ *   the SHA-256 of parser.c and scanner.c of both grammars, taken when the
+ *   library is configured,
+ * - a kind chosen by the caller, so several results can be stored per file.
+ *
+ * Each fingerprint gets its own subdirectory, so regenerating the parser or
+ * changing a scanner invalidates all entries without any bookkeeping.
+ * Directories of other fingerprints can be deleted at any time.
+ *
+ * Entries are written to a temporary file and renamed into place, so
+ * several threads and processes can share one cache directory. Entries and
+ * directories are created with the modes of any new file, 0666 and 0777
+ * minus the umask, so with a umask of 002 a group can share the cache.
+ *
+ * rpmspec-batch stores its result line per file (the error list, and with
+ * -p the preamble length rather than the preamble's tags). With -T it also
+ * stores each tree under RPMSPEC_CACHE_KIND_TREE, which is the place to
+ * take anything else from, e.g. metadata:
+ *
+ *     RpmspecTreeView view;
+ *     void *value;
+ *     size_t len;
+ *
+ *     if (rpmspec_cache_get(cache, &key, RPMSPEC_CACHE_KIND_TREE,
+ *                           &value, &len) == 0 &&
+ *         rpmspec_tree_view_init(&view, value, len) == 0) {
+ *         ...
+ *     }
+ *     free(value);
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_CACHE_H_
+#define TREE_SITTER_RPMSPEC_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Kind of entries holding a tree serialized with rpmspec_tree_serialize()
+ * (see treefile.h). Values are allocated with malloc(), so they are aligned
+ * for rpmspec_tree_view_init().
+ */
+#define RPMSPEC_CACHE_KIND_TREE "tree"
+
+/** A cache directory */
+typedef struct RpmspecCache RpmspecCache;
+
+/** The key of a file's contents */
+typedef struct RpmspecCacheKey {
+    uint64_t hash[2];
+    uint64_t size;
+} RpmspecCacheKey;
+
+/**
+ * The grammar fingerprint of this library.
+ *
+ * A hex string which changes whenever the ABI version, the project version
+ * or a generated parser or scanner changes.
+ */
+const char *rpmspec_cache_fingerprint(void);
+
+/**
+ * Open a cache directory, creating it if needed.
+ *
+ * Returns NULL and sets errno on failure.
+ */
+RpmspecCache *rpmspec_cache_open(const char *dir);
+
+/** Close the cache. NULL is ignored. */
+void rpmspec_cache_close(RpmspecCache *cache);
+
+/** Compute the key of a file's contents */
+void rpmspec_cache_key(const char *data, size_t len, RpmspecCacheKey *key);
+
+/**
+ * Look up an entry.
+ *
+ * @param cache The cache
+ * @param key The key of the file's contents
+ * @param kind Name of the result, [A-Za-z0-9_-] only
+ * @param value Receives the value on a hit, release it with free()
+ * @param value_len Receives the size of the value
+ *
+ * @return 0 on a hit, ENOENT on a miss, an errno value otherwise. Entries
+ *         which are truncated or belong to another key count as a miss.
+ */
+int rpmspec_cache_get(RpmspecCache *cache,
+                      const RpmspecCacheKey *key,
+                      const char *kind,
+                      void **value,
+                      size_t *value_len);
+
+/**
+ * Store an entry, replacing an existing one.
+ *
+ * @return 0 on success, an errno value otherwise
+ */
+int rpmspec_cache_put(RpmspecCache *cache,
+                      const RpmspecCacheKey *key,
+                      const char *kind,
+                      const void *value,
+                      size_t value_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_CACHE_H_
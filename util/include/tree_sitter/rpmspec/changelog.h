@@ -0,0 +1,84 @@
+/**
+ * @file changelog.h
+ * @brief Parse a spec with its %changelog left for later
+ *
+ * In long-lived packages %changelog is often most of the spec, and each of
+ * its lines becomes a changelog_entry, string and string_content node,
+ * although few tools ever look at it. rpmspec_lazy_parse() parses the spec
+ * without the bodies of its %changelog sections: the tree keeps an empty
+ * changelog node, and the entries are only indexed by their lines
+ * starting with '*'.
+ *
+ * Entries are parsed on demand with rpmspec_lazy_tree_expand(), which
+ * parses just the %changelog line and the requested entries through
+ * included ranges. The nodes of the expanded tree have the byte offsets
+ * and positions of the whole spec.
+ *
+ * Entries are cut at lines, so a conditional spanning several entries is
+ * only parsed correctly if they are expanded together.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_CHANGELOG_H_
+#define TREE_SITTER_RPMSPEC_CHANGELOG_H_
+
+#include <stdint.h>
+
+#include <tree_sitter/api.h>
+#include <tree_sitter/rpmspec/sections.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A spec parsed without the bodies of its %changelog sections */
+typedef struct RpmspecLazyTree RpmspecLazyTree;
+
+/**
+ * Parse a spec, skipping the %changelog entries.
+ *
+ * The included ranges of @p parser are reset to the whole document
+ * afterwards.
+ *
+ * @param parser A parser set to tree_sitter_rpmspec()
+ * @param data The spec, which must stay valid as long as the result
+ * @param size Length of the spec
+ *
+ * @return The lazy tree, or NULL if out of memory or the parse failed
+ */
+RpmspecLazyTree *
+rpmspec_lazy_parse(TSParser *parser, const char *data, uint32_t size);
+
+/** Delete the lazy tree. NULL is ignored. */
+void rpmspec_lazy_tree_delete(RpmspecLazyTree *lazy);
+
+/** The tree of the spec, with empty changelog nodes */
+const TSTree *rpmspec_lazy_tree_root(const RpmspecLazyTree *lazy);
+
+/** The number of %changelog entries of all %changelog sections */
+uint32_t rpmspec_lazy_tree_entry_count(const RpmspecLazyTree *lazy);
+
+/** The byte range of an entry, NULL if @p index is out of range */
+const RpmspecSection *rpmspec_lazy_tree_entry(const RpmspecLazyTree *lazy,
+                                              uint32_t index);
+
+/**
+ * Parse %changelog entries.
+ *
+ * The root of the result holds a changelog node with the changelog_entry
+ * nodes of entries @p first to @p first + @p count - 1, one changelog node
+ * per %changelog section they belong to. The included ranges of @p parser
+ * are reset to the whole document afterwards.
+ *
+ * @return A new tree, release it with ts_tree_delete(), or NULL if the
+ *         range is empty or invalid, or the parse failed
+ */
+TSTree *rpmspec_lazy_tree_expand(const RpmspecLazyTree *lazy,
+                                 TSParser *parser,
+                                 uint32_t first,
+                                 uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_CHANGELOG_H_
@@ -0,0 +1,79 @@
+/**
+ * @file input.h
+ * @brief Zero-copy parser input backed by a memory mapped file
+ *
+ * ts_parser_parse_string() needs the whole document in one buffer, so most
+ * consumers read the file into the heap first. A RpmspecFile maps the file
+ * instead and hands the mapping to ts_parser_parse() through a TSInput read
+ * callback. Nothing is copied, and processes parsing the same spec share
+ * its pages in the page cache.
+ *
+ * The mapping is advised for sequential access, which is how the lexer
+ * reads it. Files that can't be mapped (pipes, character devices) are read
+ * into a heap buffer instead, so every path works.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_INPUT_H_
+#define TREE_SITTER_RPMSPEC_INPUT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** An open spec file, mapped or read into memory */
+typedef struct RpmspecFile RpmspecFile;
+
+/**
+ * Open and map a file.
+ *
+ * Returns NULL and sets errno on failure. Files of 4 GiB or more fail with
+ * EFBIG, tree-sitter addresses bytes with 32 bits.
+ */
+RpmspecFile *rpmspec_file_open(const char *path);
+
+/**
+ * Wrap an open file descriptor.
+ *
+ * The descriptor is not closed and may be closed right after the call.
+ * Returns NULL and sets errno on failure.
+ */
+RpmspecFile *rpmspec_file_open_fd(int fd);
+
+/** Unmap and free the file. NULL is ignored. */
+void rpmspec_file_close(RpmspecFile *file);
+
+/** The contents of the file, not NUL terminated */
+const char *rpmspec_file_data(const RpmspecFile *file);
+
+/** The size of the file in bytes */
+uint32_t rpmspec_file_size(const RpmspecFile *file);
+
+/**
+ * A TSInput reading the file.
+ *
+ * Each read returns everything from the requested byte to the end of the
+ * file, so the lexer never has to ask twice for the same region. The input
+ * is valid until the file is closed.
+ */
+TSInput rpmspec_file_input(RpmspecFile *file);
+
+/**
+ * Parse the file.
+ *
+ * Shorthand for ts_parser_parse() with rpmspec_file_input(). The tree does
+ * not reference the file, which may be closed afterwards.
+ */
+TSTree *rpmspec_file_parse(TSParser *parser,
+                           const TSTree *old_tree,
+                           RpmspecFile *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_INPUT_H_
@@ -0,0 +1,109 @@
+/**
+ * @file pool.h
+ * @brief Thread-safe pool of parsers, query cursors and compiled queries
+ *
+ * Creating a TSParser for every input is cheap next to the parse, but
+ * compiling highlights.scm or injections.scm is not: it runs the query
+ * analysis over the whole grammar. A service highlighting many small specs
+ * spends more time there than parsing.
+ *
+ * A pool compiles each query of both grammars once, on first use, and
+ * keeps it until the pool is deleted. Parsers and query cursors are handed
+ * out for one request and returned afterwards, so they are only created
+ * when all existing ones are busy. Returning a parser resets it: it starts
+ * the next parse from scratch and over the whole document.
+ *
+ * All functions may be called from any thread. A parser or cursor belongs
+ * to the thread that acquired it until it is released. The compiled
+ * queries are shared, so use them only through query cursors, and don't
+ * disable their captures or patterns.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_POOL_H_
+#define TREE_SITTER_RPMSPEC_POOL_H_
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The grammars of this project */
+typedef enum {
+    RPMSPEC_LANGUAGE_RPMSPEC,
+    RPMSPEC_LANGUAGE_RPMBASH,
+    RPMSPEC_LANGUAGE_COUNT,
+} RpmspecLanguage;
+
+/** The query files shipped with each grammar */
+typedef enum {
+    /** queries/highlights.scm */
+    RPMSPEC_QUERY_HIGHLIGHTS,
+    /** queries/injections.scm */
+    RPMSPEC_QUERY_INJECTIONS,
+    RPMSPEC_QUERY_COUNT,
+} RpmspecQueryKind;
+
+typedef struct RpmspecPool RpmspecPool;
+
+/** The TSLanguage of a grammar, NULL for an unknown one */
+const TSLanguage *rpmspec_language(RpmspecLanguage language);
+
+/** Create an empty pool, NULL if out of memory */
+RpmspecPool *rpmspec_pool_new(void);
+
+/**
+ * Delete a pool with its idle parsers and cursors and its queries.
+ *
+ * Everything acquired from the pool must have been released. NULL is
+ * ignored.
+ */
+void rpmspec_pool_delete(RpmspecPool *pool);
+
+/**
+ * Take a parser set to @p language.
+ *
+ * @return The parser, or NULL if out of memory or the language is unknown
+ */
+TSParser *rpmspec_pool_acquire_parser(RpmspecPool *pool,
+                                      RpmspecLanguage language);
+
+/**
+ * Return a parser to the pool.
+ *
+ * The parser is reset, and its included ranges are set to the whole
+ * document. @p language must be the one it was acquired for. NULL is
+ * ignored.
+ */
+void rpmspec_pool_release_parser(RpmspecPool *pool,
+                                 RpmspecLanguage language,
+                                 TSParser *parser);
+
+/**
+ * The compiled query of a grammar.
+ *
+ * The query is compiled by the first call and owned by the pool.
+ *
+ * @return The query, or NULL if out of memory, the arguments are unknown
+ *         or the query doesn't compile for the linked grammar
+ */
+const TSQuery *rpmspec_pool_query(RpmspecPool *pool,
+                                  RpmspecLanguage language,
+                                  RpmspecQueryKind kind);
+
+/** Take a query cursor, NULL if out of memory */
+TSQueryCursor *rpmspec_pool_acquire_cursor(RpmspecPool *pool);
+
+/**
+ * Return a query cursor to the pool.
+ *
+ * Its byte and point ranges are reset to the whole document. NULL is
+ * ignored.
+ */
+void rpmspec_pool_release_cursor(RpmspecPool *pool, TSQueryCursor *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_POOL_H_
@@ -0,0 +1,59 @@
+/**
+ * @file preamble.h
+ * @brief Parse only the preamble of a spec, for metadata extraction
+ *
+ * Tools reading Name, Version, License, Source, Requires and the like only
+ * need the preamble, which is usually a small fraction of the file. These
+ * functions cut the spec before its first section (%description, %package,
+ * %prep, %files, ...) and parse that prefix alone. The parser sees a spec
+ * without sections, so the tree holds complete preamble_tag and dependency
+ * nodes, with byte offsets and positions equal to those in the whole file.
+ *
+ * Sections are recognized with the keyword table of the rpmspec scanner,
+ * at the start of a line and outside line continuations. If the first
+ * section is inside a conditional, the cut is moved before the outermost
+ * open %if, so the prefix never ends in an unterminated conditional.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_PREAMBLE_H_
+#define TREE_SITTER_RPMSPEC_PREAMBLE_H_
+
+#include <stdint.h>
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Get the length of the preamble.
+ *
+ * Only the preamble itself is scanned, so this is cheap even for specs
+ * with a huge %changelog or %files.
+ *
+ * @return The offset of the line starting the first section, or @p size
+ *         if the spec has no sections
+ */
+uint32_t rpmspec_preamble_length(const char *data, uint32_t size);
+
+/**
+ * Parse the preamble of a spec.
+ *
+ * @param parser A parser set to tree_sitter_rpmspec()
+ * @param data The spec, e.g. rpmspec_file_data() of a mapped file
+ * @param size Length of the spec
+ * @param length Receives the length of the preamble, may be NULL
+ *
+ * @return The tree, or NULL if the parse failed
+ */
+TSTree *rpmspec_parse_preamble(TSParser *parser,
+                               const char *data,
+                               uint32_t size,
+                               uint32_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_PREAMBLE_H_
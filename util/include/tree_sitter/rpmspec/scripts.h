@@ -0,0 +1,82 @@
+/**
+ * @file scripts.h
+ * @brief Parse all shell scriptlets of a spec with a single rpmbash parse
+ *
+ * queries/injections.scm injects rpmbash into every script_block on its
+ * own, which costs one parse per scriptlet. rpmspec_scripts_parse()
+ * instead collects the script_block nodes the injections would hand to
+ * rpmbash and parses them in one call, with one included range per block,
+ * and maps each block to the top-level rpmbash nodes inside it.
+ *
+ * The blocks are parsed as one script, so a construct left open at the
+ * end of a block, like an unterminated quote, continues into the next
+ * block instead of ending in an error right there. Blocks the injections
+ * hand to other languages are not included: those of scriptlets whose -p
+ * names no shell, those of triggers with -p <lua> or perl, and those of
+ * file triggers with -p <lua>. Like in the injections, any other
+ * interpreter of a trigger, python included, gets rpmbash.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_SCRIPTS_H_
+#define TREE_SITTER_RPMSPEC_SCRIPTS_H_
+
+#include <stdint.h>
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The rpmbash parse of all shell script blocks of a spec */
+typedef struct RpmspecScripts RpmspecScripts;
+
+/**
+ * Parse the shell script blocks of a spec.
+ *
+ * The included ranges of @p parser are reset to the whole document
+ * afterwards.
+ *
+ * @param parser A parser set to tree_sitter_rpmbash()
+ * @param spec The rpmspec tree of the spec, which must outlive the result
+ * @param data The spec the tree was parsed from
+ * @param size Length of the spec
+ *
+ * @return The scripts, or NULL if out of memory or the parse failed. A
+ *         spec without shell scriptlets gives an empty result.
+ */
+RpmspecScripts *rpmspec_scripts_parse(TSParser *parser,
+                                      const TSTree *spec,
+                                      const char *data,
+                                      uint32_t size);
+
+/** Delete the scripts. NULL is ignored. */
+void rpmspec_scripts_delete(RpmspecScripts *scripts);
+
+/** The rpmbash tree of all blocks, NULL if there are none */
+const TSTree *rpmspec_scripts_tree(const RpmspecScripts *scripts);
+
+/** The number of script blocks */
+uint32_t rpmspec_scripts_count(const RpmspecScripts *scripts);
+
+/** A script_block node of the rpmspec tree, in source order */
+TSNode rpmspec_scripts_block(const RpmspecScripts *scripts, uint32_t index);
+
+/**
+ * The number of top-level rpmbash nodes of a block.
+ *
+ * A node belongs to the block it starts in.
+ */
+uint32_t rpmspec_scripts_child_count(const RpmspecScripts *scripts,
+                                     uint32_t index);
+
+/** A top-level rpmbash node of a block */
+TSNode rpmspec_scripts_child(const RpmspecScripts *scripts,
+                             uint32_t index,
+                             uint32_t child);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_SCRIPTS_H_
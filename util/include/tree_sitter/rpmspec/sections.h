@@ -0,0 +1,119 @@
+/**
+ * @file sections.h
+ * @brief Section index of a spec, and parallel parsing of its sections
+ *
+ * A spec is a preamble followed by top-level sections which don't depend
+ * on each other: once a section keyword starts a line, the parser is back
+ * at the top level no matter what came before. The sections of a huge
+ * spec can therefore be parsed on several cores, each one limited to its
+ * byte range with ts_parser_set_included_ranges(), and their trees put
+ * side by side.
+ *
+ * The section index is one linear pass over the lines. A section starts at
+ * a line with a section keyword outside of any conditional, or at an
+ * outermost conditional which the scanner turns into a top-level
+ * conditional (TOP_LEVEL_IF and friends): one containing a section, or in
+ * %files one containing a scriptlet. Conditionals the scanner keeps inside
+ * the current section don't start one.
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_SECTIONS_H_
+#define TREE_SITTER_RPMSPEC_SECTIONS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A byte range of a spec, the preamble or one or more sections */
+typedef struct RpmspecSection {
+    uint32_t start_byte;
+    uint32_t end_byte;
+    TSPoint start_point;
+    TSPoint end_point;
+} RpmspecSection;
+
+/**
+ * Find the top-level sections of a spec.
+ *
+ * The preamble, unless empty, is the first range. The ranges are ordered,
+ * don't overlap and cover the whole spec.
+ *
+ * @param data The spec
+ * @param size Length of the spec
+ * @param sections Receives the ranges, release them with free()
+ * @param count Receives the number of ranges, 0 for an empty spec
+ *
+ * @return 0 on success, ENOMEM if out of memory
+ */
+int rpmspec_sections_find(const char *data,
+                          uint32_t size,
+                          RpmspecSection **sections,
+                          uint32_t *count);
+
+/** A spec parsed in pieces */
+typedef struct RpmspecSplitTree RpmspecSplitTree;
+
+/** Default smallest piece of rpmspec_split_parse() */
+#define RPMSPEC_SPLIT_MIN_PIECE (64 * 1024)
+
+/**
+ * Parse a spec with one thread per section.
+ *
+ * Consecutive sections are parsed together until the piece has at least
+ * @p min_piece bytes, as a tree per tiny section costs more than it
+ * saves. Specs below that are parsed in one piece, on the calling thread.
+ *
+ * If any piece has a syntax error, the spec is parsed again in one piece,
+ * so an error can't end up being reported differently than by a full
+ * parse.
+ *
+ * @param data The spec, which must stay valid as long as the result
+ * @param size Length of the spec
+ * @param threads Maximum number of threads, 0 for the number of CPUs
+ * @param min_piece Smallest piece, RPMSPEC_SPLIT_MIN_PIECE by default, 0
+ *        for one piece per section
+ *
+ * @return The trees, or NULL if out of memory or a parse failed
+ */
+RpmspecSplitTree *rpmspec_split_parse(const char *data,
+                                      uint32_t size,
+                                      unsigned threads,
+                                      uint32_t min_piece);
+
+/** Delete the trees. NULL is ignored. */
+void rpmspec_split_tree_delete(RpmspecSplitTree *tree);
+
+/** The number of pieces */
+uint32_t rpmspec_split_tree_count(const RpmspecSplitTree *tree);
+
+/** The tree of a piece. Its root spans only the piece. */
+const TSTree *rpmspec_split_tree_get(const RpmspecSplitTree *tree,
+                                     uint32_t index);
+
+/** The byte range of a piece */
+const RpmspecSection *
+rpmspec_split_tree_range(const RpmspecSplitTree *tree, uint32_t index);
+
+/**
+ * The number of top-level nodes, the children of the roots of all pieces.
+ *
+ * These are the children the root of a full parse would have.
+ */
+uint32_t rpmspec_split_tree_child_count(const RpmspecSplitTree *tree);
+
+/** A top-level node, in source order */
+TSNode rpmspec_split_tree_child(const RpmspecSplitTree *tree, uint32_t index);
+
+/** Whether any piece has a syntax error */
+bool rpmspec_split_tree_has_error(const RpmspecSplitTree *tree);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_SECTIONS_H_
@@ -0,0 +1,174 @@
+/**
+ * @file treefile.h
+ * @brief Compact binary format of parse trees, readable without allocation
+ *
+ * A serialized tree stores every node in pre-order, as one flat array per
+ * attribute: symbol, field, flags, start and end byte, parent index, child
+ * count and descendant count. The children of a node follow it directly,
+ * so walking the tree needs no pointers and no TSTree.
+ *
+ * Symbols and fields are numbered from node-types.json (see
+ * scripts/gen-node-types.py), not with the TSSymbol and TSFieldId of the
+ * generated parser, so files stay valid when parser.c is regenerated. The
+ * names are stored in the file as well, which makes it self-describing and
+ * lets it hold trees of other grammars (e.g. rpmbash) too.
+ *
+ * The format uses the byte order of the writer; readers with another byte
+ * order reject it. All arrays are 8-byte aligned, so a file mapped with
+ * rpmspec_file_open() (see input.h) can be read in place:
+ *
+ *     RpmspecFile *file = rpmspec_file_open("foo.rpmtree");
+ *     RpmspecTreeView view;
+ *
+ *     if (file != NULL &&
+ *         rpmspec_tree_view_init(&view,
+ *                                rpmspec_file_data(file),
+ *                                rpmspec_file_size(file)) == 0) {
+ *         for (uint32_t i = 0; i < view.node_count; i++) {
+ *             puts(rpmspec_tree_symbol_name(&view, i));
+ *         }
+ *     }
+ *     rpmspec_file_close(file);
+ */
+
+#ifndef TREE_SITTER_RPMSPEC_TREEFILE_H_
+#define TREE_SITTER_RPMSPEC_TREEFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <tree_sitter/api.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Format version written by rpmspec_tree_serialize() */
+#define RPMSPEC_TREE_VERSION 1
+
+/** Parent of the root, and result of navigation that has nowhere to go */
+#define RPMSPEC_TREE_NONE UINT32_MAX
+
+/** Symbol of ERROR nodes */
+#define RPMSPEC_TREE_SYMBOL_ERROR 0
+
+/** Field of nodes without a field */
+#define RPMSPEC_TREE_FIELD_NONE 0
+
+/** Node flags */
+#define RPMSPEC_TREE_NAMED 0x01
+#define RPMSPEC_TREE_MISSING 0x02
+#define RPMSPEC_TREE_EXTRA 0x04
+#define RPMSPEC_TREE_ERROR 0x08
+#define RPMSPEC_TREE_HAS_ERROR 0x10
+
+/**
+ * A serialized tree, pointing into the serialized bytes.
+ *
+ * All arrays are indexed by node; node 0 is the root.
+ */
+typedef struct RpmspecTreeView {
+    uint32_t node_count;
+    uint32_t symbol_count;
+    uint32_t field_count;
+    /** End byte of the root node */
+    uint32_t source_size;
+
+    const uint16_t *symbol;
+    const uint16_t *field;
+    const uint8_t *flags;
+    const uint32_t *start_byte;
+    const uint32_t *end_byte;
+    const uint32_t *parent;
+    const uint32_t *child_count;
+    const uint32_t *descendant_count;
+
+    /** Per symbol: 1 if named */
+    const uint8_t *symbol_named;
+    /** Per symbol and field: offset of the NUL terminated name */
+    const uint32_t *symbol_name;
+    const uint32_t *field_name;
+    const char *strings;
+} RpmspecTreeView;
+
+/**
+ * Serialize a tree.
+ *
+ * @param tree The tree to serialize
+ * @param data Receives the serialized bytes, release them with free()
+ * @param size Receives the number of bytes
+ *
+ * @return 0 on success, an errno value otherwise
+ */
+int rpmspec_tree_serialize(const TSTree *tree, void **data, size_t *size);
+
+/**
+ * Serialize a tree into a file.
+ *
+ * The file is written under a temporary name and renamed into place. It
+ * gets the mode of a newly created file, 0666 minus the umask.
+ *
+ * @return 0 on success, an errno value otherwise
+ */
+int rpmspec_tree_save(const TSTree *tree, const char *path);
+
+/**
+ * Check serialized bytes and set up a view of them.
+ *
+ * Every index and offset is validated, so the accessors below can't read
+ * out of bounds even for corrupted input. Nothing is allocated or copied;
+ * the view is valid as long as @p data is.
+ *
+ * @param data The serialized bytes, 8-byte aligned
+ * @param size Number of bytes
+ *
+ * @return 0 on success, EINVAL if the data is not a valid tree, ENOTSUP
+ *         for another format version or byte order
+ */
+int rpmspec_tree_view_init(RpmspecTreeView *view,
+                           const void *data,
+                           size_t size);
+
+/** The type name of a node */
+static inline const char *
+rpmspec_tree_symbol_name(const RpmspecTreeView *view, uint32_t node)
+{
+    return view->strings + view->symbol_name[view->symbol[node]];
+}
+
+/** The field name of a node, NULL if it has none */
+static inline const char *
+rpmspec_tree_field_name(const RpmspecTreeView *view, uint32_t node)
+{
+    if (view->field[node] == RPMSPEC_TREE_FIELD_NONE) {
+        return NULL;
+    }
+    return view->strings + view->field_name[view->field[node]];
+}
+
+/** The first child of a node, RPMSPEC_TREE_NONE if it has none */
+static inline uint32_t rpmspec_tree_first_child(const RpmspecTreeView *view,
+                                                uint32_t node)
+{
+    return view->child_count[node] > 0 ? node + 1 : RPMSPEC_TREE_NONE;
+}
+
+/** The next sibling of a node, RPMSPEC_TREE_NONE if it is the last one */
+static inline uint32_t rpmspec_tree_next_sibling(const RpmspecTreeView *view,
+                                                 uint32_t node)
+{
+    uint32_t parent = view->parent[node];
+    uint32_t next = node + view->descendant_count[node] + 1;
+
+    if (parent == RPMSPEC_TREE_NONE ||
+        next > parent + view->descendant_count[parent]) {
+        return RPMSPEC_TREE_NONE;
+    }
+    return next;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RPMSPEC_TREEFILE_H_
@@ -0,0 +1,329 @@
+/**
+ * @file arena.c
+ * @brief Bump allocator for tree-sitter, reset wholesale after each parse
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tree_sitter/api.h>
+
+#include "tree_sitter/rpmspec/arena.h"
+
+/** @brief Alignment of all blocks, like malloc on 64-bit platforms */
+#define ALIGNMENT 16
+#define ALIGN_UP(n) (((n) + (ALIGNMENT - 1)) & ~(size_t)(ALIGNMENT - 1))
+
+/** @brief Marks the blocks of this allocator, in arenas and from malloc */
+#define BLOCK_MAGIC 0x72706d61U
+
+/** @brief Precedes every block handed to tree-sitter */
+struct BlockHeader {
+    /** The arena owning the block, NULL for malloc */
+    RpmspecArena *arena;
+    /** tree-sitter addresses its input with uint32_t, blocks stay smaller */
+    uint32_t size;
+    uint32_t magic;
+};
+
+#define BLOCK_HEADER ALIGN_UP(sizeof(struct BlockHeader))
+
+/** @brief Largest block, so that header and padding still fit */
+#define BLOCK_SIZE_MAX ((size_t)UINT32_MAX - BLOCK_HEADER - ALIGNMENT)
+
+struct Chunk {
+    struct Chunk *next;
+    size_t size;
+    size_t used;
+};
+
+#define CHUNK_HEADER ALIGN_UP(sizeof(struct Chunk))
+
+struct RpmspecArena {
+    /** The chunk allocated from, followed by the full ones */
+    struct Chunk *chunks;
+    size_t chunk_size;
+    /** The most recent block, which can grow in place */
+    void *last;
+    RpmspecArenaStats stats;
+};
+
+static _Thread_local RpmspecArena *current_arena;
+
+/** @brief Set by the first allocation, rpmspec_arena_install() is too late */
+static atomic_bool allocated;
+
+static void fail(const char *msg)
+{
+    fprintf(stderr, "rpmspec arena: %s\n", msg);
+    abort();
+}
+
+/**
+ * @brief The header of a block tree-sitter frees or reallocates
+ *
+ * A block allocated before rpmspec_arena_install() has no header; the
+ * bytes before it are malloc's own bookkeeping, which doesn't match the
+ * magic. The mistake aborts instead of corrupting the heap.
+ */
+static struct BlockHeader *header_of(void *ptr)
+{
+    struct BlockHeader *header =
+        (struct BlockHeader *)((char *)ptr - BLOCK_HEADER);
+
+    if (header->magic != BLOCK_MAGIC) {
+        fail("block allocated before rpmspec_arena_install()");
+    }
+    return header;
+}
+
+static char *chunk_data(struct Chunk *chunk)
+{
+    return (char *)chunk + CHUNK_HEADER;
+}
+
+/* ========================================================================== */
+/* ARENA                                                                      */
+/* ========================================================================== */
+
+static struct Chunk *arena_add_chunk(RpmspecArena *arena, size_t need)
+{
+    size_t size = need > arena->chunk_size ? need : arena->chunk_size;
+    struct Chunk *chunk = malloc(CHUNK_HEADER + size);
+
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = arena->chunks;
+    chunk->size = size;
+    chunk->used = 0;
+    arena->chunks = chunk;
+    arena->stats.reserved += size;
+    return chunk;
+}
+
+static void *arena_alloc(RpmspecArena *arena, size_t size)
+{
+    struct Chunk *chunk = arena->chunks;
+    struct BlockHeader *header;
+    size_t need;
+
+    if (size > BLOCK_SIZE_MAX) {
+        return NULL;
+    }
+    need = BLOCK_HEADER + ALIGN_UP(size);
+    if (chunk == NULL || chunk->size - chunk->used < need) {
+        /* The rest of a full chunk is left unused */
+        chunk = arena_add_chunk(arena, need);
+        if (chunk == NULL) {
+            return NULL;
+        }
+    }
+
+    header = (struct BlockHeader *)(chunk_data(chunk) + chunk->used);
+    header->arena = arena;
+    header->size = (uint32_t)size;
+    header->magic = BLOCK_MAGIC;
+    chunk->used += need;
+    arena->stats.allocations++;
+    arena->stats.used += need;
+    arena->last = (char *)header + BLOCK_HEADER;
+    return arena->last;
+}
+
+/** @brief Grow or shrink the most recent block where it is */
+static int arena_resize_last(RpmspecArena *arena, void *ptr, size_t size)
+{
+    struct Chunk *chunk = arena->chunks;
+    struct BlockHeader *header = header_of(ptr);
+    size_t old = ALIGN_UP(header->size);
+    size_t offset;
+
+    if (ptr != arena->last || size > BLOCK_SIZE_MAX) {
+        return 0;
+    }
+    offset = (size_t)((char *)ptr - chunk_data(chunk));
+    if (ALIGN_UP(size) > chunk->size - offset) {
+        return 0;
+    }
+    chunk->used = offset + ALIGN_UP(size);
+    arena->stats.used = arena->stats.used - old + ALIGN_UP(size);
+    header->size = (uint32_t)size;
+    return 1;
+}
+
+/* ========================================================================== */
+/* TREE-SITTER ALLOCATOR                                                      */
+/* ========================================================================== */
+
+static void *ts_arena_malloc(size_t size)
+{
+    struct BlockHeader *header;
+
+    /* Only the first allocation writes the shared flag */
+    if (!atomic_load_explicit(&allocated, memory_order_relaxed)) {
+        atomic_store_explicit(&allocated, true, memory_order_relaxed);
+    }
+    if (current_arena != NULL) {
+        return arena_alloc(current_arena, size);
+    }
+    if (size > BLOCK_SIZE_MAX) {
+        return NULL;
+    }
+    header = malloc(BLOCK_HEADER + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->arena = NULL;
+    header->size = (uint32_t)size;
+    header->magic = BLOCK_MAGIC;
+    return (char *)header + BLOCK_HEADER;
+}
+
+static void *ts_arena_calloc(size_t count, size_t size)
+{
+    void *ptr;
+
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    ptr = ts_arena_malloc(count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+static void ts_arena_free(void *ptr)
+{
+    /* Blocks of an arena are released by rpmspec_arena_reset() */
+    if (ptr != NULL && header_of(ptr)->arena == NULL) {
+        free(header_of(ptr));
+    }
+}
+
+static void *ts_arena_realloc(void *ptr, size_t size)
+{
+    struct BlockHeader *header;
+    void *moved;
+
+    if (ptr == NULL) {
+        return ts_arena_malloc(size);
+    }
+    header = header_of(ptr);
+
+    /* A malloc block stays one, so it is freed the right way */
+    if (header->arena == NULL) {
+        if (size > BLOCK_SIZE_MAX) {
+            return NULL;
+        }
+        header = realloc(header, BLOCK_HEADER + size);
+        if (header == NULL) {
+            return NULL;
+        }
+        header->size = (uint32_t)size;
+        return (char *)header + BLOCK_HEADER;
+    }
+
+    if (size <= header->size) {
+        return ptr;
+    }
+    if (header->arena == current_arena &&
+        arena_resize_last(current_arena, ptr, size)) {
+        return ptr;
+    }
+    moved = ts_arena_malloc(size);
+    if (moved != NULL) {
+        memcpy(moved, ptr, header->size < size ? header->size : size);
+    }
+    return moved;
+}
+
+/* ========================================================================== */
+/* PUBLIC API                                                                 */
+/* ========================================================================== */
+
+void rpmspec_arena_install(void)
+{
+    /*
+     * Allocations tree-sitter made with its default allocator can't be
+     * seen here; header_of() catches those when they are freed.
+     */
+    if (atomic_load(&allocated)) {
+        fail("rpmspec_arena_install() called after the first allocation");
+    }
+    ts_set_allocator(
+        ts_arena_malloc, ts_arena_calloc, ts_arena_realloc, ts_arena_free);
+}
+
+RpmspecArena *rpmspec_arena_new(size_t chunk_size)
+{
+    RpmspecArena *arena = calloc(1, sizeof(*arena));
+
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->chunk_size = chunk_size > 0 ? chunk_size : RPMSPEC_ARENA_CHUNK_SIZE;
+    return arena;
+}
+
+static void arena_free_chunks(RpmspecArena *arena)
+{
+    struct Chunk *chunk = arena->chunks;
+
+    while (chunk != NULL) {
+        struct Chunk *next = chunk->next;
+
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->stats.reserved = 0;
+}
+
+void rpmspec_arena_delete(RpmspecArena *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+    if (current_arena == arena) {
+        current_arena = NULL;
+    }
+    arena_free_chunks(arena);
+    free(arena);
+}
+
+void rpmspec_arena_begin(RpmspecArena *arena)
+{
+    current_arena = arena;
+}
+
+void rpmspec_arena_end(RpmspecArena *arena)
+{
+    if (current_arena == arena) {
+        current_arena = NULL;
+    }
+}
+
+void rpmspec_arena_reset(RpmspecArena *arena)
+{
+    if (arena->chunks != NULL && arena->chunks->next != NULL) {
+        /* Next time, one chunk for all */
+        arena->chunk_size = arena->stats.reserved;
+        arena_free_chunks(arena);
+    } else if (arena->chunks != NULL) {
+        arena->chunks->used = 0;
+    }
+    arena->last = NULL;
+    arena->stats.allocations = 0;
+    arena->stats.used = 0;
+}
+
+void rpmspec_arena_stats(const RpmspecArena *arena, RpmspecArenaStats *stats)
+{
+    *stats = arena->stats;
+}
@@ -0,0 +1,382 @@
+/**
+ * @file cache.c
+ * @brief Persistent on-disk cache of results derived from a parse
+ *
+ * Layout: <dir>/<fingerprint>/<xx>/<hash>.<kind>, where <xx> are the first
+ * two hex digits of the 128-bit content hash. Each entry starts with a
+ * header repeating the full key, which is checked on every read.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tree_sitter/rpmspec/cache.h"
+#include "xxhash.h"
+
+#ifndef RPMSPEC_UTIL_FINGERPRINT
+#error RPMSPEC_UTIL_FINGERPRINT must be defined
+#endif
+
+/** @brief Seeds of the two XXH64 hashes making up the 128-bit key */
+#define CACHE_SEED_0 0
+#define CACHE_SEED_1 0x72706d73ULL
+
+/** @brief Room for the ".<pid>.<counter>.tmp" of temporary file names */
+#define TMP_SUFFIX_MAX 48
+
+/** @brief Attempts at a temporary file name before giving up */
+#define TMP_ATTEMPTS 100
+
+/** @brief Magic and format version at the start of every entry */
+#define CACHE_MAGIC "RPMCACH1"
+
+struct CacheHeader {
+    char magic[8];
+    uint64_t hash[2];
+    uint64_t size;
+    uint64_t value_len;
+};
+
+struct RpmspecCache {
+    /** <dir>/<fingerprint> */
+    char *root;
+};
+
+const char *rpmspec_cache_fingerprint(void)
+{
+    return RPMSPEC_UTIL_FINGERPRINT;
+}
+
+/** @brief Create a directory and its parents, like mkdir -p */
+static int mkdir_p(const char *path)
+{
+    char *copy = strdup(path);
+    int rc = 0;
+
+    if (copy == NULL) {
+        return ENOMEM;
+    }
+    for (char *p = copy + 1; rc == 0; p++) {
+        char c = *p;
+
+        if (c != '/' && c != '\0') {
+            continue;
+        }
+        *p = '\0';
+        if (mkdir(copy, 0777) != 0 && errno != EEXIST) {
+            rc = errno;
+        }
+        *p = c;
+        if (c == '\0') {
+            break;
+        }
+    }
+    free(copy);
+    return rc;
+}
+
+RpmspecCache *rpmspec_cache_open(const char *dir)
+{
+    RpmspecCache *cache = calloc(1, sizeof(*cache));
+    size_t len = strlen(dir) + strlen(RPMSPEC_UTIL_FINGERPRINT) + 2;
+    int err;
+
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->root = malloc(len);
+    if (cache->root == NULL) {
+        free(cache);
+        return NULL;
+    }
+    snprintf(cache->root, len, "%s/%s", dir, RPMSPEC_UTIL_FINGERPRINT);
+
+    err = mkdir_p(cache->root);
+    if (err != 0) {
+        rpmspec_cache_close(cache);
+        errno = err;
+        return NULL;
+    }
+    return cache;
+}
+
+void rpmspec_cache_close(RpmspecCache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+    free(cache->root);
+    free(cache);
+}
+
+void rpmspec_cache_key(const char *data, size_t len, RpmspecCacheKey *key)
+{
+    key->hash[0] = xxh64(data, len, CACHE_SEED_0);
+    key->hash[1] = xxh64(data, len, CACHE_SEED_1);
+    key->size = len;
+}
+
+static int valid_kind(const char *kind)
+{
+    if (*kind == '\0') {
+        return 0;
+    }
+    for (; *kind != '\0'; kind++) {
+        char c = *kind;
+
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_' || c == '-')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Build the path of an entry
+ *
+ * @param dir_only Stop after the <xx> directory
+ */
+static char *entry_path(const RpmspecCache *cache,
+                        const RpmspecCacheKey *key,
+                        const char *kind,
+                        int dir_only)
+{
+    size_t len = strlen(cache->root) + strlen(kind) + 64;
+    char *path = malloc(len);
+
+    if (path == NULL) {
+        return NULL;
+    }
+    if (dir_only) {
+        snprintf(path,
+                 len,
+                 "%s/%02x",
+                 cache->root,
+                 (unsigned)(key->hash[0] >> 56));
+    } else {
+        snprintf(path,
+                 len,
+                 "%s/%02x/%016llx%016llx.%s",
+                 cache->root,
+                 (unsigned)(key->hash[0] >> 56),
+                 (unsigned long long)key->hash[0],
+                 (unsigned long long)key->hash[1],
+                 kind);
+    }
+    return path;
+}
+
+static int read_full(int fd, void *buf, size_t len)
+{
+    char *p = buf;
+
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return n == 0 ? ENOENT : errno;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return errno;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int rpmspec_cache_get(RpmspecCache *cache,
+                      const RpmspecCacheKey *key,
+                      const char *kind,
+                      void **value,
+                      size_t *value_len)
+{
+    struct CacheHeader header;
+    struct stat st;
+    char *path;
+    char *buf;
+    int fd;
+    int rc;
+
+    if (!valid_kind(kind)) {
+        return EINVAL;
+    }
+    path = entry_path(cache, key, kind, 0);
+    if (path == NULL) {
+        return ENOMEM;
+    }
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    free(path);
+    if (fd < 0) {
+        return errno;
+    }
+
+    rc = read_full(fd, &header, sizeof(header));
+    if (rc == 0 && fstat(fd, &st) != 0) {
+        rc = errno;
+    }
+    if (rc == 0 &&
+        (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+         header.hash[0] != key->hash[0] || header.hash[1] != key->hash[1] ||
+         header.size != key->size ||
+         (uint64_t)st.st_size != sizeof(header) + header.value_len)) {
+        rc = ENOENT;
+    }
+    if (rc != 0) {
+        close(fd);
+        return rc;
+    }
+
+    /* One extra byte, so text values can be used as C strings */
+    buf = malloc((size_t)header.value_len + 1);
+    if (buf == NULL) {
+        close(fd);
+        return ENOMEM;
+    }
+    rc = read_full(fd, buf, (size_t)header.value_len);
+    close(fd);
+    if (rc != 0) {
+        free(buf);
+        return rc;
+    }
+    buf[header.value_len] = '\0';
+
+    *value = buf;
+    *value_len = (size_t)header.value_len;
+    return 0;
+}
+
+/** @brief Numbers the temporary files of all threads of the process */
+static atomic_uint tmp_counter;
+
+/**
+ * @brief Create a temporary file next to @p path
+ *
+ * Like rpmspec_tree_save(), the file is created with open() and mode 0666
+ * rather than with mkstemp() and 0600, so the current umask decides who
+ * can read the entry. Processes of different users sharing the cache
+ * through a group need that.
+ *
+ * @param tmp Receives the name, strlen(path) + TMP_SUFFIX_MAX bytes
+ * @param fd Receives the descriptor, open for writing
+ *
+ * @return 0 on success, an errno value otherwise
+ */
+static int create_tmp(const char *path, char *tmp, size_t tmp_len, int *fd)
+{
+    for (int attempt = 0; attempt < TMP_ATTEMPTS; attempt++) {
+        snprintf(tmp,
+                 tmp_len,
+                 "%s.%ld.%u.tmp",
+                 path,
+                 (long)getpid(),
+                 atomic_fetch_add(&tmp_counter, 1));
+        *fd = open(tmp, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+        if (*fd >= 0) {
+            return 0;
+        }
+        if (errno != EEXIST) {
+            return errno;
+        }
+    }
+    return EEXIST;
+}
+
+int rpmspec_cache_put(RpmspecCache *cache,
+                      const RpmspecCacheKey *key,
+                      const char *kind,
+                      const void *value,
+                      size_t value_len)
+{
+    struct CacheHeader header;
+    char *path;
+    char *tmp;
+    size_t tmp_len;
+    int fd;
+    int rc;
+
+    if (!valid_kind(kind)) {
+        return EINVAL;
+    }
+
+    path = entry_path(cache, key, kind, 1);
+    if (path == NULL) {
+        return ENOMEM;
+    }
+    rc = mkdir_p(path);
+    free(path);
+    if (rc != 0) {
+        return rc;
+    }
+
+    path = entry_path(cache, key, kind, 0);
+    if (path == NULL) {
+        return ENOMEM;
+    }
+    tmp_len = strlen(path) + TMP_SUFFIX_MAX;
+    tmp = malloc(tmp_len);
+    if (tmp == NULL) {
+        free(path);
+        return ENOMEM;
+    }
+
+    rc = create_tmp(path, tmp, tmp_len, &fd);
+    if (rc != 0) {
+        goto out;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.hash[0] = key->hash[0];
+    header.hash[1] = key->hash[1];
+    header.size = key->size;
+    header.value_len = value_len;
+
+    rc = write_full(fd, &header, sizeof(header));
+    if (rc == 0) {
+        rc = write_full(fd, value, value_len);
+    }
+    if (close(fd) != 0 && rc == 0) {
+        rc = errno;
+    }
+    /* Readers see either the old entry or the complete new one */
+    if (rc == 0 && rename(tmp, path) != 0) {
+        rc = errno;
+    }
+    if (rc != 0) {
+        unlink(tmp);
+    }
+
+out:
+    free(tmp);
+    free(path);
+    return rc;
+}
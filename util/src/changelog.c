@@ -0,0 +1,318 @@
+/**
+ * @file changelog.c
+ * @brief Parse a spec with its %changelog left for later
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spec_lines.h"
+#include "tree_sitter/rpmspec/changelog.h"
+
+/** @brief A %changelog section, split into its keyword line and body */
+struct Changelog {
+    RpmspecSection header;
+    RpmspecSection body;
+};
+
+struct RpmspecLazyTree {
+    const char *data;
+    uint32_t size;
+    TSTree *tree;
+
+    struct Changelog *changelogs;
+    uint32_t changelog_count;
+
+    RpmspecSection *entries;
+    /** The changelog each entry belongs to */
+    uint32_t *entry_changelog;
+    uint32_t entry_count;
+    uint32_t entry_cap;
+};
+
+static RpmspecSection make_range(const char *data,
+                                 uint32_t start,
+                                 uint32_t end,
+                                 TSPoint start_point)
+{
+    RpmspecSection range = {
+        .start_byte = start,
+        .end_byte = end,
+        .start_point = start_point,
+        .end_point = start_point,
+    };
+
+    spec_advance_point(data, start, end, &range.end_point);
+    return range;
+}
+
+static TSRange to_ts_range(const RpmspecSection *range)
+{
+    TSRange r = {
+        .start_point = range->start_point,
+        .end_point = range->end_point,
+        .start_byte = range->start_byte,
+        .end_byte = range->end_byte,
+    };
+
+    return r;
+}
+
+static int add_entry(RpmspecLazyTree *lazy,
+                     uint32_t changelog,
+                     const RpmspecSection *entry)
+{
+    if (lazy->entry_count == lazy->entry_cap) {
+        uint32_t cap = lazy->entry_cap ? lazy->entry_cap * 2 : 64;
+        RpmspecSection *entries =
+            realloc(lazy->entries, cap * sizeof(*lazy->entries));
+        uint32_t *owner;
+
+        if (entries == NULL) {
+            return ENOMEM;
+        }
+        lazy->entries = entries;
+        owner = realloc(lazy->entry_changelog, cap * sizeof(*owner));
+        if (owner == NULL) {
+            return ENOMEM;
+        }
+        lazy->entry_changelog = owner;
+        lazy->entry_cap = cap;
+    }
+    lazy->entries[lazy->entry_count] = *entry;
+    lazy->entry_changelog[lazy->entry_count] = changelog;
+    lazy->entry_count++;
+    return 0;
+}
+
+/**
+ * @brief Index the entries of a body at the lines starting with '*'
+ *
+ * Lines before the first '*' belong to the first entry.
+ */
+static int index_entries(RpmspecLazyTree *lazy, uint32_t changelog)
+{
+    const RpmspecSection *body = &lazy->changelogs[changelog].body;
+    const char *data = lazy->data;
+    uint32_t start = body->start_byte;
+    TSPoint start_point = body->start_point;
+    uint32_t pos = start;
+    int seen = 0;
+    int rc;
+
+    while (pos < body->end_byte) {
+        const char *nl = memchr(data + pos, '\n', body->end_byte - pos);
+        uint32_t next =
+            nl != NULL ? (uint32_t)(nl - data) + 1 : body->end_byte;
+
+        if (data[pos] == '*' && seen++ > 0) {
+            RpmspecSection entry = make_range(data, start, pos, start_point);
+
+            rc = add_entry(lazy, changelog, &entry);
+            if (rc != 0) {
+                return rc;
+            }
+            start = pos;
+            start_point = entry.end_point;
+        }
+        pos = next;
+    }
+    if (start < body->end_byte) {
+        RpmspecSection entry =
+            make_range(data, start, body->end_byte, start_point);
+
+        return add_entry(lazy, changelog, &entry);
+    }
+    return 0;
+}
+
+static int find_changelogs(RpmspecLazyTree *lazy)
+{
+    RpmspecSection *sections;
+    uint32_t count;
+    int rc;
+
+    rc = rpmspec_sections_find(lazy->data, lazy->size, &sections, &count);
+    if (rc != 0) {
+        return rc;
+    }
+    lazy->changelogs =
+        calloc(count > 0 ? count : 1, sizeof(*lazy->changelogs));
+    if (lazy->changelogs == NULL) {
+        free(sections);
+        return ENOMEM;
+    }
+
+    for (uint32_t i = 0; i < count && rc == 0; i++) {
+        const RpmspecSection *section = &sections[i];
+        struct Changelog *changelog;
+        uint32_t body;
+
+        if (!spec_line_is(
+                lazy->data, lazy->size, section->start_byte, "changelog")) {
+            continue;
+        }
+        body = spec_next_line(
+            lazy->data, section->end_byte, section->start_byte);
+        if (body == section->end_byte) {
+            /* No entries, nothing to leave out */
+            continue;
+        }
+
+        changelog = &lazy->changelogs[lazy->changelog_count];
+        changelog->header = make_range(
+            lazy->data, section->start_byte, body, section->start_point);
+        changelog->body = make_range(lazy->data,
+                                     body,
+                                     section->end_byte,
+                                     changelog->header.end_point);
+        rc = index_entries(lazy, lazy->changelog_count);
+        lazy->changelog_count++;
+    }
+
+    free(sections);
+    return rc;
+}
+
+/** @brief Parse the given ranges, then reset the included ranges */
+static TSTree *parse_ranges(TSParser *parser,
+                            const RpmspecLazyTree *lazy,
+                            const TSRange *ranges,
+                            uint32_t count)
+{
+    TSTree *tree = NULL;
+
+    if (ts_parser_set_included_ranges(parser, ranges, count)) {
+        tree = ts_parser_parse_string(parser, NULL, lazy->data, lazy->size);
+    }
+    ts_parser_set_included_ranges(parser, NULL, 0);
+    return tree;
+}
+
+/** @brief Parse everything but the changelog bodies */
+static TSTree *parse_main(TSParser *parser, const RpmspecLazyTree *lazy)
+{
+    TSRange *ranges = calloc(lazy->changelog_count + 1, sizeof(*ranges));
+    TSPoint point = {0, 0};
+    uint32_t start = 0;
+    TSTree *tree;
+
+    if (ranges == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < lazy->changelog_count; i++) {
+        const RpmspecSection *body = &lazy->changelogs[i].body;
+
+        ranges[i].start_byte = start;
+        ranges[i].start_point = point;
+        ranges[i].end_byte = body->start_byte;
+        ranges[i].end_point = body->start_point;
+        start = body->end_byte;
+        point = body->end_point;
+    }
+    /* Up to the end, like the default range */
+    ranges[lazy->changelog_count].start_byte = start;
+    ranges[lazy->changelog_count].start_point = point;
+    ranges[lazy->changelog_count].end_byte = UINT32_MAX;
+    ranges[lazy->changelog_count].end_point.row = UINT32_MAX;
+    ranges[lazy->changelog_count].end_point.column = UINT32_MAX;
+
+    tree = parse_ranges(parser, lazy, ranges, lazy->changelog_count + 1);
+    free(ranges);
+    return tree;
+}
+
+RpmspecLazyTree *
+rpmspec_lazy_parse(TSParser *parser, const char *data, uint32_t size)
+{
+    RpmspecLazyTree *lazy = calloc(1, sizeof(*lazy));
+
+    if (lazy == NULL) {
+        return NULL;
+    }
+    lazy->data = data;
+    lazy->size = size;
+
+    if (find_changelogs(lazy) != 0) {
+        rpmspec_lazy_tree_delete(lazy);
+        return NULL;
+    }
+    if (lazy->changelog_count == 0) {
+        lazy->tree = ts_parser_parse_string(parser, NULL, data, size);
+    } else {
+        lazy->tree = parse_main(parser, lazy);
+    }
+    if (lazy->tree == NULL) {
+        rpmspec_lazy_tree_delete(lazy);
+        return NULL;
+    }
+    return lazy;
+}
+
+void rpmspec_lazy_tree_delete(RpmspecLazyTree *lazy)
+{
+    if (lazy == NULL) {
+        return;
+    }
+    ts_tree_delete(lazy->tree);
+    free(lazy->changelogs);
+    free(lazy->entries);
+    free(lazy->entry_changelog);
+    free(lazy);
+}
+
+const TSTree *rpmspec_lazy_tree_root(const RpmspecLazyTree *lazy)
+{
+    return lazy->tree;
+}
+
+uint32_t rpmspec_lazy_tree_entry_count(const RpmspecLazyTree *lazy)
+{
+    return lazy->entry_count;
+}
+
+const RpmspecSection *rpmspec_lazy_tree_entry(const RpmspecLazyTree *lazy,
+                                              uint32_t index)
+{
+    return index < lazy->entry_count ? &lazy->entries[index] : NULL;
+}
+
+TSTree *rpmspec_lazy_tree_expand(const RpmspecLazyTree *lazy,
+                                 TSParser *parser,
+                                 uint32_t first,
+                                 uint32_t count)
+{
+    uint32_t changelog = UINT32_MAX;
+    uint32_t n = 0;
+    TSRange *ranges;
+    TSTree *tree;
+
+    if (count == 0 || first >= lazy->entry_count ||
+        count > lazy->entry_count - first) {
+        return NULL;
+    }
+    /* At most a header and an entry per entry */
+    ranges = malloc(2 * (size_t)count * sizeof(*ranges));
+    if (ranges == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t i = first; i < first + count; i++) {
+        const RpmspecSection *entry = &lazy->entries[i];
+
+        if (lazy->entry_changelog[i] != changelog) {
+            changelog = lazy->entry_changelog[i];
+            ranges[n++] = to_ts_range(&lazy->changelogs[changelog].header);
+            ranges[n++] = to_ts_range(entry);
+        } else {
+            /* Entries of one body are adjacent */
+            ranges[n - 1].end_byte = entry->end_byte;
+            ranges[n - 1].end_point = entry->end_point;
+        }
+    }
+
+    tree = parse_ranges(parser, lazy, ranges, n);
+    free(ranges);
+    return tree;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file input.c
+ * @brief Zero-copy parser input backed by a memory mapped file
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tree_sitter/rpmspec/input.h"
+
+/** @brief Contents of empty files, which can't be mapped */
+static const char empty[] = "";
+
+struct RpmspecFile {
+    const char *data;
+    uint32_t size;
+    /** Whether data is a mapping, otherwise it is a heap buffer */
+    int mapped;
+};
+
+/** @brief Read a file that can't be mapped into a heap buffer */
+static int read_all(RpmspecFile *file, int fd)
+{
+    char *data = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    ssize_t n;
+
+    for (;;) {
+        if (len == cap) {
+            char *grown;
+
+            cap = cap ? cap * 2 : 65536;
+            grown = realloc(data, cap);
+            if (grown == NULL) {
+                free(data);
+                return ENOMEM;
+            }
+            data = grown;
+        }
+        n = read(fd, data + len, cap - len);
+        if (n < 0) {
+            int err = errno;
+
+            if (err == EINTR) {
+                continue;
+            }
+            free(data);
+            return err;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += (size_t)n;
+        if (len >= UINT32_MAX) {
+            free(data);
+            return EFBIG;
+        }
+    }
+
+    file->data = data;
+    file->size = (uint32_t)len;
+    file->mapped = 0;
+    return 0;
+}
+
+RpmspecFile *rpmspec_file_open_fd(int fd)
+{
+    RpmspecFile *file;
+    struct stat st;
+    void *map;
+    int err;
+
+    if (fstat(fd, &st) != 0) {
+        return NULL;
+    }
+
+    file = calloc(1, sizeof(*file));
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        err = read_all(file, fd);
+        if (err != 0) {
+            free(file);
+            errno = err;
+            return NULL;
+        }
+        return file;
+    }
+
+    if ((uint64_t)st.st_size >= UINT32_MAX) {
+        free(file);
+        errno = EFBIG;
+        return NULL;
+    }
+
+    /* mmap() rejects empty mappings */
+    if (st.st_size == 0) {
+        file->data = empty;
+        return file;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        err = read_all(file, fd);
+        if (err != 0) {
+            free(file);
+            errno = err;
+            return NULL;
+        }
+        return file;
+    }
+#ifdef MADV_SEQUENTIAL
+    (void)madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+    (void)madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+
+    file->data = map;
+    file->size = (uint32_t)st.st_size;
+    file->mapped = 1;
+    return file;
+}
+
+RpmspecFile *rpmspec_file_open(const char *path)
+{
+    RpmspecFile *file;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    int err;
+
+    if (fd < 0) {
+        return NULL;
+    }
+    file = rpmspec_file_open_fd(fd);
+    err = errno;
+    close(fd);
+    errno = err;
+
+    return file;
+}
+
+void rpmspec_file_close(RpmspecFile *file)
+{
+    if (file == NULL) {
+        return;
+    }
+    if (file->mapped) {
+        munmap((void *)(uintptr_t)file->data, file->size);
+    } else if (file->data != empty) {
+        free((void *)(uintptr_t)file->data);
+    }
+    free(file);
+}
+
+const char *rpmspec_file_data(const RpmspecFile *file)
+{
+    return file->data;
+}
+
+uint32_t rpmspec_file_size(const RpmspecFile *file)
+{
+    return file->size;
+}
+
+static const char *file_read(void *payload,
+                             uint32_t byte_index,
+                             TSPoint position,
+                             uint32_t *bytes_read)
+{
+    const RpmspecFile *file = payload;
+
+    (void)position;
+
+    if (byte_index >= file->size) {
+        *bytes_read = 0;
+        return empty;
+    }
+    *bytes_read = file->size - byte_index;
+    return file->data + byte_index;
+}
+
+TSInput rpmspec_file_input(RpmspecFile *file)
+{
+    TSInput input = {
+        .payload = file,
+        .read = file_read,
+        .encoding = TSInputEncodingUTF8,
+    };
+
+    return input;
+}
+
+TSTree *rpmspec_file_parse(TSParser *parser,
+                           const TSTree *old_tree,
+                           RpmspecFile *file)
+{
+    return ts_parser_parse(parser, old_tree, rpmspec_file_input(file));
+}
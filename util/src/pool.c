@@ -0,0 +1,235 @@
+/**
+ * @file pool.c
+ * @brief Thread-safe pool of parsers, query cursors and compiled queries
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+#include "queries.h"
+#include "tree_sitter/rpmspec/pool.h"
+
+/* rpmbash has no C binding header */
+const TSLanguage *tree_sitter_rpmbash(void);
+
+/** @brief Idle objects, taken and returned at the end */
+struct Stack {
+    void **items;
+    uint32_t count;
+    uint32_t cap;
+};
+
+struct RpmspecPool {
+    pthread_mutex_t lock;
+    struct Stack parsers[RPMSPEC_LANGUAGE_COUNT];
+    struct Stack cursors;
+
+    /* Compiling takes long, so don't hold up the parsers meanwhile */
+    pthread_mutex_t query_lock;
+    TSQuery *queries[RPMSPEC_LANGUAGE_COUNT][RPMSPEC_QUERY_COUNT];
+    bool compiled[RPMSPEC_LANGUAGE_COUNT][RPMSPEC_QUERY_COUNT];
+};
+
+static int stack_push(struct Stack *stack, void *item)
+{
+    if (stack->count == stack->cap) {
+        uint32_t cap = stack->cap ? stack->cap * 2 : 8;
+        void **items = realloc(stack->items, cap * sizeof(*items));
+
+        if (items == NULL) {
+            return ENOMEM;
+        }
+        stack->items = items;
+        stack->cap = cap;
+    }
+    stack->items[stack->count++] = item;
+    return 0;
+}
+
+static void *stack_pop(struct Stack *stack)
+{
+    return stack->count > 0 ? stack->items[--stack->count] : NULL;
+}
+
+const TSLanguage *rpmspec_language(RpmspecLanguage language)
+{
+    switch (language) {
+    case RPMSPEC_LANGUAGE_RPMSPEC:
+        return tree_sitter_rpmspec();
+    case RPMSPEC_LANGUAGE_RPMBASH:
+        return tree_sitter_rpmbash();
+    case RPMSPEC_LANGUAGE_COUNT:
+        break;
+    }
+    return NULL;
+}
+
+RpmspecPool *rpmspec_pool_new(void)
+{
+    RpmspecPool *pool = calloc(1, sizeof(*pool));
+
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->query_lock, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void rpmspec_pool_delete(RpmspecPool *pool)
+{
+    void *item;
+
+    if (pool == NULL) {
+        return;
+    }
+    for (int l = 0; l < RPMSPEC_LANGUAGE_COUNT; l++) {
+        while ((item = stack_pop(&pool->parsers[l])) != NULL) {
+            ts_parser_delete(item);
+        }
+        free(pool->parsers[l].items);
+
+        for (int k = 0; k < RPMSPEC_QUERY_COUNT; k++) {
+            if (pool->queries[l][k] != NULL) {
+                ts_query_delete(pool->queries[l][k]);
+            }
+        }
+    }
+    while ((item = stack_pop(&pool->cursors)) != NULL) {
+        ts_query_cursor_delete(item);
+    }
+    free(pool->cursors.items);
+
+    pthread_mutex_destroy(&pool->query_lock);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+TSParser *rpmspec_pool_acquire_parser(RpmspecPool *pool,
+                                      RpmspecLanguage language)
+{
+    const TSLanguage *ts_language = rpmspec_language(language);
+    TSParser *parser;
+
+    if (ts_language == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    parser = stack_pop(&pool->parsers[language]);
+    pthread_mutex_unlock(&pool->lock);
+    if (parser != NULL) {
+        return parser;
+    }
+
+    parser = ts_parser_new();
+    if (parser == NULL) {
+        return NULL;
+    }
+    if (!ts_parser_set_language(parser, ts_language)) {
+        ts_parser_delete(parser);
+        return NULL;
+    }
+    return parser;
+}
+
+void rpmspec_pool_release_parser(RpmspecPool *pool,
+                                 RpmspecLanguage language,
+                                 TSParser *parser)
+{
+    int rc;
+
+    if (parser == NULL) {
+        return;
+    }
+    if (rpmspec_language(language) == NULL) {
+        ts_parser_delete(parser);
+        return;
+    }
+
+    /* Drop a parse left over from a cancelled or failed call */
+    ts_parser_reset(parser);
+    ts_parser_set_included_ranges(parser, NULL, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    rc = stack_push(&pool->parsers[language], parser);
+    pthread_mutex_unlock(&pool->lock);
+    if (rc != 0) {
+        ts_parser_delete(parser);
+    }
+}
+
+const TSQuery *rpmspec_pool_query(RpmspecPool *pool,
+                                  RpmspecLanguage language,
+                                  RpmspecQueryKind kind)
+{
+    const TSLanguage *ts_language = rpmspec_language(language);
+    TSQuery *query;
+
+    if (ts_language == NULL || (int)kind < 0 || kind >= RPMSPEC_QUERY_COUNT) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->query_lock);
+    if (!pool->compiled[language][kind]) {
+        const struct QuerySource *q = &query_sources[language][kind];
+        uint32_t error_offset;
+        TSQueryError error_type;
+
+        pool->queries[language][kind] = ts_query_new(
+            ts_language, q->source, q->length, &error_offset, &error_type);
+        /*
+         * A query that doesn't compile won't compile the next time either,
+         * so only retry after running out of memory.
+         */
+        pool->compiled[language][kind] =
+            pool->queries[language][kind] != NULL ||
+            error_type != TSQueryErrorNone;
+    }
+    query = pool->queries[language][kind];
+    pthread_mutex_unlock(&pool->query_lock);
+
+    return query;
+}
+
+TSQueryCursor *rpmspec_pool_acquire_cursor(RpmspecPool *pool)
+{
+    TSQueryCursor *cursor;
+
+    pthread_mutex_lock(&pool->lock);
+    cursor = stack_pop(&pool->cursors);
+    pthread_mutex_unlock(&pool->lock);
+
+    return cursor != NULL ? cursor : ts_query_cursor_new();
+}
+
+void rpmspec_pool_release_cursor(RpmspecPool *pool, TSQueryCursor *cursor)
+{
+    TSPoint start = {0, 0};
+    TSPoint end = {UINT32_MAX, UINT32_MAX};
+    int rc;
+
+    if (cursor == NULL) {
+        return;
+    }
+    ts_query_cursor_set_byte_range(cursor, 0, UINT32_MAX);
+    ts_query_cursor_set_point_range(cursor, start, end);
+
+    pthread_mutex_lock(&pool->lock);
+    rc = stack_push(&pool->cursors, cursor);
+    pthread_mutex_unlock(&pool->lock);
+    if (rc != 0) {
+        ts_query_cursor_delete(cursor);
+    }
+}
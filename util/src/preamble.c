@@ -0,0 +1,47 @@
+/**
+ * @file preamble.c
+ * @brief Parse only the preamble of a spec, for metadata extraction
+ */
+
+#include <stddef.h>
+
+#include "spec_lines.h"
+#include "tree_sitter/rpmspec/preamble.h"
+
+uint32_t rpmspec_preamble_length(const char *data, uint32_t size)
+{
+    uint32_t pos = 0;
+    uint32_t depth = 0;
+    uint32_t outer_if = 0;
+
+    while (pos < size) {
+        uint16_t flags = spec_line_keyword(data, size, pos);
+
+        if (flags & SPEC_SECTION_KEYWORDS) {
+            return depth > 0 ? outer_if : pos;
+        }
+        if (flags & KW_CONDITIONAL) {
+            if (depth == 0) {
+                outer_if = pos;
+            }
+            depth++;
+        } else if ((flags & KW_ENDIF) && depth > 0) {
+            depth--;
+        }
+        pos = spec_next_line(data, size, pos);
+    }
+    return size;
+}
+
+TSTree *rpmspec_parse_preamble(TSParser *parser,
+                               const char *data,
+                               uint32_t size,
+                               uint32_t *length)
+{
+    uint32_t len = rpmspec_preamble_length(data, size);
+
+    if (length != NULL) {
+        *length = len;
+    }
+    return ts_parser_parse_string(parser, NULL, data, len);
+}
@@ -0,0 +1,22 @@
+/**
+ * @file queries.h
+ * @brief The embedded query files of both grammars
+ */
+
+#ifndef RPMSPEC_UTIL_QUERIES_H
+#define RPMSPEC_UTIL_QUERIES_H
+
+#include <stdint.h>
+
+#include "tree_sitter/rpmspec/pool.h"
+
+struct QuerySource {
+    const char *source;
+    uint32_t length;
+};
+
+/** @brief The sources of queries/<kind>.scm, indexed by language and kind */
+extern const struct QuerySource
+    query_sources[RPMSPEC_LANGUAGE_COUNT][RPMSPEC_QUERY_COUNT];
+
+#endif /* RPMSPEC_UTIL_QUERIES_H */
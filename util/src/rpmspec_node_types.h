@@ -0,0 +1,380 @@
+/* Generated by scripts/gen-node-types.py from rpmspec/src/node-types.json. */
+/* Do not edit, regenerate instead. */
+
+#ifndef RPMSPEC_NODE_TYPES_H
+#define RPMSPEC_NODE_TYPES_H
+
+#include <stdint.h>
+
+/** @brief A node type of node-types.json */
+struct RpmspecNodeType {
+    const char *name;
+    uint8_t named;
+};
+
+#define RPMSPEC_NODE_TYPE_COUNT 327
+#define RPMSPEC_FIELD_COUNT 29
+
+static const struct RpmspecNodeType rpmspec_node_types[] = {
+    {"ERROR", 1},
+    {"_compound_statements", 1},
+    {"_primary_expression", 1},
+    {"expression", 1},
+    {"arch", 1},
+    {"attr", 1},
+    {"autopatch_macro", 1},
+    {"autosetup_macro", 1},
+    {"binary_expression", 1},
+    {"boolean_and_expression", 1},
+    {"boolean_dependency", 1},
+    {"boolean_expression", 1},
+    {"boolean_if_expression", 1},
+    {"boolean_or_expression", 1},
+    {"boolean_with_expression", 1},
+    {"boolean_without_expression", 1},
+    {"brace_expansion", 1},
+    {"build_scriptlet", 1},
+    {"builtin", 1},
+    {"caps_qualifier", 1},
+    {"changelog", 1},
+    {"changelog_entry", 1},
+    {"check_scriptlet", 1},
+    {"clean_scriptlet", 1},
+    {"concatenation", 1},
+    {"conditional_expansion", 1},
+    {"conf_scriptlet", 1},
+    {"config_option", 1},
+    {"config_qualifier", 1},
+    {"defattr", 1},
+    {"defined_operator", 1},
+    {"dependency", 1},
+    {"dependency_qualifier", 1},
+    {"dependency_tag", 1},
+    {"description", 1},
+    {"directory", 1},
+    {"elf_arch", 1},
+    {"elf_dependency", 1},
+    {"elf_symbol_version", 1},
+    {"elif_clause", 1},
+    {"elifarch_clause", 1},
+    {"elifos_clause", 1},
+    {"else_clause", 1},
+    {"expand_content", 1},
+    {"file", 1},
+    {"file_qualifier", 1},
+    {"file_trigger", 1},
+    {"file_trigger_paths", 1},
+    {"file_trigger_priority", 1},
+    {"files", 1},
+    {"files_elif_clause", 1},
+    {"files_elifarch_clause", 1},
+    {"files_elifos_clause", 1},
+    {"files_else_clause", 1},
+    {"generate_buildrequires", 1},
+    {"if_statement", 1},
+    {"ifarch_statement", 1},
+    {"ifos_statement", 1},
+    {"install_scriptlet", 1},
+    {"integer", 1},
+    {"macro_argument", 1},
+    {"macro_definition", 1},
+    {"macro_expansion", 1},
+    {"macro_expression", 1},
+    {"macro_expression_concatenation", 1},
+    {"macro_option", 1},
+    {"macro_parametric_expansion", 1},
+    {"macro_parenthesized_expression", 1},
+    {"macro_patch", 1},
+    {"macro_shell_expansion", 1},
+    {"macro_simple_expansion", 1},
+    {"macro_source", 1},
+    {"macro_undefinition", 1},
+    {"nested_qualified_dependency", 1},
+    {"os", 1},
+    {"package", 1},
+    {"package_tag", 1},
+    {"parametric_options", 1},
+    {"parenthesized_expression", 1},
+    {"patch_legacy_token", 1},
+    {"patch_macro", 1},
+    {"patchlist", 1},
+    {"path", 1},
+    {"path_dependency", 1},
+    {"preamble_tag", 1},
+    {"prep_scriptlet", 1},
+    {"qualified_dependency", 1},
+    {"qualifier", 1},
+    {"quoted_string", 1},
+    {"runtime_scriptlet", 1},
+    {"runtime_scriptlet_interpreter", 1},
+    {"script_block", 1},
+    {"script_content", 1},
+    {"script_interpreter", 1},
+    {"script_line", 1},
+    {"scriptlet_augment_option", 1},
+    {"scriptlet_elif_clause", 1},
+    {"scriptlet_elifarch_clause", 1},
+    {"scriptlet_elifos_clause", 1},
+    {"scriptlet_else_clause", 1},
+    {"setup_macro", 1},
+    {"shell_command", 1},
+    {"sourcelist", 1},
+    {"spec", 1},
+    {"string", 1},
+    {"tag", 1},
+    {"ternary_operator", 1},
+    {"text", 1},
+    {"trigger", 1},
+    {"trigger_condition", 1},
+    {"trigger_subpackage", 1},
+    {"unary_expression", 1},
+    {"url", 1},
+    {"url_with_macro", 1},
+    {"verify", 1},
+    {"version_dependency", 1},
+    {"version_literal", 1},
+    {"with_operator", 1},
+    {"word", 1},
+    {"!", 0},
+    {"!=", 0},
+    {"\"", 0},
+    {"%", 0},
+    {"%%", 0},
+    {"%(", 0},
+    {"%[", 0},
+    {"%artifact", 0},
+    {"%attr", 0},
+    {"%caps", 0},
+    {"%changelog", 0},
+    {"%config", 0},
+    {"%defattr", 0},
+    {"%description", 0},
+    {"%dir", 0},
+    {"%doc", 0},
+    {"%docdir", 0},
+    {"%elif", 0},
+    {"%elifarch", 0},
+    {"%elifos", 0},
+    {"%else", 0},
+    {"%endif", 0},
+    {"%exclude", 0},
+    {"%files", 0},
+    {"%filetriggerin", 0},
+    {"%filetriggerpostun", 0},
+    {"%filetriggerun", 0},
+    {"%ghost", 0},
+    {"%if", 0},
+    {"%ifarch", 0},
+    {"%ifnarch", 0},
+    {"%ifnos", 0},
+    {"%ifos", 0},
+    {"%license", 0},
+    {"%missingok", 0},
+    {"%package", 0},
+    {"%patchlist", 0},
+    {"%post", 0},
+    {"%posttrans", 0},
+    {"%postun", 0},
+    {"%postuntrans", 0},
+    {"%pre", 0},
+    {"%pretrans", 0},
+    {"%preun", 0},
+    {"%preuntrans", 0},
+    {"%readme", 0},
+    {"%sourcelist", 0},
+    {"%transfiletriggerin", 0},
+    {"%transfiletriggerpostun", 0},
+    {"%transfiletriggerun", 0},
+    {"%triggerin", 0},
+    {"%triggerpostun", 0},
+    {"%triggerprein", 0},
+    {"%triggerun", 0},
+    {"%verify", 0},
+    {"%{", 0},
+    {"&&", 0},
+    {"(", 0},
+    {")", 0},
+    {"):", 0},
+    {"*", 0},
+    {"+", 0},
+    {",", 0},
+    {"-", 0},
+    {"--", 0},
+    {"-P", 0},
+    {"-a", 0},
+    {"-f", 0},
+    {"-l", 0},
+    {"-n", 0},
+    {"-p", 0},
+    {"/", 0},
+    {":", 0},
+    {"<", 0},
+    {"<=", 0},
+    {"=", 0},
+    {"==", 0},
+    {">", 0},
+    {">=", 0},
+    {"?", 0},
+    {"E", 0},
+    {"F", 0},
+    {"P", 0},
+    {"R", 0},
+    {"Z", 0},
+    {"\\", 0},
+    {"]", 0},
+    {"and", 0},
+    {"b", 0},
+    {"basename", 0},
+    {"build", 0},
+    {"bzr", 0},
+    {"caps", 0},
+    {"check", 0},
+    {"clean", 0},
+    {"comment", 1},
+    {"conf", 0},
+    {"d", 0},
+    {"define", 0},
+    {"defined", 0},
+    {"dependency_version_string", 1},
+    {"dirname", 0},
+    {"dnl", 0},
+    {"dump", 0},
+    {"echo", 0},
+    {"else", 0},
+    {"error", 0},
+    {"escape_sequence", 1},
+    {"escaped_percent", 1},
+    {"exists", 0},
+    {"expand", 0},
+    {"expand_code", 1},
+    {"expr", 0},
+    {"filedigest", 0},
+    {"float", 1},
+    {"gendiff", 0},
+    {"generate_buildrequires", 0},
+    {"getenv", 0},
+    {"getncpus", 0},
+    {"git", 0},
+    {"git_am", 0},
+    {"global", 0},
+    {"group", 0},
+    {"gsub", 0},
+    {"hg", 0},
+    {"identifier", 1},
+    {"if", 0},
+    {"install", 0},
+    {"interp", 0},
+    {"interpreter_program", 1},
+    {"len", 0},
+    {"line_continuation", 1},
+    {"link", 0},
+    {"load", 0},
+    {"locale", 1},
+    {"lower", 0},
+    {"macro_option_terminator", 1},
+    {"macrobody", 0},
+    {"maj", 0},
+    {"md5", 0},
+    {"meta", 0},
+    {"min", 0},
+    {"missingok", 0},
+    {"mode", 0},
+    {"mtime", 0},
+    {"negated_macro", 1},
+    {"negation_operator", 1},
+    {"noreplace", 0},
+    {"not", 0},
+    {"o", 0},
+    {"or", 0},
+    {"owner", 0},
+    {"p", 0},
+    {"patch", 0},
+    {"post", 0},
+    {"posttrans", 0},
+    {"postun", 0},
+    {"pre", 0},
+    {"prep", 0},
+    {"pretrans", 0},
+    {"preun", 0},
+    {"q", 0},
+    {"quilt", 0},
+    {"quote", 0},
+    {"rdev", 0},
+    {"rep", 0},
+    {"reverse", 0},
+    {"rpmversion", 0},
+    {"script_code", 1},
+    {"section_build", 1},
+    {"section_check", 1},
+    {"section_clean", 1},
+    {"section_conf", 1},
+    {"section_generate_buildrequires", 1},
+    {"section_install", 1},
+    {"section_prep", 1},
+    {"shescape", 0},
+    {"shrink", 0},
+    {"simple_macro", 1},
+    {"size", 0},
+    {"soname", 1},
+    {"special_macro", 1},
+    {"special_variable_name", 1},
+    {"string_content", 1},
+    {"sub", 0},
+    {"suffix", 0},
+    {"symlink", 0},
+    {"text_content", 1},
+    {"trace", 0},
+    {"u2p", 0},
+    {"uncompress", 0},
+    {"undefine", 0},
+    {"undefined", 0},
+    {"unless", 0},
+    {"upper", 0},
+    {"url2path", 0},
+    {"user", 0},
+    {"v", 0},
+    {"verbose", 0},
+    {"verify", 0},
+    {"version", 1},
+    {"warn", 0},
+    {"with", 0},
+    {"without", 0},
+    {"z", 0},
+    {"{", 0},
+    {"||", 0},
+    {"}", 0},
+};
+
+static const char *const rpmspec_field_names[] = {
+    "",
+    "alternative",
+    "arch",
+    "argument",
+    "body",
+    "condition",
+    "consequence",
+    "content",
+    "directory",
+    "interpreter",
+    "left",
+    "locale",
+    "name",
+    "number",
+    "operator",
+    "operators",
+    "option",
+    "paths",
+    "priority",
+    "program",
+    "qualifier",
+    "right",
+    "soname",
+    "subpackage",
+    "symbol_version",
+    "type",
+    "value",
+    "vcs",
+    "version",
+};
+
+#endif /* RPMSPEC_NODE_TYPES_H */
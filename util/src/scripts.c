@@ -0,0 +1,325 @@
+/**
+ * @file scripts.c
+ * @brief Parse all shell scriptlets of a spec with a single rpmbash parse
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tree_sitter/rpmspec/scripts.h"
+
+struct Block {
+    TSNode node;
+    /** First top-level rpmbash node and the number of them */
+    uint32_t first;
+    uint32_t count;
+};
+
+struct RpmspecScripts {
+    TSTree *tree;
+    struct Block *blocks;
+    uint32_t count;
+    uint32_t cap;
+    TSNode *children;
+};
+
+/**
+ * @brief Scriptlets whose script_block is always rpmbash
+ *
+ * See queries/injections.scm.
+ */
+static const char *const SHELL_SCRIPTLETS[] = {
+    "prep_scriptlet",
+    "build_scriptlet",
+    "install_scriptlet",
+    "check_scriptlet",
+    "clean_scriptlet",
+    "conf_scriptlet",
+    "generate_buildrequires",
+    "runtime_scriptlet",
+};
+
+static int is_one_of(const char *type, const char *const *types, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(type, types[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** @brief Whether the text of a node contains @p needle */
+static int node_contains(TSNode node, const char *data, const char *needle)
+{
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t len = ts_node_end_byte(node) - start;
+    size_t n = strlen(needle);
+
+    for (uint32_t i = 0; i + n <= len; i++) {
+        if (memcmp(data + start + i, needle, n) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** @brief Whether the text of a node is @p text */
+static int node_is(TSNode node, const char *data, const char *text)
+{
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t len = ts_node_end_byte(node) - start;
+
+    return len == strlen(text) && memcmp(data + start, text, len) == 0;
+}
+
+/** @brief Whether the text of a node ends with @p suffix */
+static int node_ends_with(TSNode node, const char *data, const char *suffix)
+{
+    uint32_t start = ts_node_start_byte(node);
+    uint32_t len = ts_node_end_byte(node) - start;
+    size_t n = strlen(suffix);
+
+    return len >= n && memcmp(data + start + len - n, suffix, n) == 0;
+}
+
+/**
+ * @brief Whether injections.scm hands a script_block to rpmbash
+ *
+ * Scriptlets with -p only use rpmbash for a shell interpreter. Triggers
+ * use it unless the interpreter is <lua> or Perl, file triggers unless it
+ * is <lua>: the injections have no Perl override for them.
+ */
+static int is_shell_block(TSNode block, const char *data)
+{
+    TSNode parent = ts_node_parent(block);
+    const char *type = ts_node_type(parent);
+    TSNode interpreter;
+    TSNode program;
+
+    if (is_one_of(type,
+                  SHELL_SCRIPTLETS,
+                  sizeof(SHELL_SCRIPTLETS) / sizeof(SHELL_SCRIPTLETS[0]))) {
+        return 1;
+    }
+
+    interpreter = ts_node_child_by_field_name(parent, "interpreter", 11);
+    program = ts_node_is_null(interpreter)
+                  ? interpreter
+                  : ts_node_child_by_field_name(interpreter, "program", 7);
+
+    if (strcmp(type, "runtime_scriptlet_interpreter") == 0) {
+        return !ts_node_is_null(program) &&
+               (node_contains(program, data, "bash") ||
+                node_ends_with(program, data, "/sh"));
+    }
+    if (strcmp(type, "trigger") == 0) {
+        return ts_node_is_null(program) ||
+               !(node_is(program, data, "<lua>") ||
+                 node_contains(program, data, "perl"));
+    }
+    if (strcmp(type, "file_trigger") == 0) {
+        return ts_node_is_null(program) || !node_is(program, data, "<lua>");
+    }
+    return 0;
+}
+
+static int add_block(RpmspecScripts *scripts, TSNode node)
+{
+    if (scripts->count == scripts->cap) {
+        uint32_t cap = scripts->cap ? scripts->cap * 2 : 16;
+        struct Block *grown =
+            realloc(scripts->blocks, cap * sizeof(*scripts->blocks));
+
+        if (grown == NULL) {
+            return ENOMEM;
+        }
+        scripts->blocks = grown;
+        scripts->cap = cap;
+    }
+    memset(&scripts->blocks[scripts->count], 0, sizeof(struct Block));
+    scripts->blocks[scripts->count++].node = node;
+    return 0;
+}
+
+/** @brief Collect the shell script blocks in source order */
+static int collect_blocks(RpmspecScripts *scripts,
+                          const TSTree *spec,
+                          const char *data)
+{
+    const TSLanguage *language = ts_tree_language(spec);
+    TSSymbol script_block = ts_language_symbol_for_name(
+        language, "script_block", sizeof("script_block") - 1, true);
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(spec));
+    int rc = 0;
+
+    for (;;) {
+        TSNode node = ts_tree_cursor_current_node(&cursor);
+
+        if (ts_node_symbol(node) == script_block) {
+            if (is_shell_block(node, data)) {
+                rc = add_block(scripts, node);
+                if (rc != 0) {
+                    break;
+                }
+            }
+        } else if (ts_tree_cursor_goto_first_child(&cursor)) {
+            /* Blocks don't nest, so only look for them outside of one */
+            continue;
+        }
+
+        while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+            if (!ts_tree_cursor_goto_parent(&cursor)) {
+                ts_tree_cursor_delete(&cursor);
+                return 0;
+            }
+        }
+    }
+
+    ts_tree_cursor_delete(&cursor);
+    return rc;
+}
+
+static TSTree *parse_blocks(const RpmspecScripts *scripts,
+                            TSParser *parser,
+                            const char *data,
+                            uint32_t size)
+{
+    TSRange *ranges = malloc(scripts->count * sizeof(*ranges));
+    TSTree *tree = NULL;
+
+    if (ranges == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < scripts->count; i++) {
+        TSNode node = scripts->blocks[i].node;
+
+        ranges[i].start_byte = ts_node_start_byte(node);
+        ranges[i].end_byte = ts_node_end_byte(node);
+        ranges[i].start_point = ts_node_start_point(node);
+        ranges[i].end_point = ts_node_end_point(node);
+    }
+    if (ts_parser_set_included_ranges(parser, ranges, scripts->count)) {
+        tree = ts_parser_parse_string(parser, NULL, data, size);
+    }
+    ts_parser_set_included_ranges(parser, NULL, 0);
+    free(ranges);
+    return tree;
+}
+
+/** @brief Assign the top-level rpmbash nodes to the blocks they start in */
+static int map_children(RpmspecScripts *scripts)
+{
+    TSNode root = ts_tree_root_node(scripts->tree);
+    TSTreeCursor cursor = ts_tree_cursor_new(root);
+    uint32_t count = ts_node_child_count(root);
+    uint32_t block = 0;
+    uint32_t n = 0;
+
+    scripts->children = malloc((count > 0 ? count : 1) * sizeof(TSNode));
+    if (scripts->children == NULL) {
+        ts_tree_cursor_delete(&cursor);
+        return ENOMEM;
+    }
+    if (!ts_tree_cursor_goto_first_child(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return 0;
+    }
+
+    /* Both are in source order, so one merge pass will do */
+    do {
+        TSNode child = ts_tree_cursor_current_node(&cursor);
+        uint32_t start = ts_node_start_byte(child);
+
+        while (block + 1 < scripts->count &&
+               start >= ts_node_start_byte(scripts->blocks[block + 1].node)) {
+            block++;
+        }
+        if (scripts->blocks[block].count == 0) {
+            scripts->blocks[block].first = n;
+        }
+        scripts->blocks[block].count++;
+        scripts->children[n++] = child;
+    } while (n < count && ts_tree_cursor_goto_next_sibling(&cursor));
+
+    ts_tree_cursor_delete(&cursor);
+    return 0;
+}
+
+RpmspecScripts *rpmspec_scripts_parse(TSParser *parser,
+                                      const TSTree *spec,
+                                      const char *data,
+                                      uint32_t size)
+{
+    RpmspecScripts *scripts = calloc(1, sizeof(*scripts));
+
+    if (scripts == NULL) {
+        return NULL;
+    }
+    if (collect_blocks(scripts, spec, data) != 0) {
+        goto fail;
+    }
+    if (scripts->count == 0) {
+        return scripts;
+    }
+
+    scripts->tree = parse_blocks(scripts, parser, data, size);
+    if (scripts->tree == NULL || map_children(scripts) != 0) {
+        goto fail;
+    }
+    return scripts;
+
+fail:
+    rpmspec_scripts_delete(scripts);
+    return NULL;
+}
+
+void rpmspec_scripts_delete(RpmspecScripts *scripts)
+{
+    if (scripts == NULL) {
+        return;
+    }
+    ts_tree_delete(scripts->tree);
+    free(scripts->blocks);
+    free(scripts->children);
+    free(scripts);
+}
+
+const TSTree *rpmspec_scripts_tree(const RpmspecScripts *scripts)
+{
+    return scripts->tree;
+}
+
+uint32_t rpmspec_scripts_count(const RpmspecScripts *scripts)
+{
+    return scripts->count;
+}
+
+TSNode rpmspec_scripts_block(const RpmspecScripts *scripts, uint32_t index)
+{
+    if (index >= scripts->count) {
+        TSNode null_node = {{0, 0, 0, 0}, NULL, NULL};
+
+        return null_node;
+    }
+    return scripts->blocks[index].node;
+}
+
+uint32_t rpmspec_scripts_child_count(const RpmspecScripts *scripts,
+                                     uint32_t index)
+{
+    return index < scripts->count ? scripts->blocks[index].count : 0;
+}
+
+TSNode rpmspec_scripts_child(const RpmspecScripts *scripts,
+                             uint32_t index,
+                             uint32_t child)
+{
+    if (index >= scripts->count || child >= scripts->blocks[index].count) {
+        TSNode null_node = {{0, 0, 0, 0}, NULL, NULL};
+
+        return null_node;
+    }
+    return scripts->children[scripts->blocks[index].first + child];
+}
@@ -0,0 +1,478 @@
+/**
+ * @file sections.c
+ * @brief Section index of a spec, and parallel parsing of its sections
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+#include "spec_lines.h"
+#include "tree_sitter/rpmspec/sections.h"
+
+/* ========================================================================== */
+/* SECTION INDEX                                                              */
+/* ========================================================================== */
+
+/** @brief The kind of section the parser is in, as seen by the scanner */
+enum Context {
+    CONTEXT_TOP,
+    CONTEXT_SUBSECTION,
+    CONTEXT_SCRIPTLET,
+    CONTEXT_FILES,
+};
+
+static enum Context section_context(uint16_t flags)
+{
+    if (flags & KW_FILES) {
+        return CONTEXT_FILES;
+    }
+    if (flags & KW_SCRIPTLET) {
+        return CONTEXT_SCRIPTLET;
+    }
+    return CONTEXT_SUBSECTION;
+}
+
+/**
+ * @brief Section keywords in the body of a conditional
+ *
+ * Like conditional_body_classify() of the scanner, up to the matching
+ * %endif or the end of the spec.
+ *
+ * @param pos Start of the line of the conditional
+ */
+static uint16_t conditional_body(const char *data, uint32_t size, uint32_t pos)
+{
+    uint32_t depth = 1;
+    uint16_t found = 0;
+
+    for (pos = spec_next_line(data, size, pos); pos < size;
+         pos = spec_next_line(data, size, pos)) {
+        uint16_t flags = spec_line_keyword(data, size, pos);
+
+        if (flags & KW_ENDIF) {
+            if (--depth == 0) {
+                break;
+            }
+        } else if (flags & KW_CONDITIONAL) {
+            depth++;
+        } else {
+            found |= flags & SPEC_SECTION_KEYWORDS;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Whether an outermost conditional starts a top-level section
+ *
+ * Mirrors select_conditional_token_type() of the scanner: in %files only a
+ * scriptlet in the body makes it top-level, elsewhere any section does.
+ */
+static int starts_section(enum Context context, uint16_t body)
+{
+    if (context == CONTEXT_FILES) {
+        return (body & KW_SCRIPTLET) != 0;
+    }
+    return (body & SPEC_SECTION_KEYWORDS) != 0;
+}
+
+/** @brief Growable array of section start offsets */
+struct Starts {
+    uint32_t *offset;
+    uint32_t count;
+    uint32_t cap;
+};
+
+static int starts_add(struct Starts *starts, uint32_t offset)
+{
+    if (starts->count == starts->cap) {
+        uint32_t cap = starts->cap ? starts->cap * 2 : 16;
+        uint32_t *grown =
+            realloc(starts->offset, cap * sizeof(*starts->offset));
+
+        if (grown == NULL) {
+            return ENOMEM;
+        }
+        starts->offset = grown;
+        starts->cap = cap;
+    }
+    starts->offset[starts->count++] = offset;
+    return 0;
+}
+
+static int find_starts(const char *data, uint32_t size, struct Starts *starts)
+{
+    enum Context context = CONTEXT_TOP;
+    uint32_t depth = 0;
+    uint32_t pos = 0;
+    int rc = 0;
+
+    /* The preamble */
+    if (size > 0) {
+        rc = starts_add(starts, 0);
+    }
+    while (rc == 0 && pos < size) {
+        uint16_t flags = spec_line_keyword(data, size, pos);
+
+        if (flags & SPEC_SECTION_KEYWORDS) {
+            if (depth == 0 && pos > 0) {
+                rc = starts_add(starts, pos);
+            }
+            context = section_context(flags);
+        } else if (flags & KW_CONDITIONAL) {
+            if (depth == 0 && pos > 0 &&
+                starts_section(context, conditional_body(data, size, pos))) {
+                rc = starts_add(starts, pos);
+            }
+            depth++;
+        } else if ((flags & KW_ENDIF) && depth > 0) {
+            depth--;
+        }
+        pos = spec_next_line(data, size, pos);
+    }
+    return rc;
+}
+
+int rpmspec_sections_find(const char *data,
+                          uint32_t size,
+                          RpmspecSection **sections,
+                          uint32_t *count)
+{
+    struct Starts starts = {0};
+    RpmspecSection *result;
+    TSPoint point = {0, 0};
+    int rc;
+
+    rc = find_starts(data, size, &starts);
+    if (rc != 0) {
+        free(starts.offset);
+        return rc;
+    }
+
+    result = calloc(starts.count > 0 ? starts.count : 1, sizeof(*result));
+    if (result == NULL) {
+        free(starts.offset);
+        return ENOMEM;
+    }
+    for (uint32_t i = 0; i < starts.count; i++) {
+        RpmspecSection *section = &result[i];
+
+        section->start_byte = starts.offset[i];
+        section->end_byte =
+            i + 1 < starts.count ? starts.offset[i + 1] : size;
+        section->start_point = point;
+        spec_advance_point(
+            data, section->start_byte, section->end_byte, &point);
+        section->end_point = point;
+    }
+    free(starts.offset);
+
+    *sections = result;
+    *count = starts.count;
+    return 0;
+}
+
+/* ========================================================================== */
+/* PARALLEL PARSE                                                             */
+/* ========================================================================== */
+
+struct RpmspecSplitTree {
+    uint32_t count;
+    RpmspecSection *ranges;
+    TSTree **trees;
+    uint32_t child_count;
+    TSNode *children;
+};
+
+/** @brief The pieces still to parse, shared by the threads */
+struct Job {
+    const char *data;
+    uint32_t size;
+    RpmspecSplitTree *tree;
+    /** Piece indices, largest first */
+    uint32_t *order;
+    uint32_t next;
+    int failed;
+    pthread_mutex_t lock;
+};
+
+static uint32_t range_size(const RpmspecSection *range)
+{
+    return range->end_byte - range->start_byte;
+}
+
+/** @brief Merge consecutive sections into pieces of @p min_piece bytes */
+static uint32_t
+merge_small(RpmspecSection *ranges, uint32_t count, uint32_t min_piece)
+{
+    uint32_t merged = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (merged > 0 && range_size(&ranges[merged - 1]) < min_piece) {
+            ranges[merged - 1].end_byte = ranges[i].end_byte;
+            ranges[merged - 1].end_point = ranges[i].end_point;
+        } else {
+            ranges[merged++] = ranges[i];
+        }
+    }
+    return merged;
+}
+
+static TSTree *parse_range(TSParser *parser,
+                           const char *data,
+                           uint32_t size,
+                           const RpmspecSection *section)
+{
+    TSRange range = {
+        .start_point = section->start_point,
+        .end_point = section->end_point,
+        .start_byte = section->start_byte,
+        .end_byte = section->end_byte,
+    };
+
+    if (!ts_parser_set_included_ranges(parser, &range, 1)) {
+        return NULL;
+    }
+    return ts_parser_parse_string(parser, NULL, data, size);
+}
+
+static void *parse_worker(void *arg)
+{
+    struct Job *job = arg;
+    TSParser *parser = ts_parser_new();
+    int failed = !ts_parser_set_language(parser, tree_sitter_rpmspec());
+
+    while (!failed) {
+        uint32_t index = UINT32_MAX;
+
+        pthread_mutex_lock(&job->lock);
+        if (job->next < job->tree->count && !job->failed) {
+            index = job->order[job->next++];
+        }
+        pthread_mutex_unlock(&job->lock);
+        if (index == UINT32_MAX) {
+            break;
+        }
+
+        job->tree->trees[index] = parse_range(
+            parser, job->data, job->size, &job->tree->ranges[index]);
+        failed = job->tree->trees[index] == NULL;
+    }
+    if (failed) {
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    ts_parser_delete(parser);
+    return NULL;
+}
+
+/** @brief Parse the pieces on up to @p threads threads, this one included */
+static int parse_pieces(RpmspecSplitTree *tree,
+                        const char *data,
+                        uint32_t size,
+                        unsigned threads)
+{
+    struct Job job = {
+        .data = data,
+        .size = size,
+        .tree = tree,
+    };
+    pthread_t *extra;
+    unsigned started = 0;
+
+    job.order = malloc(tree->count * sizeof(*job.order));
+    extra = calloc(threads, sizeof(*extra));
+    if (job.order == NULL || extra == NULL) {
+        free(job.order);
+        free(extra);
+        return ENOMEM;
+    }
+    /* Largest first, so a huge section doesn't start last. Merging keeps
+     * the number of pieces small, an insertion sort will do. */
+    for (uint32_t i = 0; i < tree->count; i++) {
+        uint32_t j = i;
+
+        while (j > 0 && range_size(&tree->ranges[job.order[j - 1]]) <
+                            range_size(&tree->ranges[i])) {
+            job.order[j] = job.order[j - 1];
+            j--;
+        }
+        job.order[j] = i;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+
+    for (unsigned i = 1; i < threads; i++) {
+        if (pthread_create(&extra[started], NULL, parse_worker, &job) != 0) {
+            break;
+        }
+        started++;
+    }
+    parse_worker(&job);
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(extra[i], NULL);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    free(job.order);
+    free(extra);
+    return job.failed ? EIO : 0;
+}
+
+static void free_trees(RpmspecSplitTree *tree)
+{
+    for (uint32_t i = 0; i < tree->count; i++) {
+        ts_tree_delete(tree->trees[i]);
+    }
+    memset(tree->trees, 0, tree->count * sizeof(*tree->trees));
+}
+
+/** @brief Collect the children of all roots */
+static int collect_children(RpmspecSplitTree *tree)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < tree->count; i++) {
+        count += ts_node_child_count(ts_tree_root_node(tree->trees[i]));
+    }
+    tree->children = malloc((count > 0 ? count : 1) * sizeof(TSNode));
+    if (tree->children == NULL) {
+        return ENOMEM;
+    }
+
+    for (uint32_t i = 0; i < tree->count; i++) {
+        TSTreeCursor cursor =
+            ts_tree_cursor_new(ts_tree_root_node(tree->trees[i]));
+
+        if (ts_tree_cursor_goto_first_child(&cursor)) {
+            do {
+                tree->children[tree->child_count++] =
+                    ts_tree_cursor_current_node(&cursor);
+            } while (ts_tree_cursor_goto_next_sibling(&cursor));
+        }
+        ts_tree_cursor_delete(&cursor);
+    }
+    return 0;
+}
+
+RpmspecSplitTree *rpmspec_split_parse(const char *data,
+                                      uint32_t size,
+                                      unsigned threads,
+                                      uint32_t min_piece)
+{
+    RpmspecSplitTree *tree = calloc(1, sizeof(*tree));
+    int rc;
+
+    if (tree == NULL) {
+        return NULL;
+    }
+    rc = rpmspec_sections_find(data, size, &tree->ranges, &tree->count);
+    if (rc != 0) {
+        goto fail;
+    }
+    tree->count = merge_small(tree->ranges, tree->count, min_piece);
+    if (tree->count == 0) {
+        /* Empty spec, parsed like any other to get its root */
+        tree->ranges[0].start_byte = 0;
+        tree->ranges[0].end_byte = 0;
+        tree->count = 1;
+    }
+    tree->trees = calloc(tree->count, sizeof(*tree->trees));
+    if (tree->trees == NULL) {
+        goto fail;
+    }
+
+    if (threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = ncpu > 0 ? (unsigned)ncpu : 1;
+    }
+    if (threads > tree->count) {
+        threads = tree->count;
+    }
+
+    rc = parse_pieces(tree, data, size, threads);
+    if (rc == 0 && tree->count > 1 && rpmspec_split_tree_has_error(tree)) {
+        /* Report errors exactly like a full parse would */
+        free_trees(tree);
+        tree->ranges[0].end_byte = tree->ranges[tree->count - 1].end_byte;
+        tree->ranges[0].end_point = tree->ranges[tree->count - 1].end_point;
+        tree->count = 1;
+        rc = parse_pieces(tree, data, size, 1);
+    }
+    if (rc == 0) {
+        rc = collect_children(tree);
+    }
+    if (rc != 0) {
+        goto fail;
+    }
+    return tree;
+
+fail:
+    rpmspec_split_tree_delete(tree);
+    return NULL;
+}
+
+void rpmspec_split_tree_delete(RpmspecSplitTree *tree)
+{
+    if (tree == NULL) {
+        return;
+    }
+    if (tree->trees != NULL) {
+        free_trees(tree);
+    }
+    free(tree->trees);
+    free(tree->ranges);
+    free(tree->children);
+    free(tree);
+}
+
+uint32_t rpmspec_split_tree_count(const RpmspecSplitTree *tree)
+{
+    return tree->count;
+}
+
+const TSTree *rpmspec_split_tree_get(const RpmspecSplitTree *tree,
+                                     uint32_t index)
+{
+    return index < tree->count ? tree->trees[index] : NULL;
+}
+
+const RpmspecSection *
+rpmspec_split_tree_range(const RpmspecSplitTree *tree, uint32_t index)
+{
+    return index < tree->count ? &tree->ranges[index] : NULL;
+}
+
+uint32_t rpmspec_split_tree_child_count(const RpmspecSplitTree *tree)
+{
+    return tree->child_count;
+}
+
+TSNode rpmspec_split_tree_child(const RpmspecSplitTree *tree, uint32_t index)
+{
+    if (index >= tree->child_count) {
+        TSNode null_node = {{0, 0, 0, 0}, NULL, NULL};
+
+        return null_node;
+    }
+    return tree->children[index];
+}
+
+bool rpmspec_split_tree_has_error(const RpmspecSplitTree *tree)
+{
+    for (uint32_t i = 0; i < tree->count; i++) {
+        if (ts_node_has_error(ts_tree_root_node(tree->trees[i]))) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file spec_lines.h
+ * @brief Line-start keyword scanning shared by the spec pre-passes
+ *
+ * The preamble and section finders only look at keywords at the start of a
+ * line, classified with the keyword table of the rpmspec scanner, so they
+ * can't disagree with the scanner about what a section is.
+ */
+
+#ifndef RPMSPEC_UTIL_SPEC_LINES_H
+#define RPMSPEC_UTIL_SPEC_LINES_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <tree_sitter/api.h>
+
+#include "scanner_keywords.h"
+
+/** @brief Keywords starting a section */
+#define SPEC_SECTION_KEYWORDS (KW_SUBSECTION | KW_SCRIPTLET | KW_FILES)
+
+static inline int spec_is_identifier_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+/**
+ * @brief Offset after the logical line starting at @p pos
+ *
+ * A backslash at the end of a line continues it, as in a multi-line
+ * %define, so keywords on the continuation lines are skipped.
+ */
+static inline uint32_t
+spec_next_line(const char *data, uint32_t size, uint32_t pos)
+{
+    for (;;) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        uint32_t end;
+
+        if (nl == NULL) {
+            return size;
+        }
+        end = (uint32_t)(nl - data);
+        if (end > pos && data[end - 1] == '\r') {
+            end--;
+        }
+        if (end == pos || data[end - 1] != '\\') {
+            return (uint32_t)(nl - data) + 1;
+        }
+        pos = (uint32_t)(nl - data) + 1;
+    }
+}
+
+/** @brief KW_* flags of the %keyword a line starts with, 0 if none */
+static inline uint16_t
+spec_line_keyword(const char *data, uint32_t size, uint32_t pos)
+{
+    uint32_t len = 0;
+
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\t')) {
+        pos++;
+    }
+    if (pos == size || data[pos] != '%') {
+        return 0;
+    }
+    pos++;
+    while (pos + len < size && len <= KW_MAX_LEN &&
+           spec_is_identifier_char(data[pos + len])) {
+        len++;
+    }
+    if (len == 0 || len > KW_MAX_LEN) {
+        return 0;
+    }
+    return keyword_lookup(data + pos, len).flags;
+}
+
+/** @brief Whether a line starts with %@p keyword */
+static inline int spec_line_is(const char *data,
+                               uint32_t size,
+                               uint32_t pos,
+                               const char *keyword)
+{
+    size_t len = strlen(keyword);
+
+    while (pos < size && (data[pos] == ' ' || data[pos] == '\t')) {
+        pos++;
+    }
+    if (size - pos < len + 1 || data[pos] != '%' ||
+        memcmp(data + pos + 1, keyword, len) != 0) {
+        return 0;
+    }
+    pos += 1 + (uint32_t)len;
+    return pos == size || !spec_is_identifier_char(data[pos]);
+}
+
+/** @brief Advance @p point over data[from, to) */
+static inline void
+spec_advance_point(const char *data, uint32_t from, uint32_t to, TSPoint *point)
+{
+    const char *p = data + from;
+    const char *end = data + to;
+    const char *nl;
+
+    while ((nl = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        point->row++;
+        point->column = 0;
+        p = nl + 1;
+    }
+    point->column += (uint32_t)(end - p);
+}
+
+#endif /* RPMSPEC_UTIL_SPEC_LINES_H */
@@ -0,0 +1,877 @@
+/**
+ * @file treefile.c
+ * @brief Compact binary format of parse trees, readable without allocation
+ *
+ * Layout: a TreeHeader, followed by the sections listed in enum Section,
+ * each starting at an 8-byte aligned offset recorded in the header. The
+ * strings section starts with an empty string, which names all symbols and
+ * fields of the table which don't occur in the tree.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tree_sitter/tree-sitter-rpmspec.h>
+
+#include "rpmspec_node_types.h"
+#include "tree_sitter/rpmspec/treefile.h"
+
+/** @brief Magic at the start of every serialized tree */
+#define TREE_MAGIC "RPMTREE"
+
+/** @brief Reads back as another value with the other byte order */
+#define TREE_BYTE_ORDER 0x01020304U
+
+/** @brief Room for the ".<pid>.<counter>.tmp" of temporary file names */
+#define TMP_SUFFIX_MAX 48
+
+/** @brief Attempts at a temporary file name before giving up */
+#define TMP_ATTEMPTS 100
+
+/** @brief Marks symbols and fields not mapped yet */
+#define UNMAPPED UINT16_MAX
+
+/* ========================================================================== */
+/* Format                                                                     */
+/* ========================================================================== */
+
+enum Section {
+    /* Per node */
+    SECTION_SYMBOL,
+    SECTION_FIELD,
+    SECTION_FLAGS,
+    SECTION_START_BYTE,
+    SECTION_END_BYTE,
+    SECTION_PARENT,
+    SECTION_CHILD_COUNT,
+    SECTION_DESCENDANT_COUNT,
+    /* Per symbol */
+    SECTION_SYMBOL_NAMED,
+    SECTION_SYMBOL_NAME,
+    /* Per field */
+    SECTION_FIELD_NAME,
+    /* NUL terminated names, up to the end */
+    SECTION_STRINGS,
+    SECTION_COUNT,
+};
+
+struct TreeHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_count;
+    uint32_t symbol_count;
+    uint32_t field_count;
+    uint32_t source_size;
+    uint64_t offset[SECTION_COUNT];
+    uint64_t size;
+};
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+/** @brief Size of a section, except SECTION_STRINGS */
+static uint64_t section_size(enum Section section,
+                             uint64_t node_count,
+                             uint64_t symbol_count,
+                             uint64_t field_count)
+{
+    switch (section) {
+    case SECTION_SYMBOL:
+    case SECTION_FIELD:
+        return node_count * sizeof(uint16_t);
+    case SECTION_FLAGS:
+        return node_count;
+    case SECTION_START_BYTE:
+    case SECTION_END_BYTE:
+    case SECTION_PARENT:
+    case SECTION_CHILD_COUNT:
+    case SECTION_DESCENDANT_COUNT:
+        return node_count * sizeof(uint32_t);
+    case SECTION_SYMBOL_NAMED:
+        return symbol_count;
+    case SECTION_SYMBOL_NAME:
+        return symbol_count * sizeof(uint32_t);
+    case SECTION_FIELD_NAME:
+        return field_count * sizeof(uint32_t);
+    case SECTION_STRINGS:
+    case SECTION_COUNT:
+        break;
+    }
+    return 0;
+}
+
+/* ========================================================================== */
+/* Stable numbering of the rpmspec grammar                                    */
+/* ========================================================================== */
+
+/*
+ * TSSymbol and TSFieldId of tree_sitter_rpmspec() to the indices of
+ * rpmspec_node_types[] and rpmspec_field_names[]. Built once, NULL if that
+ * failed, in which case rpmspec trees are numbered like any other grammar.
+ */
+static uint16_t *rpmspec_symbols;
+static uint16_t *rpmspec_fields;
+static pthread_once_t rpmspec_once = PTHREAD_ONCE_INIT;
+
+static void rpmspec_numbering_init(void)
+{
+    const TSLanguage *language = tree_sitter_rpmspec();
+    uint32_t symbol_count = ts_language_symbol_count(language);
+    uint32_t field_count = ts_language_field_count(language) + 1;
+    uint16_t *symbols = malloc(symbol_count * sizeof(*symbols));
+    uint16_t *fields = malloc(field_count * sizeof(*fields));
+
+    if (symbols == NULL || fields == NULL) {
+        free(symbols);
+        free(fields);
+        return;
+    }
+
+    for (uint32_t s = 0; s < symbol_count; s++) {
+        const char *name = ts_language_symbol_name(language, (TSSymbol)s);
+        uint8_t named = ts_language_symbol_type(language, (TSSymbol)s) ==
+                        TSSymbolTypeRegular;
+
+        symbols[s] = UNMAPPED;
+        for (uint16_t i = 0; name != NULL && i < RPMSPEC_NODE_TYPE_COUNT;
+             i++) {
+            if (rpmspec_node_types[i].named == named &&
+                strcmp(rpmspec_node_types[i].name, name) == 0) {
+                symbols[s] = i;
+                break;
+            }
+        }
+    }
+
+    fields[0] = RPMSPEC_TREE_FIELD_NONE;
+    for (uint32_t f = 1; f < field_count; f++) {
+        const char *name =
+            ts_language_field_name_for_id(language, (TSFieldId)f);
+
+        fields[f] = UNMAPPED;
+        for (uint16_t i = 1; name != NULL && i < RPMSPEC_FIELD_COUNT; i++) {
+            if (strcmp(rpmspec_field_names[i], name) == 0) {
+                fields[f] = i;
+                break;
+            }
+        }
+    }
+
+    rpmspec_symbols = symbols;
+    rpmspec_fields = fields;
+}
+
+/* ========================================================================== */
+/* Writer                                                                     */
+/* ========================================================================== */
+
+/** @brief Symbol or field names of the file being written */
+struct Names {
+    uint32_t count;
+    uint32_t cap;
+    /** NULL for entries of the static table which don't occur */
+    const char **name;
+    uint8_t *named;
+};
+
+struct Writer {
+    const TSLanguage *language;
+    uint32_t language_symbol_count;
+    uint32_t language_field_count;
+
+    /** Numbering of the rpmspec grammar, NULL for other grammars */
+    const uint16_t *static_symbols;
+    const uint16_t *static_fields;
+
+    /** TSSymbol and TSFieldId to the numbers used in the file */
+    uint16_t *symbol_map;
+    uint16_t *field_map;
+
+    struct Names symbols;
+    struct Names fields;
+
+    uint32_t node_count;
+    uint32_t node_cap;
+    uint16_t *symbol;
+    uint16_t *field;
+    uint8_t *flags;
+    uint32_t *start_byte;
+    uint32_t *end_byte;
+    uint32_t *parent;
+    uint32_t *child_count;
+    uint32_t *descendant_count;
+
+    /** Ancestors of the current node */
+    uint32_t *stack;
+    uint32_t depth;
+    uint32_t stack_cap;
+};
+
+static int names_init(struct Names *names, uint32_t count)
+{
+    names->cap = count > 16 ? count : 16;
+    names->name = calloc(names->cap, sizeof(*names->name));
+    names->named = calloc(names->cap, sizeof(*names->named));
+    names->count = count;
+    return names->name != NULL && names->named != NULL ? 0 : ENOMEM;
+}
+
+/** @brief Append a name, the table can't have more than UINT16_MAX */
+static int names_add(struct Names *names, const char *name, uint8_t named)
+{
+    if (names->count >= UNMAPPED) {
+        return EOVERFLOW;
+    }
+    if (names->count == names->cap) {
+        uint32_t cap = names->cap * 2;
+        const char **name_grown =
+            realloc(names->name, cap * sizeof(*names->name));
+        uint8_t *named_grown;
+
+        if (name_grown == NULL) {
+            return ENOMEM;
+        }
+        names->name = name_grown;
+        named_grown = realloc(names->named, cap * sizeof(*names->named));
+        if (named_grown == NULL) {
+            return ENOMEM;
+        }
+        names->named = named_grown;
+        names->cap = cap;
+    }
+    names->name[names->count] = name;
+    names->named[names->count] = named;
+    names->count++;
+    return 0;
+}
+
+static void names_free(struct Names *names)
+{
+    free(names->name);
+    free(names->named);
+}
+
+static int writer_init(struct Writer *w, const TSTree *tree)
+{
+    w->language = ts_tree_language(tree);
+    w->language_symbol_count = ts_language_symbol_count(w->language);
+    w->language_field_count = ts_language_field_count(w->language) + 1;
+
+    if (w->language == tree_sitter_rpmspec()) {
+        pthread_once(&rpmspec_once, rpmspec_numbering_init);
+        w->static_symbols = rpmspec_symbols;
+        w->static_fields = rpmspec_fields;
+    }
+
+    w->symbol_map =
+        malloc(w->language_symbol_count * sizeof(*w->symbol_map));
+    w->field_map = malloc(w->language_field_count * sizeof(*w->field_map));
+    if (w->symbol_map == NULL || w->field_map == NULL) {
+        return ENOMEM;
+    }
+    memset(w->symbol_map,
+           0xff,
+           w->language_symbol_count * sizeof(*w->symbol_map));
+    memset(w->field_map, 0xff, w->language_field_count * sizeof(*w->field_map));
+    w->field_map[0] = RPMSPEC_TREE_FIELD_NONE;
+
+    if (w->static_symbols != NULL) {
+        if (names_init(&w->symbols, RPMSPEC_NODE_TYPE_COUNT) != 0 ||
+            names_init(&w->fields, RPMSPEC_FIELD_COUNT) != 0) {
+            return ENOMEM;
+        }
+    } else if (names_init(&w->symbols, 1) != 0 ||
+               names_init(&w->fields, 1) != 0) {
+        return ENOMEM;
+    }
+    w->symbols.name[RPMSPEC_TREE_SYMBOL_ERROR] = "ERROR";
+    w->symbols.named[RPMSPEC_TREE_SYMBOL_ERROR] = 1;
+    w->fields.name[RPMSPEC_TREE_FIELD_NONE] = "";
+
+    return 0;
+}
+
+static void writer_free(struct Writer *w)
+{
+    free(w->symbol_map);
+    free(w->field_map);
+    names_free(&w->symbols);
+    names_free(&w->fields);
+    free(w->symbol);
+    free(w->field);
+    free(w->flags);
+    free(w->start_byte);
+    free(w->end_byte);
+    free(w->parent);
+    free(w->child_count);
+    free(w->descendant_count);
+    free(w->stack);
+}
+
+#define GROW(array, cap)                                                       \
+    do {                                                                       \
+        void *grown = realloc((array), (size_t)(cap) * sizeof(*(array)));      \
+        if (grown == NULL) {                                                   \
+            return ENOMEM;                                                     \
+        }                                                                      \
+        (array) = grown;                                                       \
+    } while (0)
+
+static int grow_nodes(struct Writer *w, uint32_t cap)
+{
+    GROW(w->symbol, cap);
+    GROW(w->field, cap);
+    GROW(w->flags, cap);
+    GROW(w->start_byte, cap);
+    GROW(w->end_byte, cap);
+    GROW(w->parent, cap);
+    GROW(w->child_count, cap);
+    GROW(w->descendant_count, cap);
+    w->node_cap = cap;
+    return 0;
+}
+
+static int push(struct Writer *w, uint32_t node)
+{
+    if (w->depth == w->stack_cap) {
+        uint32_t cap = w->stack_cap ? w->stack_cap * 2 : 64;
+
+        GROW(w->stack, cap);
+        w->stack_cap = cap;
+    }
+    w->stack[w->depth++] = node;
+    return 0;
+}
+
+static int map_symbol(struct Writer *w, TSSymbol symbol, uint16_t *id)
+{
+    uint16_t mapped;
+    int rc;
+
+    /* ts_builtin_sym_error and anything else outside the grammar */
+    if (symbol >= w->language_symbol_count) {
+        *id = RPMSPEC_TREE_SYMBOL_ERROR;
+        return 0;
+    }
+    if (w->symbol_map[symbol] != UNMAPPED) {
+        *id = w->symbol_map[symbol];
+        return 0;
+    }
+
+    mapped = w->static_symbols != NULL ? w->static_symbols[symbol]
+                                       : UNMAPPED;
+    if (mapped != UNMAPPED) {
+        w->symbols.name[mapped] = ts_language_symbol_name(w->language, symbol);
+        w->symbols.named[mapped] =
+            ts_language_symbol_type(w->language, symbol) ==
+            TSSymbolTypeRegular;
+    } else {
+        /* Not in node-types.json, e.g. a grammar other than rpmspec */
+        mapped = (uint16_t)w->symbols.count;
+        rc = names_add(&w->symbols,
+                       ts_language_symbol_name(w->language, symbol),
+                       ts_language_symbol_type(w->language, symbol) ==
+                           TSSymbolTypeRegular);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    w->symbol_map[symbol] = mapped;
+    *id = mapped;
+    return 0;
+}
+
+static int map_field(struct Writer *w, TSFieldId field, uint16_t *id)
+{
+    uint16_t mapped;
+    int rc;
+
+    if (field >= w->language_field_count) {
+        *id = RPMSPEC_TREE_FIELD_NONE;
+        return 0;
+    }
+    if (w->field_map[field] != UNMAPPED) {
+        *id = w->field_map[field];
+        return 0;
+    }
+
+    mapped = w->static_fields != NULL ? w->static_fields[field] : UNMAPPED;
+    if (mapped != UNMAPPED) {
+        w->fields.name[mapped] =
+            ts_language_field_name_for_id(w->language, field);
+    } else {
+        mapped = (uint16_t)w->fields.count;
+        rc = names_add(&w->fields,
+                       ts_language_field_name_for_id(w->language, field),
+                       0);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    w->field_map[field] = mapped;
+    *id = mapped;
+    return 0;
+}
+
+/** @brief Append the node under the cursor as a child of the stack top */
+static int add_node(struct Writer *w, TSTreeCursor *cursor, uint32_t *index)
+{
+    TSNode node = ts_tree_cursor_current_node(cursor);
+    uint32_t i = w->node_count;
+    uint32_t parent =
+        w->depth > 0 ? w->stack[w->depth - 1] : RPMSPEC_TREE_NONE;
+    uint8_t flags = 0;
+    int rc;
+
+    if (i == w->node_cap) {
+        if (w->node_cap >= UINT32_MAX / 2) {
+            return EOVERFLOW;
+        }
+        rc = grow_nodes(w, w->node_cap ? w->node_cap * 2 : 1024);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    rc = map_symbol(w, ts_node_symbol(node), &w->symbol[i]);
+    if (rc == 0) {
+        rc = map_field(
+            w, ts_tree_cursor_current_field_id(cursor), &w->field[i]);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+    if (ts_node_is_error(node)) {
+        w->symbol[i] = RPMSPEC_TREE_SYMBOL_ERROR;
+        flags |= RPMSPEC_TREE_ERROR;
+    }
+    if (ts_node_is_named(node)) {
+        flags |= RPMSPEC_TREE_NAMED;
+    }
+    if (ts_node_is_missing(node)) {
+        flags |= RPMSPEC_TREE_MISSING;
+    }
+    if (ts_node_is_extra(node)) {
+        flags |= RPMSPEC_TREE_EXTRA;
+    }
+    if (ts_node_has_error(node)) {
+        flags |= RPMSPEC_TREE_HAS_ERROR;
+    }
+    w->flags[i] = flags;
+    w->start_byte[i] = ts_node_start_byte(node);
+    w->end_byte[i] = ts_node_end_byte(node);
+    w->parent[i] = parent;
+    w->child_count[i] = 0;
+    w->descendant_count[i] = 0;
+    if (parent != RPMSPEC_TREE_NONE) {
+        w->child_count[parent]++;
+    }
+
+    w->node_count++;
+    *index = i;
+    return 0;
+}
+
+/** @brief Flatten the tree in pre-order */
+static int walk(struct Writer *w, const TSTree *tree)
+{
+    TSNode root = ts_tree_root_node(tree);
+    TSTreeCursor cursor = ts_tree_cursor_new(root);
+    uint32_t current;
+    int rc;
+
+    /* Visible nodes, what the cursor visits */
+    rc = grow_nodes(w, ts_node_descendant_count(root) + 16);
+    if (rc == 0) {
+        rc = add_node(w, &cursor, &current);
+    }
+    while (rc == 0) {
+        if (ts_tree_cursor_goto_first_child(&cursor)) {
+            rc = push(w, current);
+            if (rc == 0) {
+                rc = add_node(w, &cursor, &current);
+            }
+            continue;
+        }
+
+        /* Leaf: finish it and every ancestor it is the last child of */
+        for (;;) {
+            w->descendant_count[current] = w->node_count - current - 1;
+            if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+                rc = add_node(w, &cursor, &current);
+                break;
+            }
+            if (w->depth == 0) {
+                ts_tree_cursor_delete(&cursor);
+                return 0;
+            }
+            current = w->stack[--w->depth];
+            ts_tree_cursor_goto_parent(&cursor);
+        }
+    }
+
+    ts_tree_cursor_delete(&cursor);
+    return rc;
+}
+
+/** @brief Write the name offsets of a table and append its names */
+static uint64_t put_names(const struct Names *names,
+                          uint32_t *offsets,
+                          char *strings,
+                          uint64_t strings_len)
+{
+    for (uint32_t i = 0; i < names->count; i++) {
+        const char *name = names->name[i];
+        size_t len;
+
+        if (name == NULL || *name == '\0') {
+            offsets[i] = 0;
+            continue;
+        }
+        len = strlen(name) + 1;
+        offsets[i] = (uint32_t)strings_len;
+        memcpy(strings + strings_len, name, len);
+        strings_len += len;
+    }
+    return strings_len;
+}
+
+static uint64_t names_len(const struct Names *names)
+{
+    uint64_t len = 0;
+
+    for (uint32_t i = 0; i < names->count; i++) {
+        if (names->name[i] != NULL) {
+            len += strlen(names->name[i]) + 1;
+        }
+    }
+    return len;
+}
+
+static int assemble(const struct Writer *w, void **data, size_t *size)
+{
+    struct TreeHeader header;
+    uint64_t strings_len = 1;
+    uint64_t offset;
+    char *buf;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC));
+    header.version = RPMSPEC_TREE_VERSION;
+    header.byte_order = TREE_BYTE_ORDER;
+    header.node_count = w->node_count;
+    header.symbol_count = w->symbols.count;
+    header.field_count = w->fields.count;
+    header.source_size = w->end_byte[0];
+
+    offset = align8(sizeof(header));
+    for (int s = 0; s < SECTION_STRINGS; s++) {
+        header.offset[s] = offset;
+        offset = align8(offset + section_size((enum Section)s,
+                                              header.node_count,
+                                              header.symbol_count,
+                                              header.field_count));
+    }
+    strings_len += names_len(&w->symbols) + names_len(&w->fields);
+    header.offset[SECTION_STRINGS] = offset;
+    header.size = align8(offset + strings_len);
+    if (header.size > SIZE_MAX || strings_len > UINT32_MAX) {
+        return EFBIG;
+    }
+
+    /* Zeroed, so the padding and the leading empty string are NUL */
+    buf = calloc(1, (size_t)header.size);
+    if (buf == NULL) {
+        return ENOMEM;
+    }
+    memcpy(buf, &header, sizeof(header));
+
+#define PUT(section, array)                                                    \
+    memcpy(buf + header.offset[section],                                       \
+           (array),                                                            \
+           (size_t)section_size(section,                                       \
+                                header.node_count,                             \
+                                header.symbol_count,                           \
+                                header.field_count))
+    PUT(SECTION_SYMBOL, w->symbol);
+    PUT(SECTION_FIELD, w->field);
+    PUT(SECTION_FLAGS, w->flags);
+    PUT(SECTION_START_BYTE, w->start_byte);
+    PUT(SECTION_END_BYTE, w->end_byte);
+    PUT(SECTION_PARENT, w->parent);
+    PUT(SECTION_CHILD_COUNT, w->child_count);
+    PUT(SECTION_DESCENDANT_COUNT, w->descendant_count);
+    PUT(SECTION_SYMBOL_NAMED, w->symbols.named);
+#undef PUT
+
+    strings_len = put_names(
+        &w->symbols,
+        (uint32_t *)(void *)(buf + header.offset[SECTION_SYMBOL_NAME]),
+        buf + header.offset[SECTION_STRINGS],
+        1);
+    put_names(&w->fields,
+              (uint32_t *)(void *)(buf + header.offset[SECTION_FIELD_NAME]),
+              buf + header.offset[SECTION_STRINGS],
+              strings_len);
+
+    *data = buf;
+    *size = (size_t)header.size;
+    return 0;
+}
+
+int rpmspec_tree_serialize(const TSTree *tree, void **data, size_t *size)
+{
+    struct Writer w;
+    int rc;
+
+    memset(&w, 0, sizeof(w));
+    rc = writer_init(&w, tree);
+    if (rc == 0) {
+        rc = walk(&w, tree);
+    }
+    if (rc == 0) {
+        rc = assemble(&w, data, size);
+    }
+    writer_free(&w);
+    return rc;
+}
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return errno;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/** @brief Numbers the temporary files of all threads of the process */
+static atomic_uint tmp_counter;
+
+/**
+ * @brief Create a temporary file next to @p path
+ *
+ * The name is unique among the threads of this process; a file left behind
+ * by a crashed process with the same pid is skipped. Unlike mkstemp(),
+ * open() applies the current umask to mode 0666, so the file gets the mode
+ * of any newly created file.
+ *
+ * @param tmp Receives the name, strlen(path) + TMP_SUFFIX_MAX bytes
+ * @param fd Receives the descriptor, open for writing
+ *
+ * @return 0 on success, an errno value otherwise
+ */
+static int create_tmp(const char *path, char *tmp, size_t tmp_len, int *fd)
+{
+    for (int attempt = 0; attempt < TMP_ATTEMPTS; attempt++) {
+        snprintf(tmp,
+                 tmp_len,
+                 "%s.%ld.%u.tmp",
+                 path,
+                 (long)getpid(),
+                 atomic_fetch_add(&tmp_counter, 1));
+        *fd = open(tmp, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+        if (*fd >= 0) {
+            return 0;
+        }
+        if (errno != EEXIST) {
+            return errno;
+        }
+    }
+    return EEXIST;
+}
+
+int rpmspec_tree_save(const TSTree *tree, const char *path)
+{
+    void *data;
+    size_t size;
+    size_t tmp_len = strlen(path) + TMP_SUFFIX_MAX;
+    char *tmp;
+    int fd;
+    int rc;
+
+    rc = rpmspec_tree_serialize(tree, &data, &size);
+    if (rc != 0) {
+        return rc;
+    }
+    tmp = malloc(tmp_len);
+    if (tmp == NULL) {
+        free(data);
+        return ENOMEM;
+    }
+
+    rc = create_tmp(path, tmp, tmp_len, &fd);
+    if (rc != 0) {
+        goto out;
+    }
+    rc = write_full(fd, data, size);
+    if (close(fd) != 0 && rc == 0) {
+        rc = errno;
+    }
+    if (rc == 0 && rename(tmp, path) != 0) {
+        rc = errno;
+    }
+    if (rc != 0) {
+        unlink(tmp);
+    }
+
+out:
+    free(tmp);
+    free(data);
+    return rc;
+}
+
+/* ========================================================================== */
+/* Reader                                                                     */
+/* ========================================================================== */
+
+static int check_names(const uint32_t *offsets,
+                       uint32_t count,
+                       uint64_t strings_len)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (offsets[i] >= strings_len) {
+            return EINVAL;
+        }
+    }
+    return 0;
+}
+
+/** @brief Check the tree structure, so navigation stays in bounds */
+static int check_nodes(const RpmspecTreeView *v)
+{
+    if (v->parent[0] != RPMSPEC_TREE_NONE ||
+        v->descendant_count[0] != v->node_count - 1 ||
+        v->end_byte[0] != v->source_size) {
+        return EINVAL;
+    }
+    for (uint32_t i = 0; i < v->node_count; i++) {
+        uint32_t descendants = v->descendant_count[i];
+        uint32_t parent = v->parent[i];
+
+        if (v->symbol[i] >= v->symbol_count ||
+            v->field[i] >= v->field_count ||
+            v->start_byte[i] > v->end_byte[i] ||
+            descendants > v->node_count - i - 1 ||
+            v->child_count[i] > descendants ||
+            (v->child_count[i] == 0) != (descendants == 0)) {
+            return EINVAL;
+        }
+        /* Children directly follow their parent, within its subtree */
+        if (descendants > 0 && v->parent[i + 1] != i) {
+            return EINVAL;
+        }
+        if (i == 0) {
+            continue;
+        }
+        if (parent >= i ||
+            i + descendants > parent + v->descendant_count[parent]) {
+            return EINVAL;
+        }
+    }
+    return 0;
+}
+
+int rpmspec_tree_view_init(RpmspecTreeView *view,
+                           const void *data,
+                           size_t size)
+{
+    const char *buf = data;
+    struct TreeHeader header;
+    uint64_t strings_len;
+    RpmspecTreeView v;
+    int rc;
+
+    if (size < sizeof(header) || ((uintptr_t)data & 7) != 0) {
+        return EINVAL;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, TREE_MAGIC, sizeof(TREE_MAGIC)) != 0) {
+        return EINVAL;
+    }
+    if (header.byte_order != TREE_BYTE_ORDER) {
+        return header.byte_order == __builtin_bswap32(TREE_BYTE_ORDER)
+                   ? ENOTSUP
+                   : EINVAL;
+    }
+    if (header.version != RPMSPEC_TREE_VERSION) {
+        return ENOTSUP;
+    }
+    if (header.size != size || header.node_count == 0 ||
+        header.symbol_count == 0 || header.symbol_count > UNMAPPED ||
+        header.field_count == 0 || header.field_count > UNMAPPED) {
+        return EINVAL;
+    }
+
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        uint64_t len = section_size((enum Section)s,
+                                    header.node_count,
+                                    header.symbol_count,
+                                    header.field_count);
+
+        if ((header.offset[s] & 7) != 0 ||
+            header.offset[s] < sizeof(header) || header.offset[s] > size ||
+            len > size - header.offset[s]) {
+            return EINVAL;
+        }
+    }
+    strings_len = size - header.offset[SECTION_STRINGS];
+    if (strings_len == 0 || buf[size - 1] != '\0') {
+        return EINVAL;
+    }
+
+#define AT(section) ((const void *)(buf + header.offset[section]))
+    v.node_count = header.node_count;
+    v.symbol_count = header.symbol_count;
+    v.field_count = header.field_count;
+    v.source_size = header.source_size;
+    v.symbol = AT(SECTION_SYMBOL);
+    v.field = AT(SECTION_FIELD);
+    v.flags = AT(SECTION_FLAGS);
+    v.start_byte = AT(SECTION_START_BYTE);
+    v.end_byte = AT(SECTION_END_BYTE);
+    v.parent = AT(SECTION_PARENT);
+    v.child_count = AT(SECTION_CHILD_COUNT);
+    v.descendant_count = AT(SECTION_DESCENDANT_COUNT);
+    v.symbol_named = AT(SECTION_SYMBOL_NAMED);
+    v.symbol_name = AT(SECTION_SYMBOL_NAME);
+    v.field_name = AT(SECTION_FIELD_NAME);
+    v.strings = AT(SECTION_STRINGS);
+#undef AT
+
+    rc = check_names(v.symbol_name, v.symbol_count, strings_len);
+    if (rc == 0) {
+        rc = check_names(v.field_name, v.field_count, strings_len);
+    }
+    if (rc == 0) {
+        rc = check_nodes(&v);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    *view = v;
+    return 0;
+}